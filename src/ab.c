@@ -20,6 +20,8 @@
 #include "game.h"
 #include "move.h"
 #include "engine.h"
+#include "stats.h"
+#include "tb.h"
 
 #include <signal.h>
 #include <string.h>
@@ -35,12 +37,46 @@ static gboolean ab_tree_exhausted = FALSE;
 
 static int ab_leaf_cnt;  // how many leaves were eval'd
 
+static int ab_node_cnt;
+
+static int ab_cutoff_cnt, ab_first_cutoff_cnt;
+
+SearchStats ab_stats;
+
+//! Hash table counts at the start of the current ab_dfid()
+static int ab_tt_probes0, ab_tt_hits0, ab_tt_stores0, ab_tt_collisions0;
+
+//! If positive, ab_dfid() will not search deeper than this many ply
+int ab_max_depth = 0;
+
+//! If positive, ab_dfid() will stop after searching (about) this many nodes
+int ab_max_nodes = 0;
+
+//! game_solve() gets 1/AB_SOLVE_SHARE of time_per_move; the rest is left for alpha-beta
+#define AB_SOLVE_SHARE 4
+
+static gboolean ab_solve_timed_out;
+
+static int ab_solve_timeout_cb ()
+{
+	ab_solve_timed_out = TRUE;
+	engine_stop_search = TRUE;
+	return FALSE;
+}
+
+//! If not NULL, ab_dfid() calls this after completing each iteration
+/** The arguments are the root position, the number of ply searched, the 
+ value, the best move and the number of nodes searched so far. */
+void (*ab_iter_cb) (Pos *, int, float, byte *, int) = NULL;
+
 extern int hash_get_eval (byte *, int, int, int, float *);
 extern void hash_print_stats ();
 extern void hash_insert (byte *, int, int, int, float, byte *move);
 extern void hash_clear ();
 extern void hash_insert_move (byte *, int, int, byte *);
 extern byte * hash_get_move (byte *, int, int);
+extern void hash_get_stats (int *, int *);
+extern void hash_get_store_stats (int *, int *);
 
 extern gboolean opt_verbose;
 
@@ -49,11 +85,13 @@ gboolean game_use_hash = TRUE;
 	
 // FIXME: this function is too complicated
 float ab_with_tt (Pos *pos, int player, int level, 
-		float alpha, float beta, byte *best_movep)
-	/* level is the number of ply to search */
+		float eval, float alpha, float beta, byte *best_movep)
+	/* level is the number of ply to search. eval is the value of pos
+	   as given by game_eval(), or NAN if the caller doesn't know it */
 {
 	int to_play = player;
 	float val, cacheval, best= 0, retval;
+	gboolean use_incr;
 	gboolean first = TRUE;
 	byte *movlist, *move;
 	byte best_move [4096];
@@ -64,7 +102,10 @@ float ab_with_tt (Pos *pos, int player, int level,
 	best_move [0] = -1;
 	
 	engine_poll ();
+	if (ab_max_nodes > 0 && ab_node_cnt + ab_leaf_cnt >= ab_max_nodes)
+		engine_stop_search = TRUE;
 	if (engine_stop_search) { ab_tree_exhausted = FALSE; return 0; }
+	ab_node_cnt++;
 
 	movlist = game_movegen (pos);
 	if (movlist[0] == -2)		/* we have no move left */
@@ -87,7 +128,12 @@ float ab_with_tt (Pos *pos, int player, int level,
 	}
 	// origmove is the owning pointer and move is the aliasing pointer
 	else orig_move = move = movdup (move);
+
+	use_incr = game_eval_incr && (!game_use_incr_eval || game_use_incr_eval (pos));
+	if (use_incr && isnan (eval))
+		game_eval (pos, to_play, &eval);
 	
+	newpos.game = pos->game;
 	newpos.board = malloc (board_wid * board_heit);
 	assert (newpos.board);
 	if (game_stateful)
@@ -100,7 +146,15 @@ float ab_with_tt (Pos *pos, int player, int level,
 	{
 		if (!orig_move || hashed_move || !movcmp_literal (orig_move, move))
 		{
-			ResultType result = RESULT_NOTYET;
+			ResultType result = RESULT_NOTYET, tbresult;
+			float neweval = NAN;
+			if (use_incr)
+			{
+				// a move that ends the game gets the final value, not the difference
+				result = game_eval_incr (pos, move, &neweval);
+				if (result == RESULT_NOTYET)
+					neweval += eval;
+			}
 			memcpy (newpos.board, pos->board, board_wid * board_heit);
 			if (game_stateful)
 			{
@@ -115,8 +169,16 @@ float ab_with_tt (Pos *pos, int player, int level,
 			if (game_use_hash && level > 0)
 				retval = hash_get_eval (newpos.board, board_wid * board_heit, 
 						newpos.num_moves, level-1, &cacheval);
-			if (retval && fabs (cacheval) < GAME_EVAL_INFTY) val = cacheval;
-			else result = game_eval (&newpos, to_play == WHITE ? BLACK : WHITE, &val);
+			// a position in the tablebase has its exact value
+			if ((tbresult = tb_probe (&newpos, &val)) != RESULT_NOTYET)
+				result = tbresult;
+			else if (retval && fabs (cacheval) < GAME_EVAL_INFTY) val = cacheval;
+			else if (use_incr) val = neweval;
+			else
+			{
+				result = game_eval (&newpos, to_play == WHITE ? BLACK : WHITE, &val);
+				neweval = val;
+			}
 			if (level == 0)
 			{
 				ab_leaf_cnt ++;
@@ -137,7 +199,7 @@ float ab_with_tt (Pos *pos, int player, int level,
 				else
 				{
 					val = ab_with_tt (&newpos, player == WHITE ? BLACK : WHITE, 
-								level-1, alpha, beta, best_move);
+								level-1, neweval, alpha, beta, best_move);
 				}
 			}
 			if((player == WHITE && val > local_alpha) 
@@ -152,7 +214,13 @@ float ab_with_tt (Pos *pos, int player, int level,
 			if ((player == BLACK && val < beta))
 				beta  = val;
 			if (alpha >= beta || alpha >= GAME_EVAL_INFTY || beta <= -GAME_EVAL_INFTY)
+			{
+				ab_cutoff_cnt++;
+				if (first)
+					ab_first_cutoff_cnt++;
 				break;
+			}
+			first = FALSE;
 		}
 		if (hashed_move)
 			move = movlist;
@@ -171,112 +239,45 @@ float ab_with_tt (Pos *pos, int player, int level,
 	return player == WHITE ? alpha : beta;
 }
 
-#if 0
-// TODO: this is currently unused, and must be merged with the previous function 
-float ab_with_tt_incr (Pos *pos, int player, int level, 
-		float eval, float alpha, float beta, byte *best_movep)
-	/* level is the number of ply to search */
+//! Searches exactly depth ply and returns the value of the position
+/** Unlike ab_dfid() this is not interrupted by the clock. If best_move 
+  is not NULL the best move is copied into it. */
+float ab_fixed_depth (Pos *pos, int depth, byte *best_move)
 {
-	int to_play = player;
-	float val, cacheval, best= 0, retval;
-	int first = 1;
-	byte *movlist, *move;
-	byte best_move [4096];
-	void *oldstate = NULL; // use the recursion to implement stack of states
-	engine_poll ();
-	if (engine_stop_search) 
-	{ 
-		ab_tree_exhausted = FALSE; 
-		return 0; 
-	}
-	if (game_stateful)
-	{
-		oldstate = (void *) malloc (game_state_size);
-		assert (oldstate);
-	}
-	movlist = game_movegen (pos);
-	if (movlist[0] == -2)		/* we have no move left */
+	float val;
+	byte local_best_move[4096];
+	engine_stop_search = FALSE;
+	if (depth <= 0 || !game_movegen)
 	{
-		free (movlist);
-		game_eval (pos, to_play, &val);
+		game_eval (pos, pos->player, &val);
 		return val;
 	}
-	move = movlist;
-	do
-	{
-		float neweval = 0, incr_eval;
-		ResultType result;
-		result = game_eval_incr (pos, to_play, move, &incr_eval);
-		neweval = eval + incr_eval;
-		
-		if (level == 0)
-		{
-			ab_leaf_cnt ++;
-			ab_tree_exhausted = FALSE;
-			val = neweval;
-		}
-		else if (fabs (incr_eval) >= GAME_EVAL_INFTY 
-				|| result != RESULT_NOTYET)
-			// one side has won; search no more
-		{
-			ab_leaf_cnt ++;
-			val = neweval * (1 + level); // the sooner the better
-		}
-		else 
-		{
-			int found = 0;
-			byte *movinv = mov_getinv (pos->board, move);
-			move_apply (pos->board, move);
-			if (game_stateful)
-			{
-				void *newstate = game_newstate (pos, move);
-				memcpy (oldstate, pos->state, game_state_size);
-				memcpy (pos->state, newstate, game_state_size);
-			}
-			pos->num_moves++;
-			pos->player = pos->player == WHITE ? BLACK : WHITE;
-			val = 0; // stop compiler warning
-			if (level >= 1)
-			{
-				retval = hash_get_eval (pos->board, board_wid * board_heit, 
-						pos->num_moves, level, &cacheval);
-				if (retval && cacheval < GAME_EVAL_INFTY)  
-					{ val = cacheval; found = 1; }
-			}
-			if (!found)
-				val = ab_with_tt_incr
-					(pos, player == WHITE ? BLACK : WHITE, 
-						level-1, neweval, alpha, beta, best_move);
-			if (level >= 1)
-				hash_insert (pos->board, board_wid * board_heit, 
-						pos->num_moves, level, val, NULL);
-			move_apply (pos->board, movinv);
-			free (movinv);
-			memcpy (pos->state, oldstate, game_state_size);
-			pos->num_moves--;
-			pos->player = pos->player == WHITE ? BLACK : WHITE;
-		}
-		if (first)
-		{
-			if (best_movep) movcpy (best_movep, move);
-			first = 0;
-		}
-		if ((player == WHITE && val > alpha) || (player == BLACK && val < beta))
-		{
-			if (best_movep) movcpy (best_movep, move);
-			if (player == WHITE) alpha = val; else beta = val;
-		}
-		if (alpha >= beta)
-			break;
-		move = movlist_next (move);
-	}
-	while (move[0] != -2);
-	free (movlist);
-	if (game_stateful)
-		free (oldstate);
-	return player == WHITE ? alpha : beta;
+	pos->search_depth = 0;
+	local_best_move[0] = -1;
+	val = ab_with_tt (pos, pos->player, depth - 1, NAN, -1e+16, 1e+16, 
+			local_best_move);
+	if (best_move)
+		movcpy (best_move, local_best_move);
+	if (game_use_hash)
+		hash_clear ();
+	return val;
+}
+
+//! Copies the counts of the search so far into #ab_stats
+static void ab_stats_update ()
+{
+	int probes, hits, stores, collisions;
+	hash_get_stats (&probes, &hits);
+	hash_get_store_stats (&stores, &collisions);
+	ab_stats.nodes = ab_node_cnt + ab_leaf_cnt;
+	ab_stats.leaves = ab_leaf_cnt;
+	ab_stats.tt_probes = probes - ab_tt_probes0;
+	ab_stats.tt_hits = hits - ab_tt_hits0;
+	ab_stats.tt_stores = stores - ab_tt_stores0;
+	ab_stats.tt_collisions = collisions - ab_tt_collisions0;
+	ab_stats.cutoffs = ab_cutoff_cnt;
+	ab_stats.first_cutoffs = ab_first_cutoff_cnt;
 }
-#endif 
 
 byte * ab_dfid (Pos *pos, int player)
 {
@@ -287,10 +288,15 @@ byte * ab_dfid (Pos *pos, int player)
 	static GTimer *timer = NULL;
 	gboolean found = FALSE;
 	byte *move_list;
+	int solve_nodes = 0;
 	engine_stop_search = 0;
 	if (!game_movegen || !game_eval)
 		return NULL;
-	ab_leaf_cnt=0;
+	ab_leaf_cnt = ab_node_cnt = 0;
+	ab_cutoff_cnt = ab_first_cutoff_cnt = 0;
+	memset (&ab_stats, 0, sizeof (ab_stats));
+	hash_get_stats (&ab_tt_probes0, &ab_tt_hits0);
+	hash_get_store_stats (&ab_tt_stores0, &ab_tt_collisions0);
 
 	move_list = game_movegen (pos);
 	if (move_list[0] == -2)
@@ -302,23 +308,65 @@ byte * ab_dfid (Pos *pos, int player)
 	if (movlist_next (move_list)[0] == -2)
 	{
 		movcpy (best_move, move_list);
+		free (move_list);
 		if (opt_verbose) printf ("Only one legal move\n");
 		return best_move;
 	}
 
 	if (!timer) timer = g_timer_new ();
 	g_timer_start (timer);
+
+	if (game_solve)
+	{
+		guint solve_tag = 0;
+		ab_solve_timed_out = FALSE;
+		if (time_per_move > 0)
+			solve_tag = g_timeout_add (time_per_move / AB_SOLVE_SHARE,
+					ab_solve_timeout_cb, NULL);
+		ply = game_solve (pos, local_best_move, &val, &solve_nodes);
+		if (solve_tag && !ab_solve_timed_out)
+			g_source_remove (solve_tag);
+		if (ply > 0)
+		{
+			movcpy (best_move, local_best_move);
+			free (move_list);
+			ab_stats.depth = ply;
+			ab_stats.nodes = solve_nodes;
+			ab_stats.time = (int) (g_timer_elapsed (timer, NULL) * 1000);
+			if (ab_iter_cb)
+				ab_iter_cb (pos, ply, val, best_move, solve_nodes);
+			if (opt_verbose)
+				printf ("Solved the game. Moves=%d;\t Ply=%d\n", pos->num_moves, ply);
+			return best_move;
+		}
+		// the solver only used up its own share of the time
+		if (ab_solve_timed_out)
+			engine_stop_search = FALSE;
+	}
 	
-	for (ply = 0; !engine_stop_search; ply++)
+	for (ply = 0; !engine_stop_search && (ab_max_depth <= 0 || ply < ab_max_depth); 
+			ply++)
 	{
+		int iter_nodes0 = ab_node_cnt + ab_leaf_cnt;
+		int iter_ms0 = (int) (g_timer_elapsed (timer, NULL) * 1000);
 		oldval = val;
 		ab_tree_exhausted = TRUE;
 		pos->search_depth = 0;
-		val = ab_with_tt (pos, player, ply, -1e+16, 1e+16, local_best_move);
+		val = ab_with_tt (pos, player, ply, NAN, -1e+16, 1e+16, local_best_move);
 		if (!engine_stop_search)
 		{
+			int iter_ms = (int) (g_timer_elapsed (timer, NULL) * 1000);
+			if (ab_stats.num_iter < STATS_MAX_ITER)
+			{
+				ab_stats.iter_nodes[ab_stats.num_iter] = ab_node_cnt + ab_leaf_cnt - iter_nodes0;
+				ab_stats.iter_time[ab_stats.num_iter] = iter_ms - iter_ms0;
+				ab_stats.num_iter++;
+			}
+			ab_stats.depth = ply + 1;
 			movcpy (best_move, local_best_move);
 			found = TRUE;
+			if (ab_iter_cb)
+				ab_iter_cb (pos, ply + 1, val, best_move, ab_node_cnt + ab_leaf_cnt);
 		}
 		
 		if (ab_tree_exhausted)
@@ -344,7 +392,7 @@ byte * ab_dfid (Pos *pos, int player)
 			float time_taken;
 			time_taken = g_timer_elapsed (timer, &micro_sec);
 			time_taken += micro_sec / 1000000.0;
-			if (time_taken * 1000 > time_per_move / 2)
+			if (time_per_move > 0 && time_taken * 1000 > time_per_move / 2)
 			{
 				ply++;
 				break;
@@ -352,6 +400,18 @@ byte * ab_dfid (Pos *pos, int player)
 		}
 	}
 	
+	// stopped before the first iteration was done
+	if (!found)
+	{
+		movcpy (best_move, move_list);
+		found = TRUE;
+	}
+	free (move_list);
+
+	ab_stats_update ();
+	// a solver that gave up still searched
+	ab_stats.nodes += solve_nodes;
+	ab_stats.time = (int) (g_timer_elapsed (timer, NULL) * 1000);
 	if (game_use_hash)
 	{
 		hash_print_stats ();
@@ -0,0 +1,240 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <assert.h>
+
+#include "game.h"
+#include "move.h"
+#include "stack.h"
+#include "engine.h"
+#include "analyze.h"
+
+/** \file analyze.c
+  \brief Batch analysis of the games in a log file written with -l.
+
+  Every position in which a move was played is searched, and one line is
+  written per position:
+
+  <tt>game</tt> g <tt>ply</tt> p <tt>side</tt> w|b <tt>played</tt> move
+  <tt>eval</tt> e <tt>depth</tt> d <tt>nodes</tt> n <tt>time</tt> msec
+  <tt>bestmove</tt> move <tt>pv</tt> move ...
+
+  The eval is from white's point of view and moves are written as by
+  engine_write_move_token(). The positions are shared out among several
+  processes, each with its own hash table; the lines are written in the
+  order of the log all the same.
+  */
+
+extern Pos cur_pos;
+extern Game *opt_game;
+extern int time_per_move;
+extern gboolean engine_flag;
+extern int ab_max_depth;
+extern void (*ab_iter_cb) (Pos *, int, float, byte *, int);
+
+//! Results of the last completed iteration of the current search
+static int an_depth, an_nodes;
+static float an_eval;
+static GString *an_pv = NULL;
+
+static void analyze_iter_cb (Pos *pos, int depth, float val, byte *best_move, int nodes)
+{
+	an_depth = depth;
+	an_eval = val;
+	an_nodes = nodes;
+	g_string_truncate (an_pv, 0);
+	engine_get_pv (pos, best_move, depth, an_pv);
+}
+
+static void analyze_pos (int gameno, int ply, byte *played, int depth, FILE *fout)
+{
+	byte *move;
+	GTimer *timer = g_timer_new ();
+	gulong micro_sec;
+	if (!an_pv) an_pv = g_string_new ("");
+	g_string_truncate (an_pv, 0);
+	an_depth = an_nodes = 0;
+	game_eval (&cur_pos, cur_pos.player, &an_eval);
+	ab_max_depth = depth;
+	ab_iter_cb = analyze_iter_cb;
+	move = engine_search_timed (&cur_pos, depth > 0 ? 0 : 2 * time_per_move);
+	ab_iter_cb = NULL;
+	ab_max_depth = 0;
+	fprintf (fout, "game %d ply %d side %c played ", gameno, ply, 
+			cur_pos.player == WHITE ? 'w' : 'b');
+	engine_write_move_token (played, fout);
+	fprintf (fout, " eval %g depth %d nodes %d time %d bestmove ", an_eval, 
+			an_depth, an_nodes, (int) (g_timer_elapsed (timer, &micro_sec) * 1000));
+	if (move)
+		engine_write_move_token (move, fout);
+	else
+		fprintf (fout, "(none)");
+	if (move && an_pv->len == 0)
+		engine_get_pv (&cur_pos, move, 1, an_pv);
+	fprintf (fout, " pv%s\n", an_pv->str);
+	g_timer_destroy (timer);
+}
+
+//! Replays the log and analyzes the positions numbered worker, worker + num_workers, ...
+static void analyze_worker (GPtrArray *lines, int depth, int worker, int num_workers, FILE *fout)
+{
+	int i, gameno = 1, ply = 0, count = 0;
+	gboolean skip = FALSE;
+	engine_reset_game ();
+	for (i=0; i<lines->len; i++)
+	{
+		char *line = g_ptr_array_index (lines, i);
+		byte *move, *movlist;
+		if (!strncmp (line, "RESULT", 6))
+		{
+			engine_reset_game ();
+			gameno++;
+			ply = 0;
+			skip = FALSE;
+			continue;
+		}
+		if (skip)
+			continue;
+		move = movdup (move_read (line));
+		movlist = game_movegen (&cur_pos);
+		if (!movlist_contains (movlist, move))
+		{
+			if (worker == 0)
+				fprintf (stderr, "analyze: illegal move in game %d at ply %d, "
+						"skipping the rest of the game\n", gameno, ply);
+			skip = TRUE;
+		}
+		else
+		{
+			if (count++ % num_workers == worker)
+				analyze_pos (gameno, ply, move, depth, fout);
+			movstack_trunc ();
+			engine_apply_move (move);
+			ply++;
+		}
+		free (movlist);
+		free (move);
+	}
+	fflush (fout);
+}
+
+//! Reads the lines of the log
+/** A blank line is kept: it is how move_fwrite() writes a pass. */
+static GPtrArray *analyze_read_log (FILE *log)
+{
+	char linebuf[4096];
+	GPtrArray *lines = g_ptr_array_new ();
+	while (fgets (linebuf, sizeof (linebuf), log))
+		g_ptr_array_add (lines, g_strdup (linebuf));
+	return lines;
+}
+
+//! Arguments of analyze_worker() when run through analyze_fork_workers()
+typedef struct
+{
+	GPtrArray *lines;
+	int depth;
+} AnalyzeJob;
+
+static void analyze_job (int worker, int num_workers, FILE *fout, gpointer data)
+{
+	AnalyzeJob *job = data;
+	analyze_worker (job->lines, job->depth, worker, num_workers, fout);
+}
+
+FILE **analyze_fork_workers (int num_workers, 
+		void (*work) (int, int, FILE *, gpointer), gpointer data)
+{
+	FILE **outs;
+	pid_t *pids;
+	int i;
+	outs = (FILE **) malloc (num_workers * sizeof (FILE *));
+	pids = (pid_t *) malloc (num_workers * sizeof (pid_t));
+	assert (outs && pids);
+	for (i=0; i<num_workers; i++)
+	{
+		outs[i] = tmpfile ();
+		if (!outs[i])
+		{
+			perror ("tmpfile");
+			exit (1);
+		}
+		fflush (stdout);
+		pids[i] = fork ();
+		if (pids[i] < 0)
+		{
+			perror ("fork");
+			exit (1);
+		}
+		if (pids[i] == 0)
+		{
+			work (i, num_workers, outs[i], data);
+			fflush (outs[i]);
+			_exit (0);
+		}
+	}
+	for (i=0; i<num_workers; i++)
+	{
+		waitpid (pids[i], NULL, 0);
+		rewind (outs[i]);
+	}
+	free (pids);
+	return outs;
+}
+
+void analyze_log (FILE *log, int depth, int num_workers)
+{
+	AnalyzeJob job;
+	FILE **outs;
+	int i, alive;
+	char linebuf[8192];
+	engine_flag = TRUE;
+	if (game_single_player || game_search || !game_movegen || !game_eval)
+	{
+		fprintf (stderr, "analyze: %s can't be analyzed\n", opt_game->name);
+		exit (1);
+	}
+	job.lines = analyze_read_log (log);
+	job.depth = depth;
+	if (num_workers <= 1)
+	{
+		analyze_worker (job.lines, depth, 0, 1, stdout);
+		return;
+	}
+	outs = analyze_fork_workers (num_workers, analyze_job, &job);
+	// worker i has every num_workers'th position starting from i, so we take turns
+	do
+	{
+		for (i=0, alive=0; i<num_workers; i++)
+			if (fgets (linebuf, sizeof (linebuf), outs[i]))
+			{
+				fputs (linebuf, stdout);
+				alive++;
+			}
+	} while (alive == num_workers);
+	for (i=0; i<num_workers; i++)
+		fclose (outs[i]);
+	free (outs);
+	fflush (stdout);
+}
@@ -0,0 +1,39 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _ANALYZE_H_
+#define _ANALYZE_H_
+
+#include <stdio.h>
+#include <glib.h>
+
+//! Analyzes every position of every game in the log and writes the results to stdout
+/** If depth is positive each position is searched to that depth, 
+  otherwise for time_per_move milliseconds. The work is split among 
+  num_workers processes. The current game must have been set with 
+  engine_set_game(). */
+void analyze_log (FILE *log, int depth, int num_workers);
+
+//! Runs work (worker, num_workers, fout, data) in num_workers child processes
+/** Each worker writes its results to its own temporary file. Returns
+  the files, rewound, once all the workers have exited. The caller must
+  fclose() them and free() the array. */
+FILE **analyze_fork_workers (int num_workers, 
+		void (*work) (int, int, FILE *, gpointer), gpointer data);
+
+#endif
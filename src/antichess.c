@@ -22,6 +22,7 @@
 
 #include "game.h"
 #include "../pixmaps/chess.xpm"
+#include "chessbb.h"
 
 
 #define ANTICHESS_CELL_SIZE 54
@@ -93,7 +94,6 @@ int antichess_getmove (Pos *, int, int, GtkboardEventType, Player, byte **, int
 ResultType antichess_who_won (Pos *, Player, char **);
 byte *antichess_movegen (Pos *);
 ResultType antichess_eval (Pos *, Player, float *);
-ResultType antichess_eval_incr (Pos *, Player, byte *, float *);
 	
 Game Antichess = 
 	{ ANTICHESS_CELL_SIZE, ANTICHESS_BOARD_WID, ANTICHESS_BOARD_HEIT, 
@@ -110,7 +110,7 @@ void antichess_init ()
 	game_who_won = antichess_who_won;
 	game_movegen = antichess_movegen;
 	game_eval = antichess_eval;
-//	game_eval_incr = antichess_eval_incr;
+	chessbb_init ();
 	game_file_label = FILERANK_LABEL_TYPE_ALPHA;
 	game_rank_label = FILERANK_LABEL_TYPE_NUM | FILERANK_LABEL_DESC;
 	game_highlight_colors = antichess_highlight_colors;
@@ -400,254 +400,37 @@ ResultType antichess_who_won (Pos *pos, Player player, char **commp)
 	}
 }
 
-int antichess_movegen_square (byte *pos, byte **movp, int player,
-		int oldx, int oldy, int x, int y)
-{
-	int val;
-	if (!ISINBOARD(x, y)) return 0;
-	val = pos [y * board_heit + x];
-	if ((player == WHITE && ANTICHESS_ISWHITE (val))
-		|| (player == BLACK && ANTICHESS_ISBLACK (val)))
-		return 0;
-	*(*movp)++ = oldx;
-	*(*movp)++ = oldy;
-	*(*movp)++ = 0;
-	*(*movp)++ = x;
-	*(*movp)++ = y;
-	*(*movp)++ = pos [oldy * board_heit + oldx];
-	*(*movp)++ = -1;
-	return 1;
-}
-
-int antichess_movegen_line (byte *pos, byte **movp, int player,
-		int x, int y, int incx, int incy)
-{
-	int oldx = x, oldy = y;
-	int capture = 0, val;
-	do
-	{
-		if (capture) return 1;
-		x += incx;
-		y += incy;
-		val = pos [y * board_heit + x];
-		if (ISINBOARD (x, y) && oppcolor (pos, oldx, oldy, x, y))
-			capture = 1;
-	} while (antichess_movegen_square (pos, movp, player, oldx, oldy, x, y));
-	return 0;
-}
-
-static void antichess_movegen_promote (byte *board, byte **movp, int player,
-		int oldx, int oldy, int x, int y)
-{
-	int i, j;
-	int promote_pieces[2][4] = {
-		{ANTICHESS_WQ, ANTICHESS_WR, ANTICHESS_WB, ANTICHESS_WN},
-		{ANTICHESS_BQ, ANTICHESS_BR, ANTICHESS_BB, ANTICHESS_BN}
-	};
-	i = (player == WHITE ? 0 : 1);
-	for(j=0; j<4; j++) 
-	{
-		*(*movp)++ = oldx;
-		*(*movp)++ = oldy;
-		*(*movp)++ = 0;
-		*(*movp)++ = x;
-		*(*movp)++ = y;
-		*(*movp)++ = promote_pieces[i][j];
-		*(*movp)++ = -1;
-	}
-}
-
 byte *antichess_movegen (Pos *pos)
 {
-	byte realbuf[4096];
-	byte *realp = realbuf;
 	byte movbuf[4096], *movp = movbuf;
-	byte *movlist;
-	int i, j, k, x, y, capture = 0;
-	int incxr[] = {0, 0, 1, -1};
-	int incyr[] = {1, -1, 0, 0};
-	int incxb[] = {1, 1, -1, -1};
-	int incyb[] = {1, -1, 1, -1};
-	int incxn[] = {2, 2, -2, -2, 1, 1, -1, -1};
-	int incyn[] = {1, -1, 1, -1, 2, -2, 2, -2};
-	byte *board = pos->board;
-	Player player = pos->player;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	{
-		int val = board[j * board_heit + i];
-		if ((player == WHITE && ANTICHESS_ISWHITE (val))
-			|| (player == BLACK && ANTICHESS_ISBLACK (val)))
+	byte *movlist, *move, *realp;
+	ChessBB bb;
+	gboolean capture = FALSE;
+	chessbb_from_board (&bb, pos->board);
+	movp = chessbb_movegen (&bb, pos->player, 0, -1, movp);
+
+	/* if there is a capture eliminate all other moves. Without castling 
+	   and en passant every move is 2 movelets long. */
+	for (move = movbuf; move < movp; move += 7)
+		if (pos->board [move[4] * board_wid + move[3]] != ANTICHESS_EMPTY)
 		{
-			switch (val)
-			{
-				case ANTICHESS_WP:
-					if (ISINBOARD (i, j+1) && board [(j+1) * board_heit + i] == 0)
-					{
-						if (j == board_heit - 2)
-							antichess_movegen_promote(board, &movp, player,
-								i, j, i, j+1);
-						else
-							antichess_movegen_square (board, &movp, player,
-								i, j, i, j+1);
-					}
-					if (ISINBOARD (i+1, j+1) && 
-							ANTICHESS_ISBLACK (board [(j+1) * board_heit + i+1]))
-					{
-						if (j == board_heit - 2)
-							antichess_movegen_promote (board, &movp, player,
-								i, j, i+1, j+1);
-						else
-							antichess_movegen_square (board, &movp, player,
-								i, j, i+1, j+1);
-						capture ++;
-					}
-					if (ISINBOARD (i-1, j+1) && 
-							ANTICHESS_ISBLACK (board [(j+1) * board_heit + i-1]))
-					{
-						if (j == board_heit - 2)
-							antichess_movegen_promote (board, &movp, player,
-								i, j, i-1, j+1);
-						else
-							antichess_movegen_square (board, &movp, player,
-								i, j, i-1, j+1);
-						capture ++;
-					}
-					if (j == 1 && board [2 * board_heit + i] == 0
-							&& board [3 * board_heit + i] == 0)
-						antichess_movegen_square (board, &movp, player,
-								i, j, i, j+2);
-					break;
-				case ANTICHESS_BP:
-					if (ISINBOARD (i, j-1) && board [(j-1) * board_heit + i] == 0)
-					{
-						if (j == 1)
-							antichess_movegen_promote (board, &movp, player,
-								i, j, i, j-1);
-						else
-							antichess_movegen_square (board, &movp, player,
-								i, j, i, j-1);
-					}
-					if (ISINBOARD (i+1, j-1) && 
-							ANTICHESS_ISWHITE (board [(j-1) * board_heit + i+1]))
-					{
-						if (j == 1)
-							antichess_movegen_promote (board, &movp, player,
-								i, j, i+1, j-1);
-						else
-							antichess_movegen_square (board, &movp, player,
-								i, j, i+1, j-1);
-						capture ++;
-					}
-					if (ISINBOARD (i-1, j-1) && 
-							ANTICHESS_ISWHITE (board [(j-1) * board_heit + i-1]))
-					{
-						if (j == 1)
-							antichess_movegen_promote (board, &movp, player,
-								i, j, i-1, j-1);
-						else
-							antichess_movegen_square (board, &movp, player,
-								i, j, i-1, j-1);
-						capture ++;
-					}
-					if (j == 6 && board [5 * board_heit + i] == 0
-							&& board [4 * board_heit + i] == 0)
-						antichess_movegen_square (board, &movp, player,
-								i, j, i, j-2);
-					break;
-				case ANTICHESS_WK:
-				case ANTICHESS_BK:
-					for (k=0; k<4; k++)
-					{
-						antichess_movegen_square(board, &movp, player, 
-								i, j, i + incxr[k], j + incyr[k]);
-						if (ISINBOARD(i + incxr[k], j + incyr[k]) 
-								&& oppcolor (board, i, j, i+incxr[k], j+incyr[k]))
-							capture ++;
-					}
-					for (k=0; k<4; k++)
-					{
-						antichess_movegen_square(board, &movp, player, 
-								i, j, i + incxb[k], j + incyb[k]);
-						if (ISINBOARD(i + incxb[k], j + incyb[k]) 
-								&& oppcolor (board, i, j, i+incxb[k], j+incyb[k]))
-							capture ++;
-					}
-					break;
-				case ANTICHESS_WB:
-				case ANTICHESS_BB:
-					for (k=0; k<4; k++)
-						capture += antichess_movegen_line (board, &movp, player, 
-								i, j, incxb[k], incyb[k]);
-					break;
-				case ANTICHESS_WR:
-				case ANTICHESS_BR:
-					for (k=0; k<4; k++)
-						capture += antichess_movegen_line (board, &movp, player, 
-								i, j, incxr[k], incyr[k]);
-					break;
-				case ANTICHESS_WQ:
-				case ANTICHESS_BQ:
-					for (k=0; k<4; k++)
-						capture += antichess_movegen_line (board, &movp, player, 
-								i, j, incxb[k], incyb[k]);
-					for (k=0; k<4; k++)
-						capture += antichess_movegen_line (board, &movp, player, 
-								i, j, incxr[k], incyr[k]);
-					break;
-				case ANTICHESS_WN:
-				case ANTICHESS_BN:
-					for (k=0; k<8; k++)
-					{
-						antichess_movegen_square(board, &movp, player, 
-								i, j, i + incxn[k], j + incyn[k]);
-						if (ISINBOARD(i + incxn[k], j + incyn[k]) 
-								&& oppcolor (board, i, j, i+incxn[k], j+incyn[k]))
-							capture ++;
-					}
-					break;
-			}
-		}
-	}
-	*movp++ = -2;
-
-	/* if there is a capture eliminate all other moves */
-	if (!capture)
-	{
-		movlist = (byte *) malloc (movp - movbuf);
-		memcpy (movlist, movbuf, movp - movbuf);
-		return movlist;
-	}
-	movp = movbuf;
-	realp = realbuf;
-	while (1)
-	{
-		byte *tmp;
-		int w = 0, b = 0;
-		if (*movp == -2)
+			capture = TRUE;
 			break;
-		/* a capture is a move that involves a W as well as a B piece */
-		for (tmp = movp; *tmp != -1; tmp += 3)
-		{
-			if (ANTICHESS_ISWHITE (board [tmp[1] * board_heit + tmp[0]]))	w = 1;
-			if (ANTICHESS_ISBLACK (board [tmp[1] * board_heit + tmp[0]]))	b = 1;
 		}
-		if (w && b)
+	if (capture)
+	{
+		for (move = realp = movbuf; move < movp; move += 7)
 		{
-			while (*movp != -1)
-			{
-				*realp++ = *movp++;
-				*realp++ = *movp++;
-				*realp++ = *movp++;
-			}
-			*realp++ = *movp++;
+			if (pos->board [move[4] * board_wid + move[3]] == ANTICHESS_EMPTY)
+				continue;
+			memmove (realp, move, 7);
+			realp += 7;
 		}
-		else 
-			movp = tmp+1;
+		movp = realp;
 	}
-	*realp++ = -2;
-	movlist = (byte *) malloc (realp - realbuf);
-	memcpy (movlist, realbuf, realp - realbuf);
+	*movp++ = -2;
+	movlist = (byte *) malloc (movp - movbuf);
+	memcpy (movlist, movbuf, movp - movbuf);
 	return movlist;
 }
 
@@ -713,25 +496,6 @@ ResultType antichess_eval (Pos * pos, Player player, float *eval)
 	return RESULT_NOTYET;
 }
 
-ResultType antichess_eval_incr (Pos *pos, Player player, byte *move, float *eval)
-	// check if there's a capture
-{
-	byte *board = pos->board;
-	if (player == WHITE)
-	{
-		if (move[2] && board[move[1] * board_wid + move[0]]) *eval = -1;
-		else if (move[5] && board[move[4] * board_wid + move[3]]) return -1;
-		else *eval = 0;
-	}
-	else
-	{
-		if (move[2] && board[move[1] * board_wid + move[0]]) *eval = 1;
-		else if (move[5] && board[move[4] * board_wid + move[3]]) *eval = 1;
-		else *eval = 0;
-	}
-	return RESULT_NOTYET;
-}
-
 // Local Variables:
 // tab-width: 4
 // End:
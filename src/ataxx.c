@@ -23,6 +23,7 @@
 
 #include "game.h"
 #include "aaball.h"
+#include "ataxxbb.h"
 
 #define ATAXX_CELL_SIZE 55
 #define ATAXX_NUM_PIECES 2
@@ -34,7 +35,10 @@
 #define ATAXX_WP 1
 #define ATAXX_BP 2
 
-#define ATAXX_MOVEGEN_PLAUSIBLE 1
+/* Define this to generate only the moves that flip at least one ball
+   less than the best move to a neighbouring square. This makes the
+   search faster, but it can miss good jumps. */
+/* #define ATAXX_MOVEGEN_PLAUSIBLE */
 
 static char ataxx_colors[6] = {140, 160, 140, 200, 200, 200};
 
@@ -56,6 +60,7 @@ Game Ataxx = { ATAXX_CELL_SIZE, ATAXX_BOARD_WID, ATAXX_BOARD_HEIT,
 	ataxx_colors, ataxx_init_pos, NULL, "Ataxx", NULL, ataxx_init};
 
 ResultType ataxx_eval (Pos *, Player, float *);
+extern HeurTab ataxx_heurtab[];
 byte *ataxx_movegen (Pos *);
 
 static int ataxx_getmove (Pos *, int, int, GtkboardEventType, Player, byte **, int **);
@@ -69,9 +74,11 @@ static int ataxx_max_moves = 200;
 void ataxx_init ()
 {
 	game_eval = ataxx_eval;
+	game_htab = ataxx_heurtab;
 	game_movegen = ataxx_movegen;
 	game_getmove = ataxx_getmove;
 	game_who_won = ataxx_who_won;
+	ataxxbb_init ();
 	game_get_rgbmap = ataxx_get_rgbmap;
 	game_white_string = "Red";
 	game_black_string = "Blue";
@@ -97,17 +104,14 @@ void ataxx_init ()
 ResultType ataxx_who_won (Pos *pos, Player to_play, char **commp)
 {
 	static char comment[32];
-	int i, wscore = 0, bscore = 0, who_idx;
+	int wscore, bscore, who_idx;
 	char *who_str [3] = { "Red won", "Blue won", "its a tie" };
-	byte *move = ataxx_movegen (pos);
-	for (i=0; i<board_wid * board_heit; i++)
-		if (pos->board[i] == ATAXX_WP)
-			wscore++;
-		else if (pos->board[i] == ATAXX_BP)
-			bscore++;
-	if (move[0] != -2)
+	guint64 white, black;
+	ataxxbb_from_board (pos->board, &white, &black);
+	wscore = ataxxbb_count (white);
+	bscore = ataxxbb_count (black);
+	if (pos->player == WHITE ? ataxxbb_can_move (white, black) : ataxxbb_can_move (black, white))
 	{
-		free (move);
 		if (pos->num_moves > ataxx_max_moves)
 		{
 			fprintf (stderr, "max moves reached\n");
@@ -122,7 +126,6 @@ ResultType ataxx_who_won (Pos *pos, Player to_play, char **commp)
 			return RESULT_NOTYET;
 		}
 	}
-	free (move);
 	if (wscore > bscore) who_idx = 0;
 	else if (wscore < bscore) who_idx = 1;
 	else who_idx = 2;
@@ -138,13 +141,11 @@ ResultType ataxx_who_won (Pos *pos, Player to_play, char **commp)
 
 ResultType ataxx_eval (Pos *pos, Player to_play, float *eval)
 {
-	int i;
 	int wcount, bcount;
-	for (i=0, wcount=0, bcount=0; i<board_wid*board_heit; i++)
-	{
-		if (pos->board[i] == ATAXX_WP) wcount++;
-		if (pos->board[i] == ATAXX_BP) bcount++;
-	}
+	guint64 white, black;
+	ataxxbb_from_board (pos->board, &white, &black);
+	wcount = ataxxbb_count (white);
+	bcount = ataxxbb_count (black);
 	*eval = wcount-bcount;
 	if (!wcount || !bcount) *eval *= GAME_EVAL_INFTY;
 	if (!wcount) return RESULT_BLACK;
@@ -152,167 +153,53 @@ ResultType ataxx_eval (Pos *pos, Player to_play, float *eval)
 	return RESULT_NOTYET;
 }
 
+static float ataxx_heur_material (Pos *pos, int player)
+{
+	float eval;
+	ataxx_eval (pos, player, &eval);
+	return eval;
+}
+
+//! Material, less a quarter for each ball next to an empty square
+static float ataxx_heur_exposure (Pos *pos, int player)
+{
+	guint64 white, black, near_empty;
+	float eval;
+	if (ataxx_eval (pos, player, &eval) != RESULT_NOTYET)
+		return eval;
+	ataxxbb_from_board (pos->board, &white, &black);
+	near_empty = ataxxbb_near (ataxxbb_squares () & ~(white | black));
+	return eval - 0.25 * (ataxxbb_count (white & near_empty) 
+			- ataxxbb_count (black & near_empty));
+}
+
+HeurTab ataxx_heurtab[] = 
+{
+	{ "material", ataxx_heur_material, "number of balls", NULL },
+	{ "exposure", ataxx_heur_exposure, "number of balls, less the ones that can be taken back", NULL },
+	{ NULL, NULL, NULL, NULL },
+};
+
 byte *ataxx_movegen (Pos *pos)
-	/* to keep things from getting out of hand, we'll generate only 
-	   _plausible_ moves: find the max #flips possible and generate
-	   only those moves that lead to at least max-1 flips */
 {
-	int incx[] = { -1, -1, -1, 0, 0, 1, 1, 1};
-	int incy[] = { -1, 0, 1, -1, 1, -1, 0, 1};
-	int incx2[] = { -2, -2, -2, -2, -2, -1, -1, 0, 0, 1, 1, 2, 2, 2, 2, 2};
-	int incy2[] = { -2, -1, 0, 1, 2, -2, 2, -2, 2, -2, 2, -2, -1, 0, 1, 2};
-	int x, y, i, j, newx, newy;
-	Player player = pos->player;
-	byte our = (player == WHITE ? ATAXX_WP : ATAXX_BP);
-	byte other = (player == WHITE ? ATAXX_BP : ATAXX_WP);
-	byte *board = pos->board;
-#ifdef ATAXX_MOVEGEN_PLAUSIBLE
-	int max_nbrs;
-#endif
-	int found = 0;
-	byte movbuf [4096];
+	byte movbuf [16384];
 	byte *movp = movbuf;
 	byte *movlist;
-	byte *nbrs;
-   	nbrs = (byte *) malloc (board_wid * board_heit * sizeof (byte));
-	assert (nbrs);
-	for (i=0; i<board_wid * board_heit; i++)
-		nbrs[i] = 0;
-	for (x=0; x<board_wid; x++)
-		for (y=0; y<board_heit; y++)
-		{
-			if (board [y * board_wid + x] != other)
-				continue;
-			for (i=0; i<8; i++)
-			{
-				newx = x + incx[i];
-				newy = y + incy[i];
-				if (newx >= 0 && newy >= 0 
-						&& newx < board_wid && newy < board_heit)
-					nbrs [newy * board_wid + newx] ++;
-			}
-		}
+	guint64 white, black, own, opp;
+	int min_flips = 0;
+	ataxxbb_from_board (pos->board, &white, &black);
+	own = pos->player == WHITE ? white : black;
+	opp = pos->player == WHITE ? black : white;
 #ifdef ATAXX_MOVEGEN_PLAUSIBLE
-	max_nbrs=0;
-	for (x=0; x<board_wid; x++)
-		for (y=0; y<board_heit; y++)
-		if (board[y * board_wid + x] == ATAXX_EMPTY 
-				&& nbrs[y * board_wid + x] > max_nbrs)
-		{
-			found=0;
-			for (j=0; j<8; j++)
-			{
-				newx = x + incx[j];
-				newy = y + incy[j];
-				if (newx >= 0 && newy >= 0 
-						&& newx < board_wid && newy < board_heit
-						&& board [newy * board_wid + newx] == our)
-				{
-					max_nbrs = nbrs[y * board_wid + x];
-					found=1;
-					break;
-				}
-			}
-			/*if (found) continue;
-			nbrs [y * board_wid + x]--;
-			if (nbrs[y * board_wid + x] <= max_nbrs) continue;
-			for (j=0; j<16; j++)
-			{
-				newx = x + incx2[j];
-				newy = y + incy2[j];
-				if (newx >= 0 && newy >= 0 
-						&& newx < board_wid && newy < board_heit
-						&& board [newy * board_wid + newx] == our)
-				{
-					max_nbrs = nbrs[y * board_wid + x];
-					break;
-				}
-			}*/
-		} 
+	min_flips = ataxxbb_max_flips (own, opp) - 1;
 #endif
-	for (x=0; x<board_wid; x++)
-		for (y=0; y<board_heit; y++)
-		{
-			found=0;
-			if (board [y * board_wid + x] != ATAXX_EMPTY)
-				continue;
-#ifdef ATAXX_MOVEGEN_PLAUSIBLE
-			if (nbrs [y * board_wid + x] < max_nbrs - 1)
-				continue;
-#endif
-			for (i=0; i<8; i++)
-			{
-				newx = x + incx[i];
-				newy = y + incy[i];
-				if (newx >= 0 && newy >= 0 
-						&& newx < board_wid && newy < board_heit)
-					if (board [newy * board_wid + newx] == our)
-					{
-						/* found a same col neighbor */
-						found=1;
-						break;
-					}
-			}
-			if (found)
-			{
-				*movp++ = x;
-				*movp++ = y;
-				*movp++ = our;
-				for (i=0; i<8; i++)
-				{
-					newx = x + incx[i];
-					newy = y + incy[i];
-					if (newx >= 0 && newy >= 0 
-							&& newx < board_wid && newy < board_heit)
-						if (board [newy * board_wid + newx] == other)
-						{
-							*movp++ = newx;
-							*movp++ = newy;
-							*movp++ = our;
-						}
-				}
-				*movp++ = -1;
-			}	
-			else
-			{
-				for (i=0; i<16; i++)
-				{
-					newx = x + incx2[i];
-					newy = y + incy2[i];
-					if (!(newx >= 0 && newy >= 0 
-							&& newx < board_wid && newy < board_heit))
-						continue;
-					if (board [newy * board_wid + newx] != our)
-						continue;
-					*movp++ = x;
-					*movp++ = y;
-					*movp++ = our;
-					*movp++ = newx;
-					*movp++ = newy;
-					*movp++ = ATAXX_EMPTY;
-					for (j=0; j<8; j++)
-					{
-						newx = x + incx[j];
-						newy = y + incy[j];
-						if (newx >= 0 && newy >= 0 
-								&& newx < board_wid && newy < board_heit)
-							if (board [newy * board_wid + newx] == other)
-							{
-								*movp++ = newx;
-								*movp++ = newy;
-								*movp++ = our;
-							}
-					}
-					*movp++ = -1;
-				}
-			}
-		}
+	movp = ataxxbb_movegen (own, opp, pos->player == WHITE ? ATAXX_WP : ATAXX_BP, 
+			min_flips, movp);
+	assert (movp - movbuf < sizeof (movbuf));
 	*movp++ = -2;
 	movlist = (byte *) (malloc (movp - movbuf));
 	memcpy (movlist, movbuf, (movp - movbuf));
-	free (nbrs);
 	return movlist;
-	
 }
 
 static int  oldx = -1, oldy = -1;
@@ -0,0 +1,181 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "game.h"
+#include "ataxxbb.h"
+
+/** \file ataxxbb.c
+  \brief Bitboards and move generation for Ataxx.
+  */
+
+#define ATAXXBB_SIZE 7
+
+//! The squares of the board: the first 7 bits of each of the first 7 bytes
+#define SQUARES G_GUINT64_CONSTANT(0x007f7f7f7f7f7f7f)
+
+//! The squares next to each square
+static guint64 ring1 [64];
+//! The squares at distance exactly two from each square
+static guint64 ring2 [64];
+
+void ataxxbb_init ()
+{
+	int sq, x, y, dx, dy;
+	for (sq=0; sq<64; sq++)
+	{
+		ring1 [sq] = ring2 [sq] = 0;
+		x = sq % 8;
+		y = sq / 8;
+		if (x >= ATAXXBB_SIZE || y >= ATAXXBB_SIZE)
+			continue;
+		for (dx=-2; dx<=2; dx++)
+			for (dy=-2; dy<=2; dy++)
+			{
+				if (x + dx < 0 || x + dx >= ATAXXBB_SIZE || y + dy < 0 || y + dy >= ATAXXBB_SIZE)
+					continue;
+				if (abs (dx) == 2 || abs (dy) == 2)
+					ring2 [sq] |= ATAXXBB_BIT (x + dx, y + dy);
+				else if (dx || dy)
+					ring1 [sq] |= ATAXXBB_BIT (x + dx, y + dy);
+			}
+	}
+}
+
+void ataxxbb_from_board (byte *board, guint64 *white, guint64 *black)
+{
+	int x, y;
+	*white = *black = 0;
+	assert (board_wid == ATAXXBB_SIZE && board_heit == ATAXXBB_SIZE);
+	for (y=0; y<ATAXXBB_SIZE; y++)
+		for (x=0; x<ATAXXBB_SIZE; x++)
+		{
+			// the values of ATAXX_WP and ATAXX_BP
+			if (board [y * ATAXXBB_SIZE + x] == 1)
+				*white |= ATAXXBB_BIT (x, y);
+			else if (board [y * ATAXXBB_SIZE + x] == 2)
+				*black |= ATAXXBB_BIT (x, y);
+		}
+}
+
+guint64 ataxxbb_squares ()
+{
+	return SQUARES;
+}
+
+guint64 ataxxbb_near (guint64 b)
+{
+	guint64 row = b | (b << 1) | (b >> 1);
+	return (row | (row << 8) | (row >> 8)) & SQUARES & ~b;
+}
+
+gboolean ataxxbb_can_move (guint64 own, guint64 opp)
+{
+	guint64 near = ataxxbb_near (own) | own;
+	return ((near | ataxxbb_near (near)) & ~(own | opp)) != 0;
+}
+
+int ataxxbb_count (guint64 b)
+{
+	b = b - ((b >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+	b = (b & G_GUINT64_CONSTANT(0x3333333333333333)) 
+		+ ((b >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+	b = (b + (b >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+	return (int) ((b * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56);
+}
+
+static int bb_first (guint64 b)
+{
+	int n = 0;
+	if (!(b & G_GUINT64_CONSTANT(0xffffffff))) { n += 32; b >>= 32; }
+	if (!(b & 0xffff)) { n += 16; b >>= 16; }
+	if (!(b & 0xff)) { n += 8; b >>= 8; }
+	if (!(b & 0xf)) { n += 4; b >>= 4; }
+	if (!(b & 0x3)) { n += 2; b >>= 2; }
+	if (!(b & 0x1)) n += 1;
+	return n;
+}
+
+static byte *write_move (byte *movp, int to, int from, guint64 flips, int val)
+{
+	*movp++ = to % 8;
+	*movp++ = to / 8;
+	*movp++ = val;
+	if (from >= 0)
+	{
+		*movp++ = from % 8;
+		*movp++ = from / 8;
+		*movp++ = 0;
+	}
+	for (; flips; flips &= flips - 1)
+	{
+		int sq = bb_first (flips);
+		*movp++ = sq % 8;
+		*movp++ = sq / 8;
+		*movp++ = val;
+	}
+	*movp++ = -1;
+	return movp;
+}
+
+int ataxxbb_max_flips (guint64 own, guint64 opp)
+{
+	guint64 b;
+	int max = 0;
+	for (b = ataxxbb_near (own) & ~opp; b; b &= b - 1)
+	{
+		int flips = ataxxbb_count (ring1 [bb_first (b)] & opp);
+		if (flips > max)
+			max = flips;
+	}
+	return max;
+}
+
+byte *ataxxbb_movegen (guint64 own, guint64 opp, int val, int min_flips, byte *movp)
+{
+	guint64 empty = SQUARES & ~(own | opp), near, b;
+	// the target squares, by the number of balls they would flip
+	guint64 by_flips [9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+	int flips;
+	near = ataxxbb_near (own) | own;
+	for (b = (near | ataxxbb_near (near)) & empty; b; b &= b - 1)
+	{
+		int to = bb_first (b);
+		by_flips [ataxxbb_count (ring1 [to] & opp)] |= G_GUINT64_CONSTANT(1) << to;
+	}
+	// a clone gains one ball more than a jump with the same flips
+	for (flips = 8; flips >= min_flips && flips >= 0; flips--)
+	{
+		for (b = by_flips [flips] & near; b; b &= b - 1)
+		{
+			int to = bb_first (b);
+			movp = write_move (movp, to, -1, ring1 [to] & opp, val);
+		}
+		for (b = by_flips [flips]; b; b &= b - 1)
+		{
+			int to = bb_first (b);
+			guint64 from;
+			for (from = ring2 [to] & own; from; from &= from - 1)
+				movp = write_move (movp, to, bb_first (from), ring1 [to] & opp, val);
+		}
+	}
+	return movp;
+}
@@ -0,0 +1,66 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _ATAXXBB_H_
+#define _ATAXXBB_H_
+
+#include "game.h"
+
+/** \file ataxxbb.h
+  \brief Bitboards for Ataxx.
+
+  Square (x, y) of the 7x7 board is bit y * 8 + x. The eighth bit of each
+  rank is never set, so that shifting by one square can't wrap from one
+  rank to the next.
+  */
+
+#define ATAXXBB_BIT(x, y) (G_GUINT64_CONSTANT(1) << ((y) * 8 + (x)))
+
+//! Builds the neighbourhood masks. Must be called before the other functions.
+void ataxxbb_init ();
+
+//! Makes bitboards of the white and the black balls of a board in the format of Pos::board
+void ataxxbb_from_board (byte *board, guint64 *white, guint64 *black);
+
+//! The squares of the board
+guint64 ataxxbb_squares ();
+
+//! The squares next to the ones in b, diagonals included
+guint64 ataxxbb_near (guint64 b);
+
+//! Can own make any move
+gboolean ataxxbb_can_move (guint64 own, guint64 opp);
+
+//! Number of bits set
+int ataxxbb_count (guint64 b);
+
+//! The most balls of opp that a ball of own put next to one of own can flip
+int ataxxbb_max_flips (guint64 own, guint64 opp);
+
+//! Writes the moves of own, with balls of value val, each terminated by -1
+/** A move to an empty square next to a ball of own is written once, as
+  the new ball followed by the balls it flips; a jump of two squares is
+  written as the new ball, the square left empty, and the flips. The
+  moves come in decreasing order of the number of balls they flip, and
+  for the same number the moves to a neighbouring square first. If
+  min_flips is positive only moves flipping at least min_flips balls are
+  written. Returns a pointer past the last move; the list is not
+  terminated by -2. */
+byte *ataxxbb_movegen (guint64 own, guint64 opp, int val, int min_flips, byte *movp);
+
+#endif
@@ -0,0 +1,202 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "move.h"
+#include "stack.h"
+#include "engine.h"
+#include "bench.h"
+
+/** \file bench.c
+  \brief A fixed set of positions for measuring the speed of the search.
+
+  Each position is searched to a fixed depth with a fixed random seed,
+  so the node counts depend only on the code. The total node count,
+  printed as the signature at the end, changes only when the search or
+  the movegen/eval of some game changes.
+  */
+
+extern Pos cur_pos;
+extern Game *opt_game;
+extern int ab_max_depth;
+extern void (*ab_iter_cb) (Pos *, int, float, byte *, int);
+extern void hash_get_stats (int *, int *);
+extern gboolean engine_flag;
+
+typedef struct
+{
+	//! Name of the game
+	char *game;
+	//! Search depth in ply
+	int depth;
+	//! Moves from the initial position, written as by engine_write_move_token()
+	char *moves;
+} BenchPos;
+
+static BenchPos bench_positions[] = 
+{
+	{ "Chess", 6, "" },
+	{ "Chess", 5, "5,2,0,5,4,6 5,7,0,5,5,12 7,1,0,6,3,5 2,8,0,3,6,11 6,1,0,3,4,4 "
+		"6,8,0,3,5,10 3,2,0,3,3,6 7,8,0,6,6,11 4,2,0,4,3,6 4,7,0,4,6,12" },
+	{ "Chess", 5, "4,2,0,4,4,6 4,7,0,4,5,12 3,2,0,3,4,6 5,7,0,5,6,12 2,1,0,3,3,5 "
+		"7,8,0,6,6,11 3,1,0,7,5,4 6,8,0,5,7,10 5,2,0,5,3,6 2,8,0,4,7,11 "
+		"7,1,0,6,3,5 8,7,0,8,6,12 7,5,0,8,4,4" },
+	{ "Othello", 9, "" },
+	{ "Othello", 8, "4,5,1,3,5,1 4,4,2,3,4,2 4,4,1,4,3,1 4,3,2,3,2,2 5,4,1,6,4,1 "
+		"4,5,2,4,4,2,4,6,2" },
+	{ "Othello", 8, "4,5,1,3,5,1 4,4,2,3,4,2 4,4,1,4,3,1 4,3,2,3,2,2 5,4,1,6,4,1 "
+		"4,5,2,4,4,2,4,6,2 4,4,1,5,3,1 6,4,2,5,4,2,4,4,2,7,4,2 6,4,1,7,3,1 "
+		"5,5,2,6,5,2 5,5,1,5,4,1,5,6,1 5,3,2,5,4,2,6,4,2,6,3,2 7,4,1,6,5,1,8,3,1 "
+		"7,4,2,8,5,2 5,3,1,4,4,1,6,3,1,6,4,1,6,2,1 6,5,2,5,5,2,7,5,2" },
+	{ "Ataxx", 5, "" },
+	{ "Ataxx", 5, "1,6,1 1,2,2 2,6,1 2,1,2 2,7,1 2,2,2" },
+	{ "Ataxx", 5, "1,6,1 1,2,2 2,6,1 2,1,2 2,7,1 2,2,2 3,6,1 3,1,2 3,7,1 3,2,2 "
+		"7,2,1 7,6,2 1,5,1 1,4,2,1,2,0,1,5,2 2,5,1,1,4,1,1,5,1 "
+		"2,4,2,2,2,0,1,4,2,1,5,2,2,5,2" },
+	{ "Checkers", 10, "" },
+	{ "Checkers", 10, "7,3,0,8,4,2 8,6,0,7,5,4 6,2,0,7,3,2 7,7,0,8,6,4 7,1,0,6,2,2 "
+		"2,6,0,1,5,4" },
+	{ "Checkers", 10, "7,3,0,8,4,2 8,6,0,7,5,4 6,2,0,7,3,2 7,7,0,8,6,4 7,1,0,6,2,2 "
+		"2,6,0,1,5,4 1,3,0,2,4,2 1,7,0,2,6,4 2,2,0,1,3,2 2,6,0,3,5,4 1,1,0,2,2,2 "
+		"3,7,0,2,6,4 7,3,0,6,4,2 2,8,0,1,7,4 8,2,0,7,3,2 4,8,0,3,7,4" },
+	{ "Antichess", 7, "" },
+	{ "Antichess", 7, "5,2,0,5,3,6 2,7,0,2,5,12 6,1,0,2,5,4 3,8,0,1,6,10 "
+		"2,5,0,1,6,4 2,8,0,1,6,11" },
+	{ "Breakthrough", 6, "" },
+	{ "Breakthrough", 6, "8,3,1,8,2,0 8,6,2,8,7,0 8,2,1,8,1,0 1,6,2,1,7,0 6,3,1,6,2,0 "
+		"4,6,2,4,7,0" },
+	{ "Breakthrough", 6, "8,3,1,8,2,0 8,6,2,8,7,0 8,2,1,8,1,0 1,6,2,1,7,0 6,3,1,6,2,0 "
+		"4,6,2,4,7,0 7,3,1,7,2,0 1,7,2,1,8,0 5,3,1,5,2,0 3,6,2,3,7,0 7,2,1,7,1,0 "
+		"2,6,2,2,7,0 4,3,1,4,2,0 2,5,2,2,6,0 5,2,1,5,1,0 2,7,2,2,8,0" },
+	{ "Pentaline", 4, "6,7,1 5,6,2 4,6,1 3,5,2 2,5,1 3,7,2" },
+	{ "Pentaline", 4, "6,7,1 5,6,2 4,6,1 3,5,2 2,5,1 3,7,2 3,8,1 2,7,2 4,4,1 4,3,2 "
+		"3,2,1 2,2,2 2,3,1 5,2,2 3,4,1 2,4,2" },
+	{ "Plot 4", 10, "" },
+	{ "Plot 4", 10, "1,1,1 1,2,2 1,3,1 1,4,2 1,5,1 3,1,2" },
+	{ "Plot 4", 10, "1,1,1 1,2,2 1,3,1 1,4,2 1,5,1 3,1,2 3,2,1 3,3,2 3,4,1 3,5,2 "
+		"3,6,1 4,1,2 4,2,1 4,3,2 4,4,1 4,5,2" },
+	{ "Quarto", 4, "4,3,5 4,2,6 2,4,9 1,4,12 2,2,10 1,1,14" },
+	{ "Stopgate", 5, "" },
+	{ "Stopgate", 5, "2,3,1,2,4,2 1,8,3,2,8,4 8,3,1,8,4,2 1,6,3,2,6,4 4,3,1,4,4,2 "
+		"5,2,3,6,2,4" },
+	{ "Stopgate", 5, "2,3,1,2,4,2 1,8,3,2,8,4 8,3,1,8,4,2 1,6,3,2,6,4 4,3,1,4,4,2 "
+		"5,2,3,6,2,4 6,3,1,6,4,2 3,8,3,4,8,4 8,1,1,8,2,2 3,6,3,4,6,4 8,8,1,8,9,2 "
+		"1,2,3,2,2,4 6,8,1,6,9,2 8,6,3,9,6,4 3,1,1,3,2,2 5,6,3,6,6,4" },
+	{ "Balanced Joust", 8, "" },
+	{ "Balanced Joust", 8, "7,1,1,5,2,2 1,7,1,2,5,3 5,2,1,3,3,2 2,5,1,4,4,3 3,3,1,4,5,2 "
+		"4,4,1,2,3,3" },
+	{ "Infiltrate", 7, "" },
+	{ "Infiltrate", 7, "1,1,0,2,2,1 1,4,0,2,3,2 2,1,0,3,2,1 1,5,0,2,4,2 2,2,0,1,3,1 "
+		"2,4,0,3,3,2" },
+	{ "Infiltrate", 7, "1,1,0,2,2,1 1,4,0,2,3,2 2,1,0,3,2,1 1,5,0,2,4,2 2,2,0,1,3,1 "
+		"2,4,0,3,3,2 1,3,0,2,4,1 2,5,0,1,4,2 2,4,0,1,5,1 3,3,0,2,2,2 3,1,0,4,2,1 "
+		"2,2,0,1,1,2 3,2,0,4,3,1 2,3,0,3,2,2 1,2,0,2,3,1 3,2,0,2,1,2" },
+	{ NULL, 0, NULL }
+};
+
+//! Nodes and hash statistics at the end of the last completed iteration
+static int bench_nodes, bench_probes, bench_hits;
+
+static void bench_iter_cb (Pos *pos, int depth, float val, byte *best_move, int nodes)
+{
+	bench_nodes = nodes;
+	hash_get_stats (&bench_probes, &bench_hits);
+}
+
+//! Sets up cur_pos. Returns FALSE if one of the moves is illegal.
+static gboolean bench_set_position (BenchPos *bpos)
+{
+	char *moves = g_strdup (bpos->moves), *token;
+	gboolean ok = TRUE;
+	engine_set_game (engine_find_game (bpos->game));
+	engine_reset_game ();
+	for (token = strtok (moves, " "); token && ok; token = strtok (NULL, " "))
+	{
+		byte *move = movdup (engine_read_move_token (token));
+		byte *movlist = game_movegen (&cur_pos);
+		ok = movlist_contains (movlist, move);
+		if (ok)
+		{
+			movstack_trunc ();
+			engine_apply_move (move);
+		}
+		free (movlist);
+		free (move);
+	}
+	g_free (moves);
+	return ok;
+}
+
+long bench_run (Game *game, int depth)
+{
+	BenchPos *bpos;
+	GTimer *timer = g_timer_new ();
+	gulong micro_sec;
+	long total_nodes = 0;
+	double total_secs = 0;
+	int total_probes = 0, total_hits = 0, num = 0;
+	engine_flag = TRUE;
+	ab_iter_cb = bench_iter_cb;
+	for (bpos = bench_positions; bpos->game; bpos++)
+	{
+		double secs;
+		byte *move;
+		if (game && strcmp (game->name, bpos->game))
+			continue;
+		// some games use random() in the movegen and eval
+		srandom (1);
+		if (!bench_set_position (bpos))
+		{
+			fprintf (stderr, "bench: illegal move in position %d of %s\n", 
+					(int) (bpos - bench_positions), bpos->game);
+			exit (1);
+		}
+		srandom (1);
+		ab_max_depth = depth > 0 ? depth : bpos->depth;
+		bench_nodes = bench_probes = bench_hits = 0;
+		g_timer_start (timer);
+		move = engine_search_timed (&cur_pos, 0);
+		secs = g_timer_elapsed (timer, &micro_sec);
+		printf ("%-16s %3d  depth %2d  nodes %10d  time %6d  nps %8d  tthits %5.1f%%  bestmove ",
+				bpos->game, num++, ab_max_depth, bench_nodes, (int) (secs * 1000),
+				secs > 0 ? (int) (bench_nodes / secs) : 0,
+				bench_probes ? 100.0 * bench_hits / bench_probes : 0.0);
+		if (move)
+			engine_write_move_token (move, stdout);
+		else
+			printf ("(none)");
+		printf ("\n");
+		fflush (stdout);
+		total_nodes += bench_nodes;
+		total_secs += secs;
+		total_probes += bench_probes;
+		total_hits += bench_hits;
+	}
+	ab_iter_cb = NULL;
+	ab_max_depth = 0;
+	g_timer_destroy (timer);
+	printf ("total nodes %ld  time %d  nps %d  tthits %.1f%%\n", total_nodes, 
+			(int) (total_secs * 1000), total_secs > 0 ? (int) (total_nodes / total_secs) : 0,
+			total_probes ? 100.0 * total_hits / total_probes : 0.0);
+	printf ("signature %ld\n", total_nodes);
+	return total_nodes;
+}
@@ -0,0 +1,28 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+//! Searches the benchmark positions and prints nodes, speed and hash hits
+/** If game is not NULL only its positions are searched. If depth is
+  positive it overrides the depth of every position. Returns the total
+  number of nodes, which is the signature of the run. */
+long bench_run (Game *game, int depth);
+
+#endif
@@ -0,0 +1,351 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+/** \file book.c
+  \brief Opening books.
+  */
+
+#include "config.h"
+
+#include "game.h"
+#include "move.h"
+#include "stack.h"
+#include "engine.h"
+#include "book.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+extern Pos cur_pos;
+extern Game *opt_game;
+extern int ab_max_depth;
+
+#define BOOK_MAGIC "gbbook1"
+
+typedef struct
+{
+	char magic [8];
+	char game [32];
+	gint32 num_entries;
+	gint32 pad;
+} BookHeader;
+
+typedef struct
+{
+	guint64 key;
+	//! Hash of the move, as in book_move_hash()
+	guint32 move;
+	guint32 weight;
+} BookEntry;
+
+gboolean book_enabled = TRUE;
+
+static BookEntry *book_entries = NULL;
+static int book_num_entries = 0;
+//! The mapping of the book file, or NULL if book_entries was malloc'ed
+static void *book_map = NULL;
+static size_t book_map_len = 0;
+
+#define FNV_BASIS G_GUINT64_CONSTANT(14695981039346656037)
+#define FNV_PRIME G_GUINT64_CONSTANT(1099511628211)
+
+static guint64 book_hash_bytes (guint64 hash, byte *buf, int len)
+{
+	int i;
+	for (i=0; i<len; i++)
+	{
+		hash ^= (guchar) buf[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+//! The key of a position. It must not change between versions, so it isn't the hash table's
+static guint64 book_key (Pos *pos)
+{
+	guint64 hash = FNV_BASIS;
+	byte player = pos->player;
+	hash = book_hash_bytes (hash, pos->board, board_wid * board_heit);
+	hash = book_hash_bytes (hash, &player, 1);
+	if (game_stateful && pos->state)
+		hash = book_hash_bytes (hash, pos->state, game_state_size);
+	return hash;
+}
+
+static guint32 book_move_hash (byte *move)
+{
+	int len;
+	for (len = 0; move[len] != -1; len += 3)
+		;
+	return (guint32) book_hash_bytes (FNV_BASIS, move, len);
+}
+
+static int book_entry_cmp (const void *a, const void *b)
+{
+	const BookEntry *p = a, *q = b;
+	if (p->key != q->key)
+		return p->key < q->key ? -1 : 1;
+	if (p->move != q->move)
+		return p->move < q->move ? -1 : 1;
+	return 0;
+}
+
+//! The name of the book file of the current game, or NULL if $HOME is not set
+static gchar * book_filename ()
+{
+	gchar *filename, *s;
+	if (!getenv ("HOME"))
+		return NULL;
+	filename = g_strdup_printf ("%s/.gtkboard/book/%s.book", getenv ("HOME"), opt_game->name);
+	for (s = strrchr (filename, '/') + 1; *s; s++)
+		if (*s == ' ')
+			*s = '_';
+	return filename;
+}
+
+static void book_header (BookHeader *header, int num_entries)
+{
+	memset (header, 0, sizeof (BookHeader));
+	strncpy (header->magic, BOOK_MAGIC, sizeof (header->magic));
+	strncpy (header->game, opt_game->name, sizeof (header->game) - 1);
+	header->num_entries = num_entries;
+}
+
+gboolean book_init ()
+{
+	BookHeader header, file_header;
+	gchar *filename;
+	FILE *in;
+	struct stat st;
+	book_free ();
+	filename = book_filename ();
+	if (!filename)
+		return FALSE;
+	in = fopen (filename, "rb");
+	g_free (filename);
+	if (!in)
+		return FALSE;
+	if (fread (&file_header, sizeof (BookHeader), 1, in) != 1)
+	{
+		fclose (in);
+		return FALSE;
+	}
+	book_header (&header, file_header.num_entries);
+	// a truncated file would fault when the map is read past its end
+	if (memcmp (&header, &file_header, sizeof (BookHeader)) || header.num_entries <= 0
+			|| fstat (fileno (in), &st) < 0
+			|| st.st_size != sizeof (BookHeader) + (off_t) header.num_entries * sizeof (BookEntry))
+	{
+		fclose (in);
+		return FALSE;
+	}
+	book_num_entries = header.num_entries;
+#ifdef HAVE_MMAP
+	book_map_len = sizeof (BookHeader) + book_num_entries * sizeof (BookEntry);
+	book_map = mmap (NULL, book_map_len, PROT_READ, MAP_SHARED, fileno (in), 0);
+	if (book_map != MAP_FAILED)
+	{
+		fclose (in);
+		book_entries = (BookEntry *) ((char *) book_map + sizeof (BookHeader));
+		return TRUE;
+	}
+	book_map = NULL;
+#endif
+	book_entries = g_new (BookEntry, book_num_entries);
+	if (fread (book_entries, sizeof (BookEntry), book_num_entries, in) != book_num_entries)
+		book_free ();
+	fclose (in);
+	return book_entries != NULL;
+}
+
+void book_free ()
+{
+#ifdef HAVE_MMAP
+	if (book_map)
+		munmap (book_map, book_map_len);
+	else
+#endif
+	g_free (book_entries);
+	book_map = NULL;
+	book_entries = NULL;
+	book_num_entries = 0;
+}
+
+byte * book_probe (Pos *pos)
+{
+	static byte move [4096];
+	guint64 key;
+	int lo, hi, i, total = 0, pick;
+	byte *movlist, *m, *found = NULL;
+	if (!book_enabled || !book_entries || !game_movegen)
+		return NULL;
+	key = book_key (pos);
+	// the first entry not less than key
+	for (lo = 0, hi = book_num_entries; lo < hi; )
+	{
+		int mid = (lo + hi) / 2;
+		if (book_entries[mid].key < key) lo = mid + 1; else hi = mid;
+	}
+	for (hi = lo; hi < book_num_entries && book_entries[hi].key == key; hi++)
+		total += book_entries[hi].weight;
+	if (total == 0)
+		return NULL;
+	pick = random () % total;
+	for (i = lo; pick >= book_entries[i].weight; i++)
+		pick -= book_entries[i].weight;
+	movlist = game_movegen (pos);
+	for (m = movlist; m[0] != -2; m = movlist_next (m))
+		if (book_move_hash (m) == book_entries[i].move)
+		{
+			found = m;
+			break;
+		}
+	if (found)
+	{
+		assert (movlist_next (found) - found <= sizeof (move));
+		memcpy (move, found, movlist_next (found) - found);
+	}
+	free (movlist);
+	return found ? move : NULL;
+}
+
+//! Adds an entry, growing the array as needed
+static void book_add (BookEntry **entries, int *num, int *max, guint64 key, 
+		byte *move, int weight)
+{
+	if (*num == *max)
+	{
+		*max = *max ? 2 * *max : 1024;
+		*entries = g_realloc (*entries, *max * sizeof (BookEntry));
+	}
+	(*entries)[*num].key = key;
+	(*entries)[*num].move = book_move_hash (move);
+	(*entries)[(*num)++].weight = weight;
+}
+
+gboolean book_build (FILE *log, int depth)
+{
+	BookEntry *entries = NULL;
+	int num = 0, max = 0, i, j, ply = 0;
+	char linebuf [4096];
+	gboolean skip = FALSE;
+	gchar *filename, *tmpname, *dir;
+	gboolean ok;
+	BookHeader header;
+	FILE *out;
+
+	if (!getenv ("HOME"))
+		return FALSE;
+	engine_reset_game ();
+	while (fgets (linebuf, sizeof (linebuf), log))
+	{
+		byte *move, *movlist;
+		if (!strncmp (linebuf, "RESULT", 6))
+		{
+			engine_reset_game ();
+			ply = 0;
+			skip = FALSE;
+			continue;
+		}
+		if (skip || ply >= BOOK_MAX_PLIES)
+			continue;
+		// the log may be corrupt or from another game
+		move = move_read_checked (linebuf);
+		if (!move)
+		{
+			skip = TRUE;
+			continue;
+		}
+		move = movdup (move);
+		movlist = game_movegen (&cur_pos);
+		if (!movlist_contains (movlist, move))
+			skip = TRUE;
+		else
+		{
+			book_add (&entries, &num, &max, book_key (&cur_pos), move, 1);
+			if (depth > 0)
+			{
+				byte *best;
+				ab_max_depth = depth;
+				best = engine_search_timed (&cur_pos, 0);
+				ab_max_depth = 0;
+				if (best)
+					book_add (&entries, &num, &max, book_key (&cur_pos), best, 1);
+			}
+			movstack_trunc ();
+			engine_apply_move (move);
+			ply++;
+		}
+		free (movlist);
+		free (move);
+	}
+
+	// merge the entries for the same move
+	qsort (entries, num, sizeof (BookEntry), book_entry_cmp);
+	for (i=0, j=0; i<num; i++)
+	{
+		if (j > 0 && !book_entry_cmp (&entries[j-1], &entries[i]))
+			entries[j-1].weight += entries[i].weight;
+		else
+			entries[j++] = entries[i];
+	}
+	num = j;
+
+	dir = g_strdup_printf ("%s/.gtkboard", getenv ("HOME"));
+	mkdir (dir, 0755);
+	g_free (dir);
+	dir = g_strdup_printf ("%s/.gtkboard/book", getenv ("HOME"));
+	mkdir (dir, 0755);
+	g_free (dir);
+	// write a new file and rename it over the old one, which an engine may have mapped
+	filename = book_filename ();
+	tmpname = g_strdup_printf ("%s.tmp", filename);
+	out = fopen (tmpname, "wb");
+	if (!out)
+	{
+		g_free (tmpname);
+		g_free (filename);
+		g_free (entries);
+		return FALSE;
+	}
+	book_header (&header, num);
+	ok = fwrite (&header, sizeof (BookHeader), 1, out) == 1
+			&& fwrite (entries, sizeof (BookEntry), num, out) == num;
+	if (fclose (out) != 0)
+		ok = FALSE;
+	if (!ok || rename (tmpname, filename) < 0)
+	{
+		unlink (tmpname);
+		g_free (tmpname);
+		g_free (filename);
+		g_free (entries);
+		return FALSE;
+	}
+	g_free (tmpname);
+	g_free (filename);
+	g_free (entries);
+	return book_init ();
+}
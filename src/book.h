@@ -0,0 +1,58 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _BOOK_H_
+#define _BOOK_H_
+
+#include <stdio.h>
+#include "game.h"
+
+/** \file book.h
+  \brief Opening books.
+
+  A book is a file of entries sorted by the hash of a position, each
+  giving a move that was played in the position and a weight. It is kept
+  in ~/.gtkboard/book/ and memory mapped when the game is selected. Any
+  game can have one; the move is only played if the movegen agrees that it
+  is legal.
+  */
+
+//! Positions deeper than this many plies are not put into a book
+#define BOOK_MAX_PLIES 24
+
+//! Should the engine play from the book. TRUE by default.
+extern gboolean book_enabled;
+
+//! Loads the book of the current game if there is one
+gboolean book_init ();
+
+//! Unloads the book, if any
+void book_free ();
+
+//! Returns a move from the book for pos, chosen at random by weight, or NULL
+/** The move is in a static buffer. */
+byte * book_probe (Pos *pos);
+
+//! Builds the book of the current game from a log file written with gtkboard -l
+/** The weight of a move is the number of times it was played. If depth is
+  positive, each position is also searched to that depth every time it
+  occurs, and the move found counts as played once more. The book
+  replaces any book the game had. Returns FALSE if it can't be written. */
+gboolean book_build (FILE *log, int depth);
+
+#endif
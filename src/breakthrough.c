@@ -22,6 +22,7 @@
 #include <assert.h>
 
 #include "game.h"
+#include "breakthroughbb.h"
 #include "../pixmaps/chess.xpm"
 
 #define BREAKTHROUGH_CELL_SIZE 54
@@ -75,10 +76,11 @@ Game Breakthrough = { BREAKTHROUGH_CELL_SIZE, BREAKTHROUGH_BOARD_WID, BREAKTHROU
 void breakthrough_init ()
 {
 	game_getmove = breakthrough_getmove;
-//	game_who_won = breakthrough_who_won;
+	game_who_won = breakthrough_who_won;
 	game_eval = breakthrough_eval;
-//	game_eval_incr = breakthrough_eval_incr;
+	game_eval_incr = breakthrough_eval_incr;
 	game_movegen = breakthrough_movegen;
+	game_tb_pieces = 3;
 	game_file_label = FILERANK_LABEL_TYPE_ALPHA;
 	game_rank_label = FILERANK_LABEL_TYPE_NUM | FILERANK_LABEL_DESC;
 	game_allow_flip = TRUE;
@@ -90,87 +92,44 @@ void breakthrough_init ()
 		"URL: "GAME_DEFAULT_URL ("breakthrough");
 }
 
-static gboolean eval_is_backward (byte *board, int x, int y)
+//! A side wins by reaching the last rank or by capturing all the pawns of the other
+static ResultType breakthrough_who_won (Pos *pos, Player player, char **commp)
 {
-	int incy, other, j;
-	int val = board[y * board_wid + x];
-	assert (val != BREAKTHROUGH_EMPTY);
-	incy = val == BREAKTHROUGH_WP ? 1 : -1;
-	other = val == BREAKTHROUGH_WP ? BREAKTHROUGH_BP : BREAKTHROUGH_WP;
-
-	for (j = y; j < board_heit && j >= 0; j -= incy)
-	{
-		if (x - 1 >= 0 && board[j * board_wid + x - 1] == val) return FALSE;
-		if (x + 1 < board_wid && board[j * board_wid + x + 1] == val) return FALSE;
-	}
-	
-	for (j = y + incy; j < board_heit && j >= 0; j += incy)
+	guint64 white, black;
+	guint64 last_rank = G_GUINT64_CONSTANT(0xff) << (8 * (board_heit - 1));
+	breakthroughbb_from_board (pos->board, &white, &black);
+	if (!black || (white & last_rank))
 	{
-		if (board[j * board_wid + x] != BREAKTHROUGH_EMPTY) return FALSE;
-		if (x - 1 >= 0 && j + incy >= 0 && j + incy < board_heit &&
-				board[j * board_wid + x - 1] == val &&
-				board[(j + incy) * board_wid + x - 1] == other) return TRUE;
-		if (x + 1 >= 0 && j + incy >= 0 && j + incy < board_heit &&
-				board[j * board_wid + x + 1] == val &&
-				board[(j + incy) * board_wid + x + 1] == other) return TRUE;
+		*commp = "White won";
+		return RESULT_WHITE;
 	}
-	return FALSE;
-}
-
-// Is this pawn a passer?
-static gboolean eval_is_passer (byte *board, int x, int y)
-{
-	int incy, other;
-	int val = board[y * board_wid + x];
-	assert (val != BREAKTHROUGH_EMPTY);
-	incy = val == BREAKTHROUGH_WP ? 1 : -1;
-	other = val == BREAKTHROUGH_WP ? BREAKTHROUGH_BP : BREAKTHROUGH_WP;
-	for (y += incy; y < board_heit && y >= 0; y += incy)
+	if (!white || (black & 0xff))
 	{
-		if (board[y * board_wid + x] != BREAKTHROUGH_EMPTY) return FALSE;
-		if (x - 1 >= 0 && board[y * board_wid + x - 1] == other) return FALSE;
-		if (x + 1 < board_wid && board[y * board_wid + x + 1] == other) return FALSE;
+		*commp = "Black won";
+		return RESULT_BLACK;
 	}
-	return TRUE;
+	*commp = NULL;
+	return RESULT_NOTYET;
 }
 
-static gboolean eval_is_blocked (byte *board, int x, int y)
+//! How far the most advanced passer of own, moving up, is from the last rank, or board_heit if there is none
+static int eval_passer_dist (guint64 own, guint64 opp)
 {
-	// TODO
-	return FALSE;
+	guint64 passers = breakthroughbb_passers (own, opp);
+	int j;
+	for (j=board_heit-1; j>=0; j--)
+		if (passers & (G_GUINT64_CONSTANT(0xff) << (8 * j)))
+			return board_heit - 1 - j;
+	return board_heit;
 }
 
-static ResultType breakthrough_eval (Pos *pos, Player player, float *eval)
+//! Looks for a race between passers: the side whose passer is nearer to the last rank wins
+static ResultType eval_passers (guint64 white, guint64 black, Player player, float *eval)
 {
-	float wtsum = 0;
-	int i, j;
-	int wcount[BREAKTHROUGH_BOARD_WID], bcount[BREAKTHROUGH_BOARD_WID];
-	float doubled_pawn_penalty = 0.2;
-	float edge_pawn_bonus = 0.1;
-	float backward_pawn_penalty = 0.5;
-	float blocked_pawn_penalty = 0.1;
-
-	int passer_min_white = board_heit, passer_min_black = board_heit;
-	
-	for (i=0; i<board_wid; i++)
-	{
-		// cheap optimization trick 
-		if (pos->board [0 * board_wid + i] == BREAKTHROUGH_WP && 
-				pos->board [(board_heit - 1) * board_wid + i] == BREAKTHROUGH_BP)
-			continue;
-		for (j=0; j<board_heit; j++)
-		{
-			int val = pos->board[j * board_wid + i];
-			if (val == BREAKTHROUGH_EMPTY) continue;
-			if (eval_is_passer (pos->board, i, j))
-			{
-				if (val == BREAKTHROUGH_WP && (board_wid -1 - j < passer_min_white))
-					passer_min_white = board_wid -1 - j;
-				if (val == BREAKTHROUGH_BP && (j < passer_min_black))
-					passer_min_black = j;
-			}
-		}
-	}
+	int passer_min_white, passer_min_black;
+	passer_min_white = eval_passer_dist (white, black);
+	passer_min_black = eval_passer_dist 
+		(breakthroughbb_flip (black), breakthroughbb_flip (white));
 	if (passer_min_white < board_heit || passer_min_black < board_heit)
 	{
 		int diff = passer_min_white - passer_min_black;
@@ -185,93 +144,97 @@ static ResultType breakthrough_eval (Pos *pos, Player player, float *eval)
 			return RESULT_BLACK;
 		}
 	}
-	
-	for (i=0; i<board_wid; i++)
-		wcount[i] = bcount[i] = 0;
+	return RESULT_NOTYET;
+}
 
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	{
-		int val = pos->board [j * board_wid + i];
-		if (val == BREAKTHROUGH_EMPTY) continue;
-		if (val == BREAKTHROUGH_WP)
-		{
-			wtsum += (1 + 0.1 * j);
-			if (i == 0 || i == board_wid - 1)
-				wtsum += edge_pawn_bonus;
-			if (eval_is_backward (pos->board, i, j))
-				wtsum -= backward_pawn_penalty;
-			wcount[i]++;
-		}
-		else if (val == BREAKTHROUGH_BP)
-		{
-			wtsum -= (1 + 0.1 * (board_wid - 1 - j));
-			if (i == 0 || i == board_wid - 1)
-				wtsum -= edge_pawn_bonus;
-			if (eval_is_backward (pos->board, i, j))
-				wtsum += backward_pawn_penalty;
-			bcount[i]++;
-		}
-	}
-	
-	for (i=0; i<board_wid; i++)
-	{
-		wtsum -= (wcount[i] > 1 ? wcount[i] - 1 : 0);
-		wtsum += (bcount[i] > 1 ? bcount[i] - 1 : 0);
-	}
-	
-	*eval = wtsum;
+//! The eval of the pawns of own, moving up, on the given files
+static float eval_side (guint64 own, guint64 opp, guint64 files)
+{
+	float edge_pawn_bonus = 0.1;
+	float backward_pawn_penalty = 0.5;
+	guint64 pawns = own & files, occ_files;
+	int ranks, count = breakthroughbb_count (pawns);
+	// the sum of the ranks, bit by bit
+	ranks = breakthroughbb_count (pawns & G_GUINT64_CONSTANT(0xff00ff00ff00ff00))
+		+ 2 * breakthroughbb_count (pawns & G_GUINT64_CONSTANT(0xffff0000ffff0000))
+		+ 4 * breakthroughbb_count (pawns & G_GUINT64_CONSTANT(0xffffffff00000000));
+	// doubled pawns: the pawns less the files that have any
+	occ_files = pawns | (pawns >> 32);
+	occ_files |= occ_files >> 16;
+	occ_files |= occ_files >> 8;
+	return count + 0.1 * ranks 
+		+ edge_pawn_bonus * breakthroughbb_count 
+			(pawns & (BREAKTHROUGHBB_FILE (0) | BREAKTHROUGHBB_FILE (board_wid - 1)))
+		- backward_pawn_penalty * breakthroughbb_count 
+			(breakthroughbb_backward (own, opp) & files)
+		- (count - breakthroughbb_count (occ_files & 0xff));
+}
+
+//! The rest of the eval, summed over the pawns on the given files
+/** A pawn's terms depend only on its own file and the files next to it. */
+static float eval_files (guint64 white, guint64 black, guint64 files)
+{
+	return eval_side (white, black, files) 
+		- eval_side (breakthroughbb_flip (black), breakthroughbb_flip (white), files);
+}
+
+static ResultType breakthrough_eval (Pos *pos, Player player, float *eval)
+{
+	guint64 white, black;
+	ResultType result;
+	breakthroughbb_from_board (pos->board, &white, &black);
+	result = eval_passers (white, black, player, eval);
+	if (result != RESULT_NOTYET)
+		return result;
+	*eval = eval_files (white, black, ~G_GUINT64_CONSTANT(0));
 	return RESULT_NOTYET;
 }
 
 static ResultType breakthrough_eval_incr (Pos *pos, byte *move, float *eval)
 {
-	byte *board = pos->board;
-	if (move[0] == move[3]) *eval = 0;
-	else *eval = (pos->player == WHITE ? 1 : -1);
-	*eval += 0.01 * random() / RAND_MAX;
-	return RESULT_NOTYET;
+	guint64 white, black, files = 0;
+	float before;
+	int i;
+	ResultType result;
+
+	// only the files of the move and the ones next to them can change
+	for (i=0; move[3*i] != -1; i++)
+		files |= BREAKTHROUGHBB_FILE (move[3*i]);
+	files |= ((files & ~BREAKTHROUGHBB_FILE (board_wid - 1)) << 1) 
+		| ((files & ~BREAKTHROUGHBB_FILE (0)) >> 1);
+	breakthroughbb_from_board (pos->board, &white, &black);
+	before = eval_files (white, black, files);
+
+	for (i=0; move[3*i] != -1; i++)
+	{
+		guint64 bit = BREAKTHROUGHBB_BIT (move[3*i], move[3*i+1]);
+		white &= ~bit;
+		black &= ~bit;
+		if (move[3*i+2] == BREAKTHROUGH_WP)
+			white |= bit;
+		else if (move[3*i+2] == BREAKTHROUGH_BP)
+			black |= bit;
+	}
+	result = eval_passers (white, black, pos->player == WHITE ? BLACK : WHITE, eval);
+	if (result == RESULT_NOTYET)
+		*eval = eval_files (white, black, files) - before;
+	return result;
 }
 
+//! The captures and then the other moves, starting from a random square
 static byte * breakthrough_movegen (Pos *pos)
 {
-	int i, j, m, n, xoff, yoff;
 	byte movbuf [256];
 	byte *movlist, *movp = movbuf;
-	byte *board = pos->board;
+	guint64 white, black;
+	int start = random() % (board_wid * board_heit);
 
-	// generate a random permutation of the moves
-	xoff = random() % board_wid;
-	yoff = random() % board_heit;
-	for (m=0; m<board_wid; m++)
-	for (n=0; n<board_heit; n++)
-	{
-		int incx, incy;
-		i = (m + xoff) % board_wid;
-		j = (n + yoff) % board_heit;
-		if (board [j * board_wid + i] != 
-				(pos->player == WHITE ? BREAKTHROUGH_WP : BREAKTHROUGH_BP))
-			continue;
-		incy = board [j * board_wid + i] == BREAKTHROUGH_WP ? 1 : -1;
-		for (incx = -1; incx <= 1; incx += 1)
-		{
-			int val;
-			if (!ISINBOARD (i + incx, j + incy))
-				continue;
-			val = board [(j+incy) * board_wid + (i+incx)];
-			if ((val == BREAKTHROUGH_EMPTY || val == board [j * board_wid + i]) 
-					&& incx != 0)
-				continue;
-			if (val != BREAKTHROUGH_EMPTY && incx == 0) continue;
-			*movp++ = i + incx;
-			*movp++ = j + incy;
-			*movp++ = (pos->player == WHITE ? BREAKTHROUGH_WP : BREAKTHROUGH_BP);
-			*movp++ = i;
-			*movp++ = j;
-			*movp++ = 0;
-			*movp++ = -1;
-		}		
-	}
+	breakthroughbb_from_board (pos->board, &white, &black);
+	if (pos->player == WHITE)
+		movp = breakthroughbb_movegen (white, black, FALSE, BREAKTHROUGH_WP, start, movp);
+	else
+		movp = breakthroughbb_movegen (breakthroughbb_flip (black), 
+				breakthroughbb_flip (white), TRUE, BREAKTHROUGH_BP, start, movp);
 	*movp++ = -2;
 	movlist = (byte *) (malloc (movp - movbuf));
 	memcpy (movlist, movbuf, (movp - movbuf));
@@ -0,0 +1,151 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "game.h"
+#include "breakthroughbb.h"
+
+/** \file breakthroughbb.c
+  \brief Bitboards for Breakthrough.
+  */
+
+#define FILE_A BREAKTHROUGHBB_FILE(0)
+#define FILE_H BREAKTHROUGHBB_FILE(7)
+
+//! The squares next to the ones in b on the same rank
+static guint64 beside (guint64 b)
+{
+	return ((b & ~FILE_H) << 1) | ((b & ~FILE_A) >> 1);
+}
+
+//! The squares in b and all the squares above them
+static guint64 fill_up (guint64 b)
+{
+	b |= b << 8;
+	b |= b << 16;
+	return b | (b << 32);
+}
+
+//! The squares in b and all the squares below them
+static guint64 fill_down (guint64 b)
+{
+	b |= b >> 8;
+	b |= b >> 16;
+	return b | (b >> 32);
+}
+
+void breakthroughbb_from_board (byte *board, guint64 *white, guint64 *black)
+{
+	int i;
+	*white = *black = 0;
+	assert (board_wid == 8 && board_heit == 8);
+	for (i=0; i<64; i++)
+	{
+		// the values of BREAKTHROUGH_WP and BREAKTHROUGH_BP
+		if (board [i] == 1)
+			*white |= G_GUINT64_CONSTANT(1) << i;
+		else if (board [i] == 2)
+			*black |= G_GUINT64_CONSTANT(1) << i;
+	}
+}
+
+guint64 breakthroughbb_flip (guint64 b)
+{
+	b = ((b >> 8) & G_GUINT64_CONSTANT(0x00ff00ff00ff00ff)) 
+		| ((b & G_GUINT64_CONSTANT(0x00ff00ff00ff00ff)) << 8);
+	b = ((b >> 16) & G_GUINT64_CONSTANT(0x0000ffff0000ffff)) 
+		| ((b & G_GUINT64_CONSTANT(0x0000ffff0000ffff)) << 16);
+	return (b >> 32) | (b << 32);
+}
+
+int breakthroughbb_count (guint64 b)
+{
+	b = b - ((b >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+	b = (b & G_GUINT64_CONSTANT(0x3333333333333333)) 
+		+ ((b >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+	b = (b + (b >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+	return (int) ((b * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56);
+}
+
+static int bb_first (guint64 b)
+{
+	int n = 0;
+	if (!(b & G_GUINT64_CONSTANT(0xffffffff))) { n += 32; b >>= 32; }
+	if (!(b & 0xffff)) { n += 16; b >>= 16; }
+	if (!(b & 0xff)) { n += 8; b >>= 8; }
+	if (!(b & 0xf)) { n += 4; b >>= 4; }
+	if (!(b & 0x3)) { n += 2; b >>= 2; }
+	if (!(b & 0x1)) n += 1;
+	return n;
+}
+
+guint64 breakthroughbb_passers (guint64 own, guint64 opp)
+{
+	// the squares behind a pawn, or behind a pawn of opp on the next file
+	return own & ~fill_down (((own | opp | beside (opp)) >> 8));
+}
+
+guint64 breakthroughbb_backward (guint64 own, guint64 opp)
+{
+	guint64 occ = own | opp, stopped, good, blocks, reach;
+	int i;
+	stopped = beside (own & (opp >> 8));
+	good = stopped & ~occ;
+	blocks = occ | stopped;
+	// the squares from which the first square ahead in blocks is in good
+	reach = good >> 8;
+	for (i=0; i<6; i++)
+		reach |= (reach & ~blocks) >> 8;
+	return own & reach & ~fill_up (beside (own));
+}
+
+static byte *write_moves (guint64 targets, int shift, gboolean flip, int val, 
+		int start, byte *movp)
+{
+	guint64 rot = start ? (targets >> start) | (targets << (64 - start)) : targets;
+	for (; rot; rot &= rot - 1)
+	{
+		int to = (bb_first (rot) + start) & 63, from = to - shift;
+		if (flip)
+		{
+			to ^= 56;
+			from ^= 56;
+		}
+		*movp++ = to % 8;
+		*movp++ = to / 8;
+		*movp++ = val;
+		*movp++ = from % 8;
+		*movp++ = from / 8;
+		*movp++ = 0;
+		*movp++ = -1;
+	}
+	return movp;
+}
+
+byte *breakthroughbb_movegen (guint64 own, guint64 opp, gboolean flip, int val, 
+		int start, byte *movp)
+{
+	guint64 empty = ~(own | opp);
+	movp = write_moves (((own & ~FILE_A) << 7) & opp, 7, flip, val, start, movp);
+	movp = write_moves (((own & ~FILE_H) << 9) & opp, 9, flip, val, start, movp);
+	movp = write_moves ((own << 8) & empty, 8, flip, val, start, movp);
+	return movp;
+}
@@ -0,0 +1,64 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _BREAKTHROUGHBB_H_
+#define _BREAKTHROUGHBB_H_
+
+#include "game.h"
+
+/** \file breakthroughbb.h
+  \brief Bitboards for Breakthrough.
+
+  Square (x, y) is bit y * 8 + x, the same order as Pos::board. White
+  moves towards higher y. The pawn structure functions are written for
+  pawns moving up the board; for black they are called with the 
+  bitboards flipped by breakthroughbb_flip().
+  */
+
+#define BREAKTHROUGHBB_BIT(x, y) (G_GUINT64_CONSTANT(1) << ((y) * 8 + (x)))
+
+//! The squares of file x
+#define BREAKTHROUGHBB_FILE(x) (G_GUINT64_CONSTANT(0x0101010101010101) << (x))
+
+//! Makes bitboards of the white and the black pawns of a board in the format of Pos::board
+void breakthroughbb_from_board (byte *board, guint64 *white, guint64 *black);
+
+//! Mirrors the board top to bottom, so that black's pawns move up
+guint64 breakthroughbb_flip (guint64 b);
+
+//! Number of bits set
+int breakthroughbb_count (guint64 b);
+
+//! The pawns of own with nothing in front of them and no pawn of opp on the files next to them ahead
+guint64 breakthroughbb_passers (guint64 own, guint64 opp);
+
+//! The backward pawns of own
+/** A pawn is backward if no pawn of own on the files next to it is
+  level with it or behind it, and before anything blocks its file, one
+  of them is next to a square it would pass and stopped by a pawn of opp. */
+guint64 breakthroughbb_backward (guint64 own, guint64 opp);
+
+//! Writes the moves of the pawns of own, of value val, captures first
+/** If flip is set, own and opp are flipped and the moves are written
+  for the real board. The squares are taken starting from start, to
+  vary the order of equal moves. Returns a pointer past the last move;
+  the list is not terminated by -2. */
+byte *breakthroughbb_movegen (guint64 own, guint64 opp, gboolean flip, int val, 
+		int start, byte *movp);
+
+#endif
@@ -20,9 +20,11 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <assert.h>
 
 #include "game.h"
 #include "aaball.h"
+#include "checkersbb.h"
 
 #define CHECKERS_CELL_SIZE 40
 #define CHECKERS_NUM_PIECES 4
@@ -59,6 +61,11 @@ int	checkers_init_pos[] =
 
 static int checkers_max_moves = 200;
 
+//! The eval of a man of each side on each square, from white's point of view
+static float checkers_man_val [2][32];
+//! The eval of a white king on each square
+static float checkers_king_val [32];
+
 
 void checkers_init ();
 int checkers_getmove (Pos *, int, int, GtkboardEventType, Player, byte **, int **);
@@ -67,6 +74,7 @@ byte *checkers_movegen (Pos *);
 ResultType checkers_eval (Pos *, Player, float *);
 char ** checkers_get_pixmap (int idx, int color);
 void checkers_reset_uistate ();
+static gboolean checkers_tb_square (int, int);
 	
 Game Checkers = 
 	{ CHECKERS_CELL_SIZE, CHECKERS_BOARD_WID, CHECKERS_BOARD_HEIT, 
@@ -76,9 +84,20 @@ Game Checkers =
 
 void checkers_init ()
 {
+	int s;
+	checkersbb_init ();
+	for (s=0; s<32; s++)
+	{
+		int x = CHECKERSBB_X (s), y = CHECKERSBB_Y (s);
+		checkers_man_val[0][s] = 1 + y / 10.0;
+		checkers_man_val[1][s] = -(1 + (CHECKERS_BOARD_HEIT - 1 - y) / 10.0);
+		checkers_king_val[s] = 5 - fabs ((x-3.5) * (y-3.5)) / 10;
+	}
 	game_getmove = checkers_getmove;
 	game_movegen = checkers_movegen;
 	game_who_won = checkers_who_won;
+	game_tb_pieces = 3;
+	game_tb_square = checkers_tb_square;
 	game_eval = checkers_eval;
 	game_get_pixmap = checkers_get_pixmap;
 	game_reset_uistate = checkers_reset_uistate;
@@ -93,91 +112,69 @@ void checkers_init ()
 		"URL: "GAME_DEFAULT_URL("checkers");
 }
 
+//! Only the dark squares are played on
+static gboolean checkers_tb_square (int x, int y)
+{
+	return x % 2 == y % 2;
+}
+
 ResultType checkers_who_won (Pos *pos, Player player, char **commp)
 {
 	static char comment[32];
 	char *who_str [2] = { "white won", "black won"};
-	int found_w = 0, found_b = 0;
-	int i;
-	for (i=0; i<board_wid * board_heit; i++)
-		if (CHECKERS_ISWHITE (pos->board[i])) found_w = 1;
-		else if (CHECKERS_ISBLACK (pos->board[i])) found_b = 1;
-	if (!found_b)
+	CheckersBB bb;
+	int side = (player == WHITE ? 0 : 1);
+	checkersbb_from_board (&bb, pos->board);
+	// a side that has no pieces left, or can't move, has lost
+	if (!checkersbb_can_move (&bb, side))
 	{
-		strncpy (comment, who_str[0], 31);
+		strncpy (comment, who_str[!side], 31);
 		*commp = comment;
-		return RESULT_WHITE;
+		return side ? RESULT_WHITE : RESULT_BLACK;
 	}
-	if (!found_w)
+	if (!(bb.men[!side] | bb.kings[!side]))
 	{
-		strncpy (comment, who_str[1], 31);
+		strncpy (comment, who_str[side], 31);
 		*commp = comment;
-		return RESULT_BLACK;
+		return side ? RESULT_BLACK : RESULT_WHITE;
 	}
 	return RESULT_NOTYET;
 }
 
+//! Writes the movelets of move to mp and returns the end of them
+static byte * checkers_write_move (CheckersBB *bb, int side, CheckersBBMove *move, byte *mp)
+{
+	int i;
+	gboolean king = (bb->kings[side] & (1u << move->from)) != 0;
+	*mp++ = CHECKERSBB_X (move->from); *mp++ = CHECKERSBB_Y (move->from); *mp++ = 0;
+	for (i=0; i<move->ncaps; i++)
+	{
+		*mp++ = CHECKERSBB_X (move->caps[i]); *mp++ = CHECKERSBB_Y (move->caps[i]); 
+		*mp++ = 0;
+	}
+	*mp++ = CHECKERSBB_X (move->to); *mp++ = CHECKERSBB_Y (move->to);
+	if (king || move->crowns)
+		*mp++ = (side == 0 ? CHECKERS_WK : CHECKERS_BK);
+	else
+		*mp++ = (side == 0 ? CHECKERS_WP : CHECKERS_BP);
+	*mp++ = -1;
+	return mp;
+}
+
 byte * checkers_movegen (Pos *pos)
 {
-	int i, j, diffx, diffy;
-	byte movbuf [256];
+	byte movbuf [4096];
 	byte *movlist, *mp = movbuf;
-	byte *board = pos->board;
-	Player player = pos->player;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
+	CheckersBB bb;
+	CheckersBBMove moves [CHECKERSBB_MAX_MOVES];
+	int side = (pos->player == WHITE ? 0 : 1), n, i;
+	checkersbb_from_board (&bb, pos->board);
+	n = checkersbb_movegen (&bb, side, moves);
+	for (i=0; i<n; i++)
 	{
-		if (player == BLACK && !CHECKERS_ISBLACK(board [j * board_wid + i]))
-			continue;
-		if (player == WHITE && !CHECKERS_ISWHITE(board [j * board_wid + i]))
-			continue;
-		for (diffx = -1; diffx <= 1; diffx += 2)
-		for (diffy = -1; diffy <= 1; diffy += 2)
-		{
-			if (CHECKERS_ISPAWN (board [j * board_wid + i])
-					&& 	diffy != (player == WHITE ? 1 : -1))
-				continue;
-			if (!ISINBOARD(i+diffx, j+diffy)) continue;
-			if (board [(j + diffy) * board_wid + (i + diffx)] != 0)
-				continue;
-			*mp++ = i; *mp++ = j; *mp++ = 0;
-			*mp++ = i + diffx; *mp++ = j + diffy; 
-			if ((player == WHITE && (j + diffy) == board_heit - 1) 
-					|| (player == BLACK && (j + diffy) == 0))
-				*mp++ = (player == WHITE ? CHECKERS_WK : CHECKERS_BK);
-			else
-				*mp++ = board [j * board_wid + i];
-			*mp++ = -1;
-		}
-		for (diffx = -2; diffx <= 2; diffx += 4)
-		for (diffy = -2; diffy <= 2; diffy += 4)
-		{
-			int val;
-			if (CHECKERS_ISPAWN (board [j * board_wid + i])
-					&& 	diffy != (player == WHITE ? 2 : -2))
-				continue;
-			if (!ISINBOARD(i+diffx, j+diffy)) continue;
-			if (board [(j + diffy) * board_wid + (i + diffx)] != 0)
-				continue;
-			val = board [(j + diffy/2) * board_wid + i + diffx/2];
-			if ((player == WHITE && !CHECKERS_ISBLACK(val)) || 
-					(player == BLACK && !CHECKERS_ISWHITE (val)))
-				continue;
-			*mp++ = i; *mp++ = j; *mp++ = 0;
-			*mp++ = i + diffx; *mp++ = j + diffy; 
-			if ((player == WHITE && (j + diffy) == board_heit - 1) 
-					|| (player == BLACK && (j + diffy) == 0))
-				*mp++ = (player == WHITE ? CHECKERS_WK : CHECKERS_BK);
-			else
-				*mp++ = board [j * board_wid + i];
-			*mp++ = i + diffx/2; *mp++ = j + diffy/2; *mp++ = 0;
-			*mp++ = -1;
-		}
-		
-			
+		mp = checkers_write_move (&bb, side, &moves[i], mp);
+		assert (mp - movbuf < sizeof (movbuf) - 3 * (CHECKERSBB_MAX_CAPTURES + 2) - 1);
 	}
-	if (mp == movbuf)
-		*mp++ = -1;
 	*mp++ = -2;
 	movlist = (byte *) (malloc (mp - movbuf));
 	memcpy (movlist, movbuf, (mp - movbuf));
@@ -187,105 +184,113 @@ byte * checkers_movegen (Pos *pos)
 ResultType checkers_eval (Pos *pos, Player to_play, float *eval)
 {
 	float sum = 0;
-	int i, j;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
+	CheckersBB bb;
+	int side = (to_play == WHITE ? 0 : 1);
+	guint32 b;
+	checkersbb_from_board (&bb, pos->board);
+
+	if (!checkersbb_can_move (&bb, side))
 	{
-		switch (pos->board [j * board_wid + i])
-		{
-			case CHECKERS_WK: sum += (5 - fabs ((i-3.5) * (j-3.5)) / 10); break;
-			case CHECKERS_WP: sum += (1 + j / 10.0); break;
-			case CHECKERS_BK: sum -= (5 - fabs ((i-3.5) * (j-3.5)) / 10); break;
-			case CHECKERS_BP: sum -= (1 + (board_heit - 1 - j) / 10.0); break;
-		}
+		*eval = side ? GAME_EVAL_INFTY : -GAME_EVAL_INFTY;
+		return side ? RESULT_WHITE : RESULT_BLACK;
 	}
+	for (b = bb.men[0]; b; b &= b - 1)
+		sum += checkers_man_val[0][checkersbb_count ((b & -b) - 1)];
+	for (b = bb.men[1]; b; b &= b - 1)
+		sum += checkers_man_val[1][checkersbb_count ((b & -b) - 1)];
+	for (b = bb.kings[0]; b; b &= b - 1)
+		sum += checkers_king_val[checkersbb_count ((b & -b) - 1)];
+	for (b = bb.kings[1]; b; b &= b - 1)
+		sum -= checkers_king_val[checkersbb_count ((b & -b) - 1)];
 	*eval = sum;
 	return RESULT_NOTYET;
-
 }
 
 static int oldx = -1, oldy = -1;
+//! The squares landed on so far in the move being entered
+static int num_hops = 0;
+static int hops [CHECKERSBB_MAX_CAPTURES][2];
 
 void checkers_reset_uistate ()
 {
 	oldx = -1, oldy = -1;
+	num_hops = 0;
+}
+
+//! Does the move begin with the hops entered so far, and end with them if exact
+static gboolean checkers_hops_match (CheckersBBMove *move, gboolean exact)
+{
+	int i, x = CHECKERSBB_X (move->from), y = CHECKERSBB_Y (move->from);
+	int len = move->ncaps ? move->ncaps : 1;
+	if (x != oldx || y != oldy || num_hops > len || (exact && num_hops != len))
+		return FALSE;
+	for (i=0; i<num_hops; i++)
+	{
+		// each hop lands beyond the piece it takes
+		if (move->ncaps)
+		{
+			x = 2 * CHECKERSBB_X (move->caps[i]) - x;
+			y = 2 * CHECKERSBB_Y (move->caps[i]) - y;
+		}
+		else
+		{
+			x = CHECKERSBB_X (move->to);
+			y = CHECKERSBB_Y (move->to);
+		}
+		if (hops[i][0] != x || hops[i][1] != y)
+			return FALSE;
+	}
+	return TRUE;
 }
 
 int checkers_getmove (Pos *pos, int x, int y, GtkboardEventType type, Player to_play, 
 		byte **movp, int ** rmovep)
 {
-	static byte move[10];
-	byte *mp = move;
-	int diffx, diffy;
-	byte *board = pos->board;
+	static byte move[3 * (CHECKERSBB_MAX_CAPTURES + 2) + 1];
+	CheckersBB bb;
+	CheckersBBMove moves [CHECKERSBB_MAX_MOVES];
+	int side = (to_play == WHITE ? 0 : 1), n, i;
+	gboolean prefix = FALSE;
 	if (type != GTKBOARD_BUTTON_RELEASE) return 0;
 	if (oldx < 0)
 	{
-		int val = board [y * board_wid + x];
+		int val = pos->board [y * board_wid + x];
 		if ((CHECKERS_ISWHITE(val) && !(to_play == WHITE)) ||
-		(CHECKERS_ISBLACK(val) && !(to_play == BLACK)))
+		(CHECKERS_ISBLACK(val) && !(to_play == BLACK)) || !val)
 			return -1;
 		oldx = x; oldy = y;
 		return 0;
 	}
 
-	if (x == oldx && y == oldy)
+	if (x == oldx && y == oldy && num_hops == 0)
 	{
 		oldx = -1; oldy = -1; return 0;
 	}
 	
-	diffx = x - oldx;
-	if (abs (diffx) == 1) 
-	{
-		diffy = y - oldy;
-		if (abs (diffy) != 1)
-		{ oldx = oldy = -1; return -1;}
-		if (!CHECKERS_ISKING(board [oldy * board_wid + oldx])
-				&& diffy != (to_play == WHITE ? 1 : -1))
-		{ oldx = oldy = -1; return -1;}
-		if (board [y * board_wid + x] != 0)
-		{ oldx = oldy = -1; return -1;}
-		*mp++ = oldx; *mp++ = oldy; *mp++ = 0;
-		*mp++ = x; *mp++ = y; 
-		if ((to_play == WHITE && y == board_heit - 1) 
-				|| (to_play == BLACK && y == 0))
-			*mp++ = (to_play == WHITE ? CHECKERS_WK : CHECKERS_BK);
-		else
-			*mp++ = board [oldy * board_wid + oldx];
-		*mp++ = -1;
-		*movp = move;
-		oldx = oldy = -1;
-		return 1;
-	}
-	if (abs (diffx) == 2)
+	// a multi-jump is entered one landing square at a time
+	if (num_hops >= CHECKERSBB_MAX_CAPTURES)
+	{ checkers_reset_uistate (); return -1; }
+	hops[num_hops][0] = x;
+	hops[num_hops][1] = y;
+	num_hops++;
+	checkersbb_from_board (&bb, pos->board);
+	n = checkersbb_movegen (&bb, side, moves);
+	for (i=0; i<n; i++)
 	{
-		int val;
-		diffy = y - oldy;
-		if (abs (diffy) != 2)
-		{ oldx = oldy = -1; return -1;}
-		if (!CHECKERS_ISKING(board [oldy * board_wid + oldx])
-				&& diffy != (to_play == WHITE ? 2 : -2))
-		{ oldx = oldy = -1; return -1;}
-		if (board [y * board_wid + x] != 0)
-		{ oldx = oldy = -1; return -1;}
-		val = board [(y-diffy/2) * board_wid + (x-diffx/2)];
-		if ((!CHECKERS_ISWHITE(val) && (to_play == BLACK)) ||
-		(!CHECKERS_ISBLACK(val) && (to_play == WHITE)))
-		{ oldx = oldy = -1; return -1;}
-		*mp++ = oldx; *mp++ = oldy; *mp++ = 0;
-		*mp++ = oldx+diffx/2; *mp++ = oldy+diffy/2; *mp++ = 0;
-		*mp++ = x; *mp++ = y; 
-		if ((to_play == WHITE && y == board_heit - 1)
-				|| (to_play == BLACK && y == 0))
-			*mp++ = (to_play == WHITE ? CHECKERS_WK : CHECKERS_BK);
-		else
-			*mp++ = board [oldy * board_wid + oldx];
-		*mp++ = -1;
-		*movp = move;
-		oldx = oldy = -1;
-		return 1;
+		if (checkers_hops_match (&moves[i], TRUE))
+		{
+			checkers_write_move (&bb, side, &moves[i], move);
+			*movp = move;
+			checkers_reset_uistate ();
+			return 1;
+		}
+		if (checkers_hops_match (&moves[i], FALSE))
+			prefix = TRUE;
 	}
-	{ oldx = oldy = -1; return -1;}
+	if (prefix)
+		return 0;
+	checkers_reset_uistate ();
+	return -1;
 }
 
 char ** checkers_get_pixmap (int idx, int color)
@@ -0,0 +1,211 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+/** \file checkersbb.c
+  \brief Bitboards, move generation and an endgame database for checkers.
+  */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "checkersbb.h"
+
+//! The four diagonal directions: up-left, up-right, down-left, down-right
+static const int dir_dx [4] = {-1, 1, -1, 1};
+static const int dir_dy [4] = {1, 1, -1, -1};
+
+//! The neighbour of each square in each direction, or -1
+static gint8 neighbour [32][4];
+//! The square two steps away in each direction, or -1
+static gint8 jump [32][4];
+
+//! The first and one past the last direction a man of side may move in
+#define MAN_DIR_FIRST(side) (2 * (side))
+#define MAN_DIR_LAST(side) (2 * (side) + 2)
+
+//! The direction going back the way of d
+#define DIR_REVERSE(d) (3 - (d))
+
+//! Is square s on the row where a man of side is crowned
+#define CROWN_ROW(side, s) ((side) == 0 ? (s) >= 28 : (s) < 4)
+
+#define BIT(s) (1u << (s))
+
+static int square_at (int x, int y)
+{
+	if (x < 0 || x >= 8 || y < 0 || y >= 8)
+		return -1;
+	return y * 4 + x / 2;
+}
+
+void checkersbb_init ()
+{
+	int s, d;
+	for (s=0; s<32; s++)
+	for (d=0; d<4; d++)
+	{
+		int x = CHECKERSBB_X (s), y = CHECKERSBB_Y (s);
+		neighbour[s][d] = square_at (x + dir_dx[d], y + dir_dy[d]);
+		jump[s][d] = square_at (x + 2 * dir_dx[d], y + 2 * dir_dy[d]);
+	}
+}
+
+void checkersbb_from_board (CheckersBB *bb, byte *board)
+{
+	int s;
+	memset (bb, 0, sizeof (CheckersBB));
+	for (s=0; s<32; s++)
+	{
+		switch (board [CHECKERSBB_Y (s) * 8 + CHECKERSBB_X (s)])
+		{
+			case 1: bb->kings[0] |= BIT (s); break;
+			case 2: bb->men[0] |= BIT (s); break;
+			case 3: bb->kings[1] |= BIT (s); break;
+			case 4: bb->men[1] |= BIT (s); break;
+		}
+	}
+}
+
+int checkersbb_count (guint32 b)
+{
+	b = b - ((b >> 1) & 0x55555555);
+	b = (b & 0x33333333) + ((b >> 2) & 0x33333333);
+	b = (b + (b >> 4)) & 0x0f0f0f0f;
+	return (b * 0x01010101) >> 24;
+}
+
+//! Index of the lowest bit set
+static int bb_first (guint32 b)
+{
+	return checkersbb_count ((b & -b) - 1);
+}
+
+//! Continues the capture in cur from square s, appending the finished moves to moves
+/** Captured pieces stay on the board until the move is over: they can't
+  be jumped again and can't be landed on. */
+static int gen_jumps (int side, int s, gboolean king, guint32 empty, guint32 opp,
+		CheckersBBMove *cur, CheckersBBMove *moves, int n)
+{
+	int d, found = 0;
+	for (d = king ? 0 : MAN_DIR_FIRST (side); d < (king ? 4 : MAN_DIR_LAST (side)); d++)
+	{
+		int mid = neighbour[s][d], to = jump[s][d];
+		if (to < 0 || !(opp & BIT (mid)) || !(empty & BIT (to)))
+			continue;
+		found = 1;
+		assert (cur->ncaps < CHECKERSBB_MAX_CAPTURES);
+		cur->caps[cur->ncaps++] = mid;
+		if (!king && CROWN_ROW (side, to))
+		{
+			assert (n < CHECKERSBB_MAX_MOVES);
+			moves[n] = *cur;
+			moves[n].to = to;
+			moves[n++].crowns = TRUE;
+		}
+		else
+			n = gen_jumps (side, to, king, (empty & ~BIT (to)) | BIT (s), 
+					opp & ~BIT (mid), cur, moves, n);
+		cur->ncaps--;
+	}
+	if (!found && cur->ncaps > 0)
+	{
+		assert (n < CHECKERSBB_MAX_MOVES);
+		moves[n] = *cur;
+		moves[n].to = s;
+		moves[n++].crowns = FALSE;
+	}
+	return n;
+}
+
+int checkersbb_movegen (CheckersBB *bb, int side, CheckersBBMove *moves)
+{
+	guint32 own = bb->men[side] | bb->kings[side];
+	guint32 opp = bb->men[!side] | bb->kings[!side];
+	guint32 empty = ~(own | opp), b;
+	CheckersBBMove cur;
+	int n = 0, d;
+
+	cur.ncaps = 0;
+	for (b = own; b; b &= b - 1)
+	{
+		int s = bb_first (b);
+		cur.from = s;
+		n = gen_jumps (side, s, (bb->kings[side] & BIT (s)) != 0, empty | BIT (s), 
+				opp, &cur, moves, n);
+	}
+	if (n > 0)
+		return n;
+
+	for (b = own; b; b &= b - 1)
+	{
+		int s = bb_first (b);
+		gboolean king = (bb->kings[side] & BIT (s)) != 0;
+		for (d = king ? 0 : MAN_DIR_FIRST (side); d < (king ? 4 : MAN_DIR_LAST (side)); d++)
+		{
+			int to = neighbour[s][d];
+			if (to < 0 || !(empty & BIT (to)))
+				continue;
+			assert (n < CHECKERSBB_MAX_MOVES);
+			moves[n].from = s;
+			moves[n].to = to;
+			moves[n].ncaps = 0;
+			moves[n++].crowns = !king && CROWN_ROW (side, to);
+		}
+	}
+	return n;
+}
+
+gboolean checkersbb_can_move (CheckersBB *bb, int side)
+{
+	guint32 own = bb->men[side] | bb->kings[side];
+	guint32 opp = bb->men[!side] | bb->kings[!side];
+	guint32 empty = ~(own | opp), b;
+	int d;
+	for (b = own; b; b &= b - 1)
+	{
+		int s = bb_first (b);
+		gboolean king = (bb->kings[side] & BIT (s)) != 0;
+		for (d = king ? 0 : MAN_DIR_FIRST (side); d < (king ? 4 : MAN_DIR_LAST (side)); d++)
+		{
+			int mid = neighbour[s][d], to = jump[s][d];
+			if (mid >= 0 && (empty & BIT (mid)))
+				return TRUE;
+			if (to >= 0 && (opp & BIT (mid)) && (empty & BIT (to)))
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+void checkersbb_apply (CheckersBB *bb, int side, CheckersBBMove *move)
+{
+	int i;
+	gboolean king = (bb->kings[side] & BIT (move->from)) != 0;
+	bb->men[side] &= ~BIT (move->from);
+	bb->kings[side] &= ~BIT (move->from);
+	for (i=0; i<move->ncaps; i++)
+	{
+		bb->men[!side] &= ~BIT (move->caps[i]);
+		bb->kings[!side] &= ~BIT (move->caps[i]);
+	}
+	if (king || move->crowns)
+		bb->kings[side] |= BIT (move->to);
+	else
+		bb->men[side] |= BIT (move->to);
+}
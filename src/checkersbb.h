@@ -0,0 +1,79 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _CHECKERSBB_H_
+#define _CHECKERSBB_H_
+
+#include "game.h"
+
+/** \file checkersbb.h
+  \brief Bitboards and move generation for checkers.
+
+  Only the 32 dark squares are used. Square s is (x, y) with y = s / 4
+  and x = 2 * (s % 4) + (y % 2), so s = 0 is (0, 0). White moves towards
+  higher y. Index 0 of the arrays is white and 1 is black.
+  */
+
+//! The most captures in one move
+#define CHECKERSBB_MAX_CAPTURES 12
+
+//! The most moves in a position
+#define CHECKERSBB_MAX_MOVES 128
+
+typedef struct
+{
+	guint32 men [2];
+	guint32 kings [2];
+} CheckersBB;
+
+//! A move: the piece on from goes to to, taking the pieces on caps, in order
+typedef struct
+{
+	byte from, to;
+	byte ncaps;
+	byte caps [CHECKERSBB_MAX_CAPTURES];
+	//! Does a man become a king
+	gboolean crowns;
+} CheckersBBMove;
+
+//! Builds the neighbour and jump tables. Must be called before the other functions.
+void checkersbb_init ();
+
+//! The x coordinate of square s
+#define CHECKERSBB_X(s) (2 * ((s) % 4) + ((s) / 4) % 2)
+//! The y coordinate of square s
+#define CHECKERSBB_Y(s) ((s) / 4)
+
+//! Fills the bitboards from a board in the format of Pos::board
+void checkersbb_from_board (CheckersBB *bb, byte *board);
+
+//! Number of bits set
+int checkersbb_count (guint32 b);
+
+//! Stores the legal moves of side in moves and returns how many there are
+/** If any capture is possible only the captures are legal, and each goes
+  on for as long as the piece can capture. A man that is crowned stops. */
+int checkersbb_movegen (CheckersBB *bb, int side, CheckersBBMove *moves);
+
+//! Can side move at all
+gboolean checkersbb_can_move (CheckersBB *bb, int side);
+
+//! Makes a move of side
+void checkersbb_apply (CheckersBB *bb, int side, CheckersBBMove *move);
+
+#endif
@@ -24,6 +24,7 @@
 #include "game.h"
 #include "../pixmaps/chess.xpm"
 #include "move.h"
+#include "chessbb.h"
 
 #define CHESS_CELL_SIZE 54
 #define CHESS_NUM_PIECES 12
@@ -111,6 +112,7 @@ int chess_getmove (Pos *, int, int, GtkboardEventType, Player, byte **, int **);
 ResultType chess_who_won (Pos *, Player, char **);
 byte *chess_movegen (Pos *);
 ResultType chess_eval (Pos *, Player, float *);
+extern HeurTab chess_heurtab[];
 void *chess_newstate (Pos *, byte *);
 void chess_reset_uistate ();
 	
@@ -137,9 +139,11 @@ void chess_init ()
 	game_who_won = chess_who_won;
 	game_movegen = chess_movegen;
 	game_eval = chess_eval;
+	game_htab = chess_heurtab;
 	game_stateful = TRUE;
 	game_state_size = sizeof (Chess_state);
 	game_newstate = chess_newstate;
+	chessbb_init ();
 	game_file_label = FILERANK_LABEL_TYPE_ALPHA;
 	game_rank_label = FILERANK_LABEL_TYPE_NUM | FILERANK_LABEL_DESC;
 	game_reset_uistate = chess_reset_uistate;
@@ -154,37 +158,102 @@ void chess_init ()
 
 void *chess_newstate (Pos *pos, byte *move)
 {
-	static Chess_state state = {1, 1, 1, 1, -1};
-	if (!pos->state) return &state;
-	memcpy (&state, pos->state, sizeof (Chess_state));
+	static Chess_state init_state = {1, 1, 1, 1, -1};
+	static Chess_state state;
+	int i;
+	memcpy (&state, pos->state ? pos->state : &init_state, sizeof (Chess_state));
 
 	{
-	int val, to_x, to_y;
+	int val;
 	// if pawn moves two squares to 4th rank then set epf
-	if (move[2] != 0) { val = move[2]; to_x = move[0]; to_y = move[1]; }
-	else if (move[5] != 0) { val = move[5]; to_x = move[3]; to_y = move[4]; }
+	if (move[2] != 0) val = move[2];
+	else if (move[5] != 0) val = move[5];
 	else assert (0);
 	if (
 		(val == CHESS_WP 
 			&& ((move[1] == 1 && move[4] == 3) || (move[1] == 3 && move[4] == 1)))
 		||
 		(val == CHESS_BP 
-			&& ((move[1] == 6 && move[3] == 4) || (move[1] == 6 && move[4] == 6)))
+			&& ((move[1] == 6 && move[4] == 4) || (move[1] == 4 && move[4] == 6)))
 	)
 		state.epfile = move[0];
 	else state.epfile = -1;
 
-	if (val == CHESS_WK) state.castle_WK = state.castle_WQ = 0;
-	if (val == CHESS_BK) state.castle_BK = state.castle_BQ = 0;
-	if (val == CHESS_WR && to_x >= 4) state.castle_WK = 0;
-	if (val == CHESS_WR && to_x <  4) state.castle_WQ = 0;
-	if (val == CHESS_BR && to_x >= 4) state.castle_BK = 0;
-	if (val == CHESS_BR && to_x <  4) state.castle_BQ = 0;
+	// a move from or to a corner or the king's square loses the right to castle there
+	for (i=0; move[3*i] != -1; i++)
+	{
+		int x = move[3*i], y = move[3*i+1];
+		if (y != RANK_1 && y != RANK_8)
+			continue;
+		if (x == E_FILE || x == H_FILE)
+		{
+			if (y == RANK_1) state.castle_WK = 0;
+			else state.castle_BK = 0;
+		}
+		if (x == E_FILE || x == A_FILE)
+		{
+			if (y == RANK_1) state.castle_WQ = 0;
+			else state.castle_BQ = 0;
+		}
+	}
 	} 
 	
 	return &state;
 }
 	
+//! Reads the first four fields of a FEN into board, player and state. Returns FALSE if it is malformed.
+/** state must have room for game_state_size bytes. */
+gboolean chess_fen_read (char *fen, byte *board, Player *player, void *state)
+{
+	static const char pieces[] = "KQRBNPkqrbnp";
+	Chess_state st = {0, 0, 0, 0, -1};
+	char *c = fen, *p;
+	int x = 0, y = CHESS_BOARD_HEIT - 1;
+	memset (board, 0, CHESS_BOARD_WID * CHESS_BOARD_HEIT);
+	for (; *c && *c != ' '; c++)
+	{
+		if (*c == '/')
+		{
+			if (x != CHESS_BOARD_WID || --y < 0)
+				return FALSE;
+			x = 0;
+		}
+		else if (*c >= '1' && *c <= '8')
+			x += *c - '0';
+		else if ((p = strchr (pieces, *c)) != NULL && x < CHESS_BOARD_WID)
+			board [y * CHESS_BOARD_WID + x++] = CHESS_WK + (p - pieces);
+		else
+			return FALSE;
+		if (x > CHESS_BOARD_WID)
+			return FALSE;
+	}
+	if (y != 0 || x != CHESS_BOARD_WID)
+		return FALSE;
+	for (; *c == ' '; c++)
+		;
+	if (*c != 'w' && *c != 'b')
+		return FALSE;
+	*player = *c++ == 'w' ? WHITE : BLACK;
+	for (; *c == ' '; c++)
+		;
+	for (; *c && *c != ' '; c++)
+		switch (*c)
+		{
+			case 'K': st.castle_WK = 1; break;
+			case 'Q': st.castle_WQ = 1; break;
+			case 'k': st.castle_BK = 1; break;
+			case 'q': st.castle_BQ = 1; break;
+			case '-': break;
+			default: return FALSE;
+		}
+	for (; *c == ' '; c++)
+		;
+	if (*c >= 'a' && *c <= 'h')
+		st.epfile = *c - 'a';
+	memcpy (state, &st, sizeof (Chess_state));
+	return TRUE;
+}
+
 static int isfreeline (byte *pos, int oldx, int oldy, int newx, int newy)
 {
 	int x = oldx, y = oldy, dx, dy, diffx = newx - oldx, diffy = newy - oldy;
@@ -288,41 +357,11 @@ static int islegal (Pos *pos, int oldx, int oldy, int x, int y)
 	}
 }
 
-static int oppcolor (byte *board, int oldx, int oldy, int x, int y)
-	/* True if one square is W and the other is B */
-{
-	int oldv = board [oldy * board_wid + oldx], v = board [y * board_wid + x];
-	if (CHESS_ISWHITE (oldv) && CHESS_ISBLACK (v)) return 1;
-	if (CHESS_ISBLACK (oldv) && CHESS_ISWHITE (v)) return 1;
-	return 0;
-}
-
 static gboolean is_in_check (Pos *pos, Player player)
 {
-	int i, j, kingx = -1, kingy = -1;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	{
-		int val = pos->board [j * board_wid + i];
-		if ((player == WHITE && val == CHESS_WK) || 
-				(player == BLACK && val == CHESS_BK))
-		{
-			kingx = i;
-			kingy = j;
-		}
-	}
-	
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	{
-		int val = pos->board [j * board_wid + i];
-		if (!((player == WHITE && CHESS_ISBLACK (val)) || 
-				(player == BLACK && CHESS_ISWHITE (val))))
-			continue;
-		if (islegal (pos, i, j, kingx, kingy))
-			return TRUE;
-	}
-	return FALSE;
+	ChessBB bb;
+	chessbb_from_board (&bb, pos->board);
+	return chessbb_in_check (&bb, player);
 }
 
 //! Would "player" be in check after making "move"
@@ -521,342 +560,19 @@ ResultType chess_who_won (Pos *pos, Player player, char **commp)
 	}
 }
 
-int chess_movegen_square (byte *board, byte **movp, int player,
-		int oldx, int oldy, int x, int y)
-{
-	int val;
-	if (!ISINBOARD(x, y)) return 0;
-	val = board [y * board_heit + x];
-	if ((player == WHITE && CHESS_ISWHITE (val))
-		|| (player == BLACK && CHESS_ISBLACK (val)))
-		return 0;
-	*(*movp)++ = oldx;
-	*(*movp)++ = oldy;
-	*(*movp)++ = 0;
-	*(*movp)++ = x;
-	*(*movp)++ = y;
-	*(*movp)++ = board [oldy * board_heit + oldx];
-	*(*movp)++ = -1;
-	if (leads_to_check (board, *movp-7, player))
-	{
-		*movp -= 7;
-		return 0;
-	}
-	return 1;
-}
-
-int chess_movegen_line (byte *pos, byte **movp, int player,
-		int x, int y, int incx, int incy)
-{
-	int oldx = x, oldy = y;
-	int capture = 0, val;
-	do
-	{
-		x += incx;
-		y += incy;
-		val = pos [y * board_heit + x];
-		if (ISINBOARD (x, y) && oppcolor (pos, oldx, oldy, x, y))
-			capture = 1;
-	} while (chess_movegen_square (pos, movp, player, oldx, oldy, x, y) && !capture);
-	return 0;
-}
-
-static void chess_movegen_promote (byte *board, byte **movp, int player,
-		int oldx, int oldy, int x, int y)
-{
-	int i, j;
-	int promote_pieces[2][4] = {
-		{CHESS_WQ, CHESS_WR, CHESS_WB, CHESS_WN},
-		{CHESS_BQ, CHESS_BR, CHESS_BB, CHESS_BN}
-	};
-	i = (player == WHITE ? 0 : 1);
-	for(j=0; j<4; j++) 
-	{
-		*(*movp)++ = oldx;
-		*(*movp)++ = oldy;
-		*(*movp)++ = 0;
-		*(*movp)++ = x;
-		*(*movp)++ = y;
-		*(*movp)++ = promote_pieces[i][j];
-		*(*movp)++ = -1;
-		if (leads_to_check (board, *movp-7, player))
-		{
-			*movp -= 7;
-			return;
-		}
-	}
-}
-
-static void chess_movegen_enpassant (Pos *pos, byte **movp, int player,
-		int x, int y)
-{
-	int val = pos->board [y * board_wid + x];
-	int epfile;
-	if (!pos->state) epfile = -1;
-	else epfile = ((Chess_state *)pos->state)->epfile;
-	if (epfile < 0)
-		return;
-	if ((player == WHITE && val != CHESS_WP) || 
-			(player == BLACK && val != CHESS_BP))
-		return;
-	if ((player == WHITE && y != 4) ||  
-			(player == BLACK && y != 3))
-		return;
-	if (abs (x - epfile) != 1)
-		return;
-	*(*movp)++ = x;
-	*(*movp)++ = y;
-	*(*movp)++ = 0;
-	*(*movp)++ = epfile;
-	*(*movp)++ = y + (player == WHITE ? 1 : -1);
-	*(*movp)++ = val;
-	*(*movp)++ = epfile;
-	*(*movp)++ = y;
-	*(*movp)++ = 0;
-	*(*movp)++ = -1;
-	if (leads_to_check (pos->board, *movp-10, player))
-		*movp -= 10;
-}
-
-static void chess_movegen_castle (Pos *pos, byte **movp, int player)
-{
-	int rank = player == WHITE ? RANK_1 : RANK_8;
-	int king = player == WHITE ? CHESS_WK : CHESS_BK;
-	int rook = player == WHITE ? CHESS_WR : CHESS_BR;
-	int castle_k, castle_q;
-	byte *board = pos->board;
- 	if (!pos->state) return;
-	castle_k = player == WHITE ? 
-		((Chess_state *)pos->state)->castle_WK : ((Chess_state *)pos->state)->castle_BK;
-	castle_q = player == WHITE ? 
-		((Chess_state *)pos->state)->castle_WQ : ((Chess_state *)pos->state)->castle_BQ;
-	if (board [rank * board_wid + E_FILE] != king)
-		return;
-	if (is_in_check (pos, player)) return;
-
-	if (board [rank * board_wid + H_FILE] == rook && castle_k)
-	{
-		gboolean allowed = TRUE;
-		*(*movp)++ = E_FILE;
-		*(*movp)++ = rank;
-		*(*movp)++ = 0;
-		*(*movp)++ = F_FILE;
-		*(*movp)++ = rank;
-		*(*movp)++ = king;
-		*(*movp)++ = -1;
-		if (leads_to_check (pos->board, *movp-7, player))
-			allowed = FALSE;
-		*movp -= 7;
-		
-		*(*movp)++ = E_FILE;
-		*(*movp)++ = rank;
-		*(*movp)++ = 0;
-		*(*movp)++ = G_FILE;
-		*(*movp)++ = rank;
-		*(*movp)++ = king;
-		*(*movp)++ = -1;
-		if (leads_to_check (pos->board, *movp-7, player))
-			allowed = FALSE;
-		*movp -= 7;
-
-		if (allowed)
-		{
-			*(*movp)++ = E_FILE;
-			*(*movp)++ = rank;
-			*(*movp)++ = 0;
-			*(*movp)++ = G_FILE;
-			*(*movp)++ = rank;
-			*(*movp)++ = king;
-			*(*movp)++ = H_FILE;
-			*(*movp)++ = rank;
-			*(*movp)++ = 0;
-			*(*movp)++ = F_FILE;
-			*(*movp)++ = rank;
-			*(*movp)++ = rook;
-			*(*movp)++ = -1;
-		}
-	}
-	
-	if (board [rank * board_wid + A_FILE] == rook && castle_q)
-	{
-		gboolean allowed = TRUE;
-		*(*movp)++ = E_FILE;
-		*(*movp)++ = rank;
-		*(*movp)++ = 0;
-		*(*movp)++ = D_FILE;
-		*(*movp)++ = rank;
-		*(*movp)++ = king;
-		*(*movp)++ = -1;
-		if (leads_to_check (pos->board, *movp-7, player))
-			allowed = FALSE;
-		*movp -= 7;
-		
-		*(*movp)++ = E_FILE;
-		*(*movp)++ = rank;
-		*(*movp)++ = 0;
-		*(*movp)++ = C_FILE;
-		*(*movp)++ = rank;
-		*(*movp)++ = king;
-		*(*movp)++ = -1;
-		if (leads_to_check (pos->board, *movp-7, player))
-			allowed = FALSE;
-		*movp -= 7;
-
-		if (allowed)
-		{
-			*(*movp)++ = E_FILE;
-			*(*movp)++ = rank;
-			*(*movp)++ = 0;
-			*(*movp)++ = C_FILE;
-			*(*movp)++ = rank;
-			*(*movp)++ = king;
-			*(*movp)++ = A_FILE;
-			*(*movp)++ = rank;
-			*(*movp)++ = 0;
-			*(*movp)++ = D_FILE;
-			*(*movp)++ = rank;
-			*(*movp)++ = rook;
-			*(*movp)++ = -1;
-		}
-	}
-}
-
 byte *chess_movegen (Pos *pos)
 {
-	byte realbuf[4096];
-	byte *realp = realbuf;
 	byte movbuf[4096], *movp = movbuf;
 	byte *movlist;
-	int i, j, k, x, y;
-	int incxr[] = {0, 0, 1, -1};
-	int incyr[] = {1, -1, 0, 0};
-	int incxb[] = {1, 1, -1, -1};
-	int incyb[] = {1, -1, 1, -1};
-	int incxn[] = {2, 2, -2, -2, 1, 1, -1, -1};
-	int incyn[] = {1, -1, 1, -1, 2, -2, 2, -2};
-	byte *board = pos->board;
-	Player player = pos->player;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	{
-		int val = board[j * board_heit + i];
-		if ((player == WHITE && CHESS_ISWHITE (val))
-			|| (player == BLACK && CHESS_ISBLACK (val)))
-		{
-			switch (val)
-			{
-				case CHESS_WP:
-					chess_movegen_enpassant (pos, &movp, player, i, j);
-					if (ISINBOARD (i, j+1) && board [(j+1) * board_heit + i] == 0)
-					{
-						if (j == board_heit - 2)
-							chess_movegen_promote(board, &movp, player,
-								i, j, i, j+1);
-						else
-							chess_movegen_square (board, &movp, player,
-								i, j, i, j+1);
-					}
-					if (ISINBOARD (i+1, j+1) && 
-							CHESS_ISBLACK (board [(j+1) * board_heit + i+1]))
-					{
-						if (j == board_heit - 2)
-							chess_movegen_promote (board, &movp, player,
-								i, j, i+1, j+1);
-						else
-							chess_movegen_square (board, &movp, player,
-								i, j, i+1, j+1);
-					}
-					if (ISINBOARD (i-1, j+1) && 
-							CHESS_ISBLACK (board [(j+1) * board_heit + i-1]))
-					{
-						if (j == board_heit - 2)
-							chess_movegen_promote (board, &movp, player,
-								i, j, i-1, j+1);
-						else
-							chess_movegen_square (board, &movp, player,
-								i, j, i-1, j+1);
-					}
-					if (j == 1 && board [2 * board_heit + i] == 0
-							&& board [3 * board_heit + i] == 0)
-						chess_movegen_square (board, &movp, player,
-								i, j, i, j+2);
-					break;
-				case CHESS_BP:
-					chess_movegen_enpassant (pos, &movp, player, i, j);
-					if (ISINBOARD (i, j-1) && board [(j-1) * board_heit + i] == 0)
-					{
-						if (j == 1)
-							chess_movegen_promote (board, &movp, player,
-								i, j, i, j-1);
-						else
-							chess_movegen_square (board, &movp, player,
-								i, j, i, j-1);
-					}
-					if (ISINBOARD (i+1, j-1) && 
-							CHESS_ISWHITE (board [(j-1) * board_heit + i+1]))
-					{
-						if (j == 1)
-							chess_movegen_promote (board, &movp, player,
-								i, j, i+1, j-1);
-						else
-							chess_movegen_square (board, &movp, player,
-								i, j, i+1, j-1);
-					}
-					if (ISINBOARD (i-1, j-1) && 
-							CHESS_ISWHITE (board [(j-1) * board_heit + i-1]))
-					{
-						if (j == 1)
-							chess_movegen_promote (board, &movp, player,
-								i, j, i-1, j-1);
-						else
-							chess_movegen_square (board, &movp, player,
-								i, j, i-1, j-1);
-					}
-					if (j == 6 && board [5 * board_heit + i] == 0
-							&& board [4 * board_heit + i] == 0)
-						chess_movegen_square (board, &movp, player,
-								i, j, i, j-2);
-					break;
-				case CHESS_WK:
-				case CHESS_BK:
-					chess_movegen_castle (pos, &movp, player);
-					for (k=0; k<4; k++)
-						chess_movegen_square(board, &movp, player, 
-								i, j, i + incxr[k], j + incyr[k]);
-					for (k=0; k<4; k++)
-						chess_movegen_square(board, &movp, player, 
-								i, j, i + incxb[k], j + incyb[k]);
-					break;
-				case CHESS_WB:
-				case CHESS_BB:
-					for (k=0; k<4; k++)
-						chess_movegen_line (board, &movp, player, 
-								i, j, incxb[k], incyb[k]);
-					break;
-				case CHESS_WR:
-				case CHESS_BR:
-					for (k=0; k<4; k++)
-						chess_movegen_line (board, &movp, player, 
-								i, j, incxr[k], incyr[k]);
-					break;
-				case CHESS_WQ:
-				case CHESS_BQ:
-					for (k=0; k<4; k++)
-						chess_movegen_line (board, &movp, player, 
-								i, j, incxb[k], incyb[k]);
-					for (k=0; k<4; k++)
-						chess_movegen_line (board, &movp, player, 
-								i, j, incxr[k], incyr[k]);
-					break;
-				case CHESS_WN:
-				case CHESS_BN:
-					for (k=0; k<8; k++)
-						chess_movegen_square(board, &movp, player, 
-								i, j, i + incxn[k], j + incyn[k]);
-					break;
-			}
-		}
-	}
+	ChessBB bb;
+	Chess_state *state = (Chess_state *) pos->state;
+	int flags = CHESSBB_LEGAL;
+	if (!state || (pos->player == WHITE ? state->castle_WK : state->castle_BK))
+		flags |= CHESSBB_CASTLE_K;
+	if (!state || (pos->player == WHITE ? state->castle_WQ : state->castle_BQ))
+		flags |= CHESSBB_CASTLE_Q;
+	chessbb_from_board (&bb, pos->board);
+	movp = chessbb_movegen (&bb, pos->player, flags, state ? state->epfile : -1, movp);
 	*movp++ = -2;
 	
 	movlist = (byte *) malloc (movp - movbuf);
@@ -896,6 +612,42 @@ ResultType chess_eval (Pos * pos, Player player, float *eval)
 	return RESULT_NOTYET;
 }
 
+static float chess_heur_material (Pos *pos, int player)
+{
+	float eval;
+	chess_eval (pos, player, &eval);
+	return eval;
+}
+
+//! Number of moves of player, not checking whether they leave the king in check
+static int chess_count_moves (ChessBB *bb, Player player)
+{
+	byte movbuf[4096], *movp, *end;
+	int count = 0;
+	end = chessbb_movegen (bb, player, 0, -1, movbuf);
+	for (movp = movbuf; movp < end; movp++)
+		if (*movp == -1)
+			count++;
+	return count;
+}
+
+//! Material, and a tenth of a pawn for each move more than the opponent
+static float chess_heur_mobility (Pos *pos, int player)
+{
+	ChessBB bb;
+	float eval;
+	chess_eval (pos, player, &eval);
+	chessbb_from_board (&bb, pos->board);
+	return eval + 0.1 * (chess_count_moves (&bb, WHITE) - chess_count_moves (&bb, BLACK));
+}
+
+HeurTab chess_heurtab[] = 
+{
+	{ "material", chess_heur_material, "material only", NULL },
+	{ "mobility", chess_heur_mobility, "material and the number of moves", NULL },
+	{ NULL, NULL, NULL, NULL },
+};
+
 // Local Variables:
 // tab-width: 4
 // End:
@@ -0,0 +1,463 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "game.h"
+#include "chessbb.h"
+
+/** \file chessbb.c
+  \brief Bitboard move generation for chess and antichess.
+
+  Sliding attacks are looked up in "kindergarten" tables: the occupancy
+  of the line through the square, less its two end squares, is gathered
+  into 6 bits by a multiplication and used as an index into a table of
+  attacks along the first rank (for ranks and diagonals) or the a-file
+  (for files).
+
+  Legality is checked with a check mask and pin masks: when the king is
+  in check, the other pieces may only move to the squares between the
+  king and the checker or capture the checker, and a pinned piece may
+  only move along the line between the king and the pinner. The king
+  itself may not move to an attacked square. Only en passant, which can
+  uncover an attack along the rank, is checked by trying it out.
+  */
+
+#define CHESSBB_KING 1
+#define CHESSBB_QUEEN 2
+#define CHESSBB_ROOK 3
+#define CHESSBB_BISHOP 4
+#define CHESSBB_KNIGHT 5
+#define CHESSBB_PAWN 6
+
+//! The directions N, S, E, W, NE, SE, NW, SW
+static int dir_x [8] = {0, 0, 1, -1, 1, 1, -1, -1};
+static int dir_y [8] = {1, -1, 0, 0, 1, -1, 1, -1};
+
+static int knight_x [8] = {2, 2, -2, -2, 1, 1, -1, -1};
+static int knight_y [8] = {1, -1, 1, -1, 2, -2, 2, -2};
+
+static Bitboard knight_attacks [64], king_attacks [64];
+//! pawn_attacks[0] for the white pawns, [1] for the black
+static Bitboard pawn_attacks [2][64];
+//! The squares from sq in each direction, not including sq
+static Bitboard ray [8][64];
+//! The squares strictly between two squares on a line, 0 if they are not on a line
+static Bitboard between [64][64];
+
+static Bitboard rank_mask [64], diag_mask [64], antidiag_mask [64];
+//! Attacks along a rank, copied to all the ranks, by file and inner occupancy
+static Bitboard fill_up_attacks [8][64];
+//! Attacks along the a-file, by rank and inner occupancy
+static Bitboard a_file_attacks [8][64];
+
+static const Bitboard file_a = G_GUINT64_CONSTANT(0x0101010101010101);
+static const Bitboard file_b = G_GUINT64_CONSTANT(0x0202020202020202);
+static const Bitboard diag_c7b2 = G_GUINT64_CONSTANT(0x0004081020408000);
+static const Bitboard debruijn = G_GUINT64_CONSTANT(0x03f79d71b4cb0a89);
+
+static int bitscan_table [64];
+
+static gboolean chessbb_inited = FALSE;
+
+//! Index of the lowest set bit
+static int bb_first (Bitboard b)
+{
+	return bitscan_table [((b ^ (b - 1)) * debruijn) >> 58];
+}
+
+//! Index of the highest set bit
+static int bb_last (Bitboard b)
+{
+	b |= b >> 1;
+	b |= b >> 2;
+	b |= b >> 4;
+	b |= b >> 8;
+	b |= b >> 16;
+	b |= b >> 32;
+	return bitscan_table [(b * debruijn) >> 58];
+}
+
+static Bitboard rank_attacks (int sq, Bitboard occ)
+{
+	occ = ((rank_mask [sq] & occ) * file_b) >> 58;
+	return rank_mask [sq] & fill_up_attacks [sq & 7][occ];
+}
+
+static Bitboard file_attacks (int sq, Bitboard occ)
+{
+	occ = file_a & (occ >> (sq & 7));
+	occ = (diag_c7b2 * occ) >> 58;
+	return a_file_attacks [sq >> 3][occ] << (sq & 7);
+}
+
+static Bitboard diag_attacks (int sq, Bitboard occ)
+{
+	occ = ((diag_mask [sq] & occ) * file_b) >> 58;
+	return diag_mask [sq] & fill_up_attacks [sq & 7][occ];
+}
+
+static Bitboard antidiag_attacks (int sq, Bitboard occ)
+{
+	occ = ((antidiag_mask [sq] & occ) * file_b) >> 58;
+	return antidiag_mask [sq] & fill_up_attacks [sq & 7][occ];
+}
+
+static Bitboard rook_attacks (int sq, Bitboard occ)
+{
+	return rank_attacks (sq, occ) | file_attacks (sq, occ);
+}
+
+static Bitboard bishop_attacks (int sq, Bitboard occ)
+{
+	return diag_attacks (sq, occ) | antidiag_attacks (sq, occ);
+}
+
+//! Attacks from sq in direction d, found by walking the ray. Only used to build the tables.
+static Bitboard slow_ray_attacks (int sq, int d, Bitboard occ)
+{
+	Bitboard att = 0;
+	int x = sq % 8 + dir_x[d], y = sq / 8 + dir_y[d];
+	for (; x >= 0 && x < 8 && y >= 0 && y < 8; x += dir_x[d], y += dir_y[d])
+	{
+		att |= CHESSBB_BIT (y * 8 + x);
+		if (occ & CHESSBB_BIT (y * 8 + x))
+			break;
+	}
+	return att;
+}
+
+void chessbb_init ()
+{
+	int sq, d, k, i, occ6;
+	if (chessbb_inited)
+		return;
+	chessbb_inited = TRUE;
+	for (i=0; i<64; i++)
+	{
+		Bitboard b = CHESSBB_BIT (i);
+		bitscan_table [(((b << 1) - 1) * debruijn) >> 58] = i;
+	}
+	for (sq=0; sq<64; sq++)
+	{
+		int x = sq % 8, y = sq / 8;
+		knight_attacks [sq] = king_attacks [sq] = 0;
+		for (k=0; k<8; k++)
+		{
+			int nx = x + knight_x[k], ny = y + knight_y[k];
+			if (nx >= 0 && nx < 8 && ny >= 0 && ny < 8)
+				knight_attacks [sq] |= CHESSBB_BIT (ny * 8 + nx);
+			nx = x + dir_x[k], ny = y + dir_y[k];
+			if (nx >= 0 && nx < 8 && ny >= 0 && ny < 8)
+				king_attacks [sq] |= CHESSBB_BIT (ny * 8 + nx);
+		}
+		pawn_attacks [0][sq] = pawn_attacks [1][sq] = 0;
+		for (i=-1; i<=1; i+=2)
+		{
+			if (x + i < 0 || x + i >= 8)
+				continue;
+			if (y < 7)
+				pawn_attacks [0][sq] |= CHESSBB_BIT ((y + 1) * 8 + x + i);
+			if (y > 0)
+				pawn_attacks [1][sq] |= CHESSBB_BIT ((y - 1) * 8 + x + i);
+		}
+		for (d=0; d<8; d++)
+		{
+			Bitboard b, path = 0;
+			ray [d][sq] = slow_ray_attacks (sq, d, 0);
+			for (b = ray [d][sq]; b; )
+			{
+				int to = d == 0 || d == 2 || d == 4 || d == 6 ? bb_first (b) : bb_last (b);
+				between [sq][to] = path;
+				path |= CHESSBB_BIT (to);
+				b &= ~CHESSBB_BIT (to);
+			}
+		}
+		rank_mask [sq] = (ray [2][sq] | ray [3][sq]);
+		diag_mask [sq] = (ray [4][sq] | ray [7][sq]);
+		antidiag_mask [sq] = (ray [5][sq] | ray [6][sq]);
+	}
+
+	for (occ6=0; occ6<64; occ6++)
+	{
+		Bitboard occ_rank = (Bitboard) occ6 << 1, occ_file = 0;
+		for (i=0; i<6; i++)
+			if (occ6 & (1 << i))
+				occ_file |= CHESSBB_BIT ((i + 1) * 8);
+		for (i=0; i<8; i++)
+		{
+			Bitboard att = slow_ray_attacks (i, 2, occ_rank) 
+				| slow_ray_attacks (i, 3, occ_rank);
+			fill_up_attacks [i][(occ_rank * file_b) >> 58] = att * file_a;
+			a_file_attacks [i][(occ_file * diag_c7b2) >> 58] = 
+				slow_ray_attacks (i * 8, 0, occ_file) | slow_ray_attacks (i * 8, 1, occ_file);
+		}
+	}
+}
+
+void chessbb_from_board (ChessBB *bb, byte *board)
+{
+	int sq;
+	memset (bb, 0, sizeof (ChessBB));
+	bb->board = board;
+	for (sq=0; sq<64; sq++)
+	{
+		int val = board [sq];
+		if (val <= 0 || val > 12)
+			continue;
+		bb->pieces [val] |= CHESSBB_BIT (sq);
+		bb->color [val <= 6 ? 0 : 1] |= CHESSBB_BIT (sq);
+	}
+	bb->occupied = bb->color [0] | bb->color [1];
+}
+
+//! The pieces of color c (0 for white) that attack sq, with the given occupancy
+static Bitboard chessbb_attackers (ChessBB *bb, int sq, int c, Bitboard occ)
+{
+	Bitboard *p = bb->pieces + (c ? 6 : 0);
+	return ((knight_attacks [sq] & p [CHESSBB_KNIGHT])
+		| (king_attacks [sq] & p [CHESSBB_KING])
+		| (pawn_attacks [!c][sq] & p [CHESSBB_PAWN])
+		| (bishop_attacks (sq, occ) & (p [CHESSBB_BISHOP] | p [CHESSBB_QUEEN]))
+		| (rook_attacks (sq, occ) & (p [CHESSBB_ROOK] | p [CHESSBB_QUEEN]))) & occ;
+}
+
+gboolean chessbb_in_check (ChessBB *bb, Player player)
+{
+	int us = player == WHITE ? 0 : 1;
+	Bitboard king = bb->pieces [us * 6 + CHESSBB_KING];
+	if (!king)
+		return FALSE;
+	return chessbb_attackers (bb, bb_first (king), !us, bb->occupied) != 0;
+}
+
+static byte *chessbb_add_move (byte *movp, int from, int to, int val)
+{
+	*movp++ = from % 8;
+	*movp++ = from / 8;
+	*movp++ = 0;
+	*movp++ = to % 8;
+	*movp++ = to / 8;
+	*movp++ = val;
+	*movp++ = -1;
+	return movp;
+}
+
+static byte *chessbb_add_pawn_move (byte *movp, int from, int to, int val)
+{
+	static int promote_pieces [4] = {CHESSBB_QUEEN, CHESSBB_ROOK, 
+		CHESSBB_BISHOP, CHESSBB_KNIGHT};
+	int k;
+	if (to / 8 != 0 && to / 8 != 7)
+		return chessbb_add_move (movp, from, to, val);
+	for (k=0; k<4; k++)
+		movp = chessbb_add_move (movp, from, to, 
+				promote_pieces [k] + (val == CHESSBB_PAWN ? 0 : 6));
+	return movp;
+}
+
+//! Adds the moves to the squares in dests, which are in direction d from sq, nearest first
+static byte *chessbb_add_ray_moves (byte *movp, int sq, int d, Bitboard dests, int val)
+{
+	while (dests)
+	{
+		int to = d == 0 || d == 2 || d == 4 || d == 6 ? bb_first (dests) : bb_last (dests);
+		movp = chessbb_add_move (movp, sq, to, val);
+		dests &= ~CHESSBB_BIT (to);
+	}
+	return movp;
+}
+
+static byte *chessbb_add_castle (ChessBB *bb, byte *movp, int us, int kingside)
+{
+	int rank = us ? 7 : 0;
+	int king = us * 6 + CHESSBB_KING, rook = us * 6 + CHESSBB_ROOK;
+	int ksq = rank * 8 + 4;
+	int rsq = rank * 8 + (kingside ? 7 : 0);
+	int kto = rank * 8 + (kingside ? 6 : 2), rto = rank * 8 + (kingside ? 5 : 3);
+	Bitboard occ = bb->occupied ^ CHESSBB_BIT (ksq);
+	if (!(bb->pieces [rook] & CHESSBB_BIT (rsq)))
+		return movp;
+	if (between [ksq][rsq] & bb->occupied)
+		return movp;
+	if (chessbb_attackers (bb, rto, !us, occ) || chessbb_attackers (bb, kto, !us, occ))
+		return movp;
+	*movp++ = 4;
+	*movp++ = rank;
+	*movp++ = 0;
+	*movp++ = kto % 8;
+	*movp++ = rank;
+	*movp++ = king;
+	*movp++ = rsq % 8;
+	*movp++ = rank;
+	*movp++ = 0;
+	*movp++ = rto % 8;
+	*movp++ = rank;
+	*movp++ = rook;
+	*movp++ = -1;
+	return movp;
+}
+
+//! En passant by the pawn on sq, if it doesn't leave the king in check
+static byte *chessbb_add_enpassant (ChessBB *bb, byte *movp, int us, int sq, int epfile, int ksq)
+{
+	int capsq = (sq / 8) * 8 + epfile;
+	int to = capsq + (us ? -8 : 8);
+	int val = us * 6 + CHESSBB_PAWN;
+	if (ksq >= 0)
+	{
+		Bitboard occ = (bb->occupied ^ CHESSBB_BIT (sq) ^ CHESSBB_BIT (capsq)) | CHESSBB_BIT (to);
+		if (chessbb_attackers (bb, ksq, !us, occ))
+			return movp;
+	}
+	*movp++ = sq % 8;
+	*movp++ = sq / 8;
+	*movp++ = 0;
+	*movp++ = to % 8;
+	*movp++ = to / 8;
+	*movp++ = val;
+	*movp++ = capsq % 8;
+	*movp++ = capsq / 8;
+	*movp++ = 0;
+	*movp++ = -1;
+	return movp;
+}
+
+byte *chessbb_movegen (ChessBB *bb, Player player, int flags, int epfile, byte *movp)
+{
+	int us = player == WHITE ? 0 : 1, them = !us;
+	Bitboard own = bb->color [us], opp = bb->color [them], occ = bb->occupied;
+	Bitboard checkmask = ~(Bitboard) 0, checkers = 0, pinned = 0, snipers;
+	Bitboard pinmask [64];
+	int ksq = -1, i, j, k, d;
+	gboolean legal = (flags & CHESSBB_LEGAL) != 0;
+
+	if (legal && bb->pieces [us * 6 + CHESSBB_KING])
+	{
+		ksq = bb_first (bb->pieces [us * 6 + CHESSBB_KING]);
+		checkers = chessbb_attackers (bb, ksq, them, occ);
+		if (checkers & (checkers - 1))
+			checkmask = 0;
+		else if (checkers)
+			checkmask = checkers | between [ksq][bb_first (checkers)];
+		snipers = (rook_attacks (ksq, opp) & (bb->pieces [them * 6 + CHESSBB_ROOK] 
+					| bb->pieces [them * 6 + CHESSBB_QUEEN]))
+			| (bishop_attacks (ksq, opp) & (bb->pieces [them * 6 + CHESSBB_BISHOP]
+					| bb->pieces [them * 6 + CHESSBB_QUEEN]));
+		while (snipers)
+		{
+			int s = bb_first (snipers);
+			Bitboard b = between [ksq][s] & occ;
+			if (b && !(b & (b - 1)) && (b & own))
+			{
+				pinned |= b;
+				pinmask [bb_first (b)] = between [ksq][s] | CHESSBB_BIT (s);
+			}
+			snipers &= snipers - 1;
+		}
+	}
+
+	for (i=0; i<8; i++)
+	for (j=0; j<8; j++)
+	{
+		int sq = j * 8 + i, val, to;
+		Bitboard allowed, att;
+		if (!(own & CHESSBB_BIT (sq)))
+			continue;
+		val = bb->board [sq];
+		allowed = ~own & checkmask;
+		if (pinned & CHESSBB_BIT (sq))
+			allowed &= pinmask [sq];
+		switch (val - us * 6)
+		{
+			case CHESSBB_PAWN:
+				{
+				int fwd = us ? -8 : 8;
+				if (j == (us ? 0 : 7))
+					break;
+				if (legal && epfile >= 0 && j == (us ? 3 : 4) && abs (i - epfile) == 1)
+					movp = chessbb_add_enpassant (bb, movp, us, sq, epfile, ksq);
+				to = sq + fwd;
+				if (!(occ & CHESSBB_BIT (to)) && (allowed & CHESSBB_BIT (to)))
+					movp = chessbb_add_pawn_move (movp, sq, to, val);
+				if (i < 7 && (opp & allowed & CHESSBB_BIT (to + 1)))
+					movp = chessbb_add_pawn_move (movp, sq, to + 1, val);
+				if (i > 0 && (opp & allowed & CHESSBB_BIT (to - 1)))
+					movp = chessbb_add_pawn_move (movp, sq, to - 1, val);
+				if (j == (us ? 6 : 1) && !(occ & CHESSBB_BIT (to)) 
+						&& !(occ & CHESSBB_BIT (to + fwd)) 
+						&& (allowed & CHESSBB_BIT (to + fwd)))
+					movp = chessbb_add_move (movp, sq, to + fwd, val);
+				}
+				break;
+			case CHESSBB_KING:
+				if (ksq >= 0 && !checkers && j == us * 7 && i == 4)
+				{
+					if (flags & CHESSBB_CASTLE_K)
+						movp = chessbb_add_castle (bb, movp, us, TRUE);
+					if (flags & CHESSBB_CASTLE_Q)
+						movp = chessbb_add_castle (bb, movp, us, FALSE);
+				}
+				for (d=0; d<8; d++)
+				{
+					int x = i + dir_x[d], y = j + dir_y[d];
+					if (x < 0 || x >= 8 || y < 0 || y >= 8)
+						continue;
+					to = y * 8 + x;
+					if (own & CHESSBB_BIT (to))
+						continue;
+					if (ksq >= 0 && chessbb_attackers (bb, to, them, occ ^ CHESSBB_BIT (sq)))
+						continue;
+					movp = chessbb_add_move (movp, sq, to, val);
+				}
+				break;
+			case CHESSBB_KNIGHT:
+				att = knight_attacks [sq] & allowed;
+				for (k=0; k<8; k++)
+				{
+					int x = i + knight_x[k], y = j + knight_y[k];
+					if (x < 0 || x >= 8 || y < 0 || y >= 8)
+						continue;
+					if (att & CHESSBB_BIT (y * 8 + x))
+						movp = chessbb_add_move (movp, sq, y * 8 + x, val);
+				}
+				break;
+			case CHESSBB_BISHOP:
+				att = bishop_attacks (sq, occ) & allowed;
+				for (d=4; d<8; d++)
+					movp = chessbb_add_ray_moves (movp, sq, d, att & ray [d][sq], val);
+				break;
+			case CHESSBB_ROOK:
+				att = rook_attacks (sq, occ) & allowed;
+				for (d=0; d<4; d++)
+					movp = chessbb_add_ray_moves (movp, sq, d, att & ray [d][sq], val);
+				break;
+			case CHESSBB_QUEEN:
+				att = (bishop_attacks (sq, occ) | rook_attacks (sq, occ)) & allowed;
+				for (d=4; d<8; d++)
+					movp = chessbb_add_ray_moves (movp, sq, d, att & ray [d][sq], val);
+				for (d=0; d<4; d++)
+					movp = chessbb_add_ray_moves (movp, sq, d, att & ray [d][sq], val);
+				break;
+		}
+	}
+	return movp;
+}
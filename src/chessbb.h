@@ -0,0 +1,76 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _CHESSBB_H_
+#define _CHESSBB_H_
+
+#include "game.h"
+
+/** \file chessbb.h
+  \brief Bitboard move generation for chess and antichess.
+
+  Square sq of a bitboard is (x, y) = (sq % 8, sq / 8), the same order
+  as Pos::board, so a1 is bit 0 and h8 is bit 63. The piece values are
+  the ones used by both chess.c and antichess.c: 1 to 6 are the white
+  king, queen, rook, bishop, knight and pawn, and 7 to 12 the black ones.
+  */
+
+typedef guint64 Bitboard;
+
+#define CHESSBB_BIT(sq) (G_GUINT64_CONSTANT(1) << (sq))
+
+//! The bitboards of a position
+typedef struct
+{
+	//! The squares of each kind of piece, indexed by the value of the piece
+	Bitboard pieces [13];
+	//! All the white pieces and all the black pieces
+	Bitboard color [2];
+	Bitboard occupied;
+	//! The board these were made from
+	byte *board;
+} ChessBB;
+
+//! Flags for chessbb_movegen()
+enum {
+	//! Leave out the moves that leave the king in check, and generate en passant
+	CHESSBB_LEGAL = 1,
+	//! The side to move may castle on the king's side
+	CHESSBB_CASTLE_K = 2,
+	//! The side to move may castle on the queen's side
+	CHESSBB_CASTLE_Q = 4,
+};
+
+//! Builds the attack tables. Must be called before the other functions.
+void chessbb_init ();
+
+//! Fills the bitboards from a board in the format of Pos::board
+void chessbb_from_board (ChessBB *bb, byte *board);
+
+//! Is the king of the given side attacked
+gboolean chessbb_in_check (ChessBB *bb, Player player);
+
+//! Writes the moves of player, each terminated by -1, starting at movp
+/** epfile is the file of a pawn that has just moved two squares, or -1.
+  The moves come in the same order as in the old byte board movegen:
+  the pieces by file and then rank, and for each piece its destinations
+  direction by direction. Returns a pointer past the last move; the list
+  is not terminated by -2. */
+byte *chessbb_movegen (ChessBB *bb, Player player, int flags, int epfile, byte *movp);
+
+#endif
@@ -173,6 +173,8 @@ static char * dnb_horizontal_24_xpm [] =
 #define DNB_RED   4
 #define DNB_BLUE  5
 
+#define DNB_ISEDGE(x, y) (((x) + (y)) % 2 == 1)
+
 #define abs(x) ((x) < 0 ? -(x) : (x))
 
 int dnb_getmove (Pos *, int, int, GtkboardEventType, Player, byte **, int **);
@@ -193,11 +195,6 @@ static int dnb_curx = - 1, dnb_cury = -1;
 
 void dnb_init ()
 {
-//	game_getmove = dnb_getmove;
-/*	game_who_won = dnb_who_won;
-	game_eval = dnb_eval;
-	game_movegen = dnb_movegen;
-*/
 	game_set_init_pos = dnb_set_init_pos;
 	game_get_pixmap = dnb_get_pixmap;
 	game_get_render = dnb_get_render;
@@ -205,12 +202,13 @@ void dnb_init ()
 	game_black_string = "Blue";
 	game_getmove = dnb_getmove;
 	game_search = dnb_search;
+	game_who_won = dnb_who_won;
 	game_allow_flip = TRUE;
-	game_doc_about_status = STATUS_UNPLAYABLE;
+	game_doc_about_status = STATUS_PARTIAL;
 	game_doc_about = 
 		"Dots and boxes\n"
 		"Two player game\n"
-		"Status: partially implemented (the AI is totally dumb)\n"
+		"Status: partially implemented\n"
 		"URL: "GAME_DEFAULT_URL ("dnb");
 }
 
@@ -242,20 +240,33 @@ void dnb_set_init_pos (Pos *pos)
 			pos->board[j * board_wid + i] = DNB_EMPTY;
 }
 
-/*
 ResultType dnb_who_won (Pos *pos, Player player, char ** commp)
 {
-	char *who_str[2] = {"Vertical won", "Horizontal won"};
-	int wscore, bscore, i, j;
-	float eval;
-	ResultType result;
-	result = dnb_eval (pos, player, &eval);
-	if (result == RESULT_WHITE) *commp = who_str[0];
-	if (result == RESULT_BLACK) *commp = who_str[1];
-	printf ("%f\n", eval);
-	return result;
+	static char comment[48];
+	char *who_str [3] = { "Red won", "Blue won", "its a tie" };
+	int i, red = 0, blue = 0, who_idx;
+	for (i=0; i<board_wid * board_heit; i++)
+		if (pos->board[i] == DNB_RED)
+			red++;
+		else if (pos->board[i] == DNB_BLUE)
+			blue++;
+	if (red + blue < DNB_BOARD_SIZE * DNB_BOARD_SIZE)
+	{
+		snprintf (comment, 48, "%d : %d", red, blue);
+		*commp = comment;
+		return RESULT_NOTYET;
+	}
+	if (red > blue) who_idx = 0;
+	else if (red < blue) who_idx = 1;
+	else who_idx = 2;
+	snprintf (comment, 48, "%s (%d : %d)", who_str [who_idx], red, blue);
+	*commp = comment;
+	if (red > blue)
+		return RESULT_WHITE;
+	if (red < blue)
+		return RESULT_BLACK;
+	return RESULT_TIE;
 }
-*/
 
 static int dnb_incx[] = {-1, 0, 0, 1};
 static int dnb_incy[] = {0, -1, 1, 0};
@@ -344,7 +355,12 @@ int dnb_getmove (Pos *pos, int x, int y, GtkboardEventType type, Player player,
 			}
 	}
 	*rp++ = -1;
-	if (found)
+	// the turn goes on after a box, unless that was the last edge
+	for (i=0; found && i<board_wid * board_heit; i++)
+		if (i != newy * board_wid + newx && DNB_ISEDGE (i % board_wid, i / board_wid)
+				&& pos->board[i] == DNB_EMPTY && pos->render[i] == RENDER_NONE)
+			break;
+	if (found && i < board_wid * board_heit)
 	{
 		*rmovp = rmove;
 		return 0;
@@ -391,61 +407,488 @@ static void dnb_get_render (Pos *pos, byte *move, int **rmovp)
 }
 
 
-void dnb_search (Pos *pos, byte **movp)
+/* The AI. A turn is a run of edges that complete boxes followed by one edge
+   that doesn't. The search is negamax over single edges, scored in boxes
+   for the player to move, where completing a box gives the player another
+   edge. A box with three walls is always taken, except that the player may
+   decline the last two boxes of a chain (or four of a loop) by drawing the
+   far wall of the second box, which is the only way to keep control. Once
+   no safe edge is left the rest of the game is mostly a sum of chains and
+   loops, and the static eval plays that out. */
+
+#define DNB_NUM_CELLS (DNB_BOARD_WID * DNB_BOARD_HEIT)
+
+//! Depth of the search when neither a depth nor a time is given
+#define DNB_DEFAULT_DEPTH 3
+
+//! Number of entries of the transposition table; must be a power of 2
+#define DNB_TT_SIZE (1 << 16)
+
+//! Number of entries of the table of chain endgames; must be a power of 2
+#define DNB_CHAINS_CACHE_SIZE (1 << 12)
+
+extern int time_per_move;
+extern int ab_max_depth;
+
+enum {DNB_TT_EXACT, DNB_TT_LOWER, DNB_TT_UPPER};
+
+typedef struct
 {
-	/* first greedily close all possible squares, then choose some edge arbitrarily */
-	// TODO: this AI needs MAJOR improvement
-	static byte move[2048];
-	byte *mp = move;
-	int i, j;
-	gboolean found;
-	static byte newboard[DNB_BOARD_WID * DNB_BOARD_HEIT];
-	Player player = pos->player;
-	memcpy (newboard, pos->board, board_wid * board_heit);
-	
-	do // very slow, but speed probably doesn't matter here
+	guint64 key;
+	short val;
+	short move;
+	byte depth;
+	byte flag;
+} DnbTTEntry;
+
+typedef struct
+{
+	guint64 key;
+	int val;
+} DnbChainsEntry;
+
+static byte dnb_board [DNB_NUM_CELLS];
+//! Number of walls of each box, indexed like the board
+static byte dnb_walls [DNB_NUM_CELLS];
+static guint64 dnb_zobrist [DNB_NUM_CELLS];
+static guint64 dnb_key;
+static DnbTTEntry dnb_tt [DNB_TT_SIZE];
+static DnbChainsEntry dnb_chains_cache [DNB_CHAINS_CACHE_SIZE];
+static int dnb_nodes;
+static gboolean dnb_stop;
+static GTimer *dnb_timer = NULL;
+
+//! The boxes on either side of the edge e; returns how many there are
+static int dnb_edge_boxes (int e, int *boxes)
+{
+	int x = e % board_wid, y = e / board_wid, n = 0;
+	if (x % 2 == 1)
+	{
+		if (y > 0) boxes[n++] = e - board_wid;
+		if (y < board_heit - 1) boxes[n++] = e + board_wid;
+	}
+	else
+	{
+		if (x > 0) boxes[n++] = e - 1;
+		if (x < board_wid - 1) boxes[n++] = e + 1;
+	}
+	return n;
+}
+
+//! The edge of box b that is still free, other than the edge not
+static int dnb_free_edge (int b, int not)
+{
+	int k;
+	for (k=0; k<4; k++)
+	{
+		int e = b + dnb_incy[k] * board_wid + dnb_incx[k];
+		if (e != not && dnb_board[e] == DNB_EMPTY)
+			return e;
+	}
+	return -1;
+}
+
+//! Draws the edge e; returns the number of boxes completed
+static int dnb_draw (int e)
+{
+	int boxes[2], n, i, count = 0;
+	dnb_board[e] = (e % board_wid) % 2 == 0 ? DNB_VERT : DNB_HOR;
+	dnb_key ^= dnb_zobrist[e];
+	n = dnb_edge_boxes (e, boxes);
+	for (i=0; i<n; i++)
+		if (++dnb_walls[boxes[i]] == 4)
+			count++;
+	return count;
+}
+
+static void dnb_undraw (int e)
+{
+	int boxes[2], n, i;
+	dnb_board[e] = DNB_EMPTY;
+	dnb_key ^= dnb_zobrist[e];
+	n = dnb_edge_boxes (e, boxes);
+	for (i=0; i<n; i++)
+		dnb_walls[boxes[i]]--;
+}
+
+//! Whether drawing e would give the opponent a box
+static gboolean dnb_edge_is_safe (int e)
+{
+	int boxes[2], n, i;
+	n = dnb_edge_boxes (e, boxes);
+	for (i=0; i<n; i++)
+		if (dnb_walls[boxes[i]] == 2)
+			return FALSE;
+	return TRUE;
+}
+
+//! The box on the other side of the edge e from box b, or -1
+static int dnb_other_box (int e, int b)
+{
+	int boxes[2], n = dnb_edge_boxes (e, boxes);
+	if (n < 2)
+		return -1;
+	return boxes[0] == b ? boxes[1] : boxes[0];
+}
+
+/* Finds a box with three walls. Returns the edge that takes it, or -1.
+   If these are the last two boxes of a chain or the last four of a loop,
+   *decline is the edge that hands them over instead, else -1. */
+static int dnb_find_capture (int *decline)
+{
+	int x, y, take = -1;
+	*decline = -1;
+	for (x=1; x<board_wid; x+=2)
+	for (y=1; y<board_heit; y+=2)
 	{
-		found = FALSE;
-		for (i=1; i<board_wid; i+=2)
-		for (j=1; j<board_heit; j+=2)
-			if (num_nbr_walls (newboard, NULL, i, j) == 3)
+		int b = y * board_wid + x, e, e2, next, far, end = -1;
+		if (dnb_walls[b] != 3)
+			continue;
+		e = dnb_free_edge (b, -1);
+		next = dnb_other_box (e, b);
+		if (next < 0 || dnb_walls[next] != 2)
+			return *decline = -1, e;
+		e2 = dnb_free_edge (next, e);
+		far = dnb_other_box (e2, next);
+		if (far >= 0 && dnb_walls[far] == 2)
+			end = dnb_other_box (dnb_free_edge (far, e2), far);
+		// nothing to decline in the middle of a chain
+		if (far >= 0 && (dnb_walls[far] == 3 
+					|| (dnb_walls[far] == 2 && (end < 0 || dnb_walls[end] != 3))))
+			return *decline = -1, e;
+		if (take < 0)
+		{
+			take = e;
+			*decline = e2;
+		}
+	}
+	return take;
+}
+
+static int dnb_chains_compare (const void *a, const void *b)
+{
+	return *(int *)a - *(int *)b;
+}
+
+/* The value of a sum of chains (sizes > 0) and loops (sizes < 0) for the
+   player who has to open one of them */
+static int dnb_chains_value (int *comps, int n)
+{
+	int i, best = -DNB_NUM_CELLS, rest[DNB_NUM_CELLS / 4];
+	guint64 key = G_GUINT64_CONSTANT(14695981039346656037);
+	DnbChainsEntry *entry;
+	if (n == 0)
+		return 0;
+	for (i=0; i<n; i++)
+		key = (key ^ (byte) comps[i]) * G_GUINT64_CONSTANT(1099511628211);
+	key |= 1;
+	entry = &dnb_chains_cache[key & (DNB_CHAINS_CACHE_SIZE - 1)];
+	if (entry->key == key)
+		return entry->val;
+	for (i=0; i<n; i++)
+	{
+		int size = abs (comps[i]), r, opp;
+		if (i > 0 && comps[i] == comps[i-1])
+			continue;
+		memcpy (rest, comps, i * sizeof (int));
+		memcpy (rest + i, comps + i + 1, (n - i - 1) * sizeof (int));
+		r = dnb_chains_value (rest, n - 1);
+		// the opponent takes it all and opens the next, or keeps control
+		opp = size + r;
+		if (comps[i] >= 3 && size - 4 - r > opp)
+			opp = size - 4 - r;
+		if (comps[i] < 0 && size - 8 - r > opp)
+			opp = size - 8 - r;
+		if (-opp > best)
+			best = -opp;
+	}
+	entry->key = key;
+	entry->val = best;
+	return best;
+}
+
+/* Scores a position that has nothing to take. With safe edges left, the
+   player who draws the last of them gets control, so count them. Otherwise
+   split the boxes into chains and loops and play them out. */
+static int dnb_static_eval ()
+{
+	int x, y, e, k, n = 0, safe = 0, left = 0;
+	int comps [DNB_NUM_CELLS / 4];
+	byte seen [DNB_NUM_CELLS];
+	for (e=0; e<board_wid * board_heit; e++)
+		if (dnb_board[e] == DNB_EMPTY && DNB_ISEDGE (e % board_wid, e / board_wid))
+			if (dnb_edge_is_safe (e))
+				safe++;
+	for (x=1; x<board_wid; x+=2)
+	for (y=1; y<board_heit; y+=2)
+		if (dnb_walls[y * board_wid + x] < 4)
+			left++;
+	if (safe > 0)
+		return safe % 2 ? left / 4 : -left / 4;
+	memset (seen, 0, sizeof (seen));
+	for (x=1; x<board_wid; x+=2)
+	for (y=1; y<board_heit; y+=2)
+	{
+		int b = y * board_wid + x, size = 0, ends = 0, cur, prev;
+		if (seen[b] || dnb_walls[b] != 2)
+			continue;
+		// walk both ways from b along the free edges
+		seen[b] = 1;
+		size = 1;
+		for (k=0; k<4; k++)
+		{
+			e = b + dnb_incy[k] * board_wid + dnb_incx[k];
+			if (dnb_board[e] != DNB_EMPTY)
+				continue;
+			prev = b;
+			for (cur = e; ; )
 			{
-				int k, newx, newy, newval;
-				for (k=0; k<4; k++)
+				int boxes[2], m = dnb_edge_boxes (cur, boxes), next;
+				next = (m == 2 ? (boxes[0] == prev ? boxes[1] : boxes[0]) : -1);
+				if (next < 0 || dnb_walls[next] != 2)
 				{
-					newx = i + dnb_incx[k];
-					newy = j + dnb_incy[k];
-					if (newboard [newy * board_wid + newx] == DNB_EMPTY)
-					{
-						newval = (newx % 2 == 0 ? DNB_VERT : DNB_HOR);
-						*mp++ = newx;
-						*mp++ = newy;
-						*mp++ = newval;
-						newboard [newy * board_wid + newx] = newval;
-					}
+					ends++;
+					break;
 				}
-				newval = (player == WHITE ? DNB_RED : DNB_BLUE);
-				*mp++ = i;
-				*mp++ = j;
-				*mp++ = newval;
-				newboard [j * board_wid + i] = newval;
-				found = TRUE;
+				if (seen[next])
+					break;
+				seen[next] = 1;
+				size++;
+				cur = dnb_free_edge (next, cur);
+				prev = next;
 			}
-	} while (found);
+		}
+		comps[n++] = ends > 0 ? size : -size;
+	}
+	qsort (comps, n, sizeof (int), dnb_chains_compare);
+	return dnb_chains_value (comps, n);
+}
+
+static gboolean dnb_out_of_time ()
+{
+	if (++dnb_nodes % 4096 != 0 || time_per_move <= 0)
+		return dnb_stop;
+	if (g_timer_elapsed (dnb_timer, NULL) * 1000 > time_per_move)
+		dnb_stop = TRUE;
+	return dnb_stop;
+}
 
-	while (1) // FIXME: inf. loop when game is over
+static int dnb_negamax (int depth, int alpha, int beta)
+{
+	int take, decline, val, best, best_move = -1, e, pass, count = 0;
+	int alpha0 = alpha;
+	DnbTTEntry *entry;
+
+	if (dnb_out_of_time ())
+		return 0;
+	take = dnb_find_capture (&decline);
+	if (take >= 0)
 	{
-		i = random() % board_wid;
-		j = random() % board_heit;
-		if ((i+j) % 2 == 0) continue;
-		if (newboard [j * board_wid + i] != DNB_EMPTY) continue;
-		*mp++ = i;
-		*mp++ = j;
-		*mp++ = (i % 2 == 0 ? DNB_VERT : DNB_HOR);
-		*mp++ = -1;
-		*movp = move;
+		int c = dnb_draw (take);
+		best = c + dnb_negamax (depth, alpha - c, beta - c);
+		dnb_undraw (take);
+		if (decline >= 0 && best < beta)
+		{
+			c = dnb_draw (decline);
+			val = c > 0 ? c + dnb_negamax (depth, alpha - c, beta - c) 
+				: -dnb_negamax (depth, -beta, -alpha);
+			dnb_undraw (decline);
+			if (val > best)
+				best = val;
+		}
+		return best;
+	}
+	if (depth <= 0)
+		return dnb_static_eval ();
+
+	entry = &dnb_tt[dnb_key & (DNB_TT_SIZE - 1)];
+	if (entry->key == dnb_key)
+	{
+		if (entry->depth >= depth)
+		{
+			if (entry->flag == DNB_TT_EXACT)
+				return entry->val;
+			if (entry->flag == DNB_TT_LOWER && entry->val >= beta)
+				return entry->val;
+			if (entry->flag == DNB_TT_UPPER && entry->val <= alpha)
+				return entry->val;
+		}
+		best_move = entry->move;
+	}
+
+	best = -DNB_NUM_CELLS;
+	// the move from the table, then safe edges, then sacrifices
+	for (pass = 0; pass < 3 && best < beta; pass++)
+	for (e = (pass == 0 ? best_move : 0); e >= 0 && e < board_wid * board_heit; e++)
+	{
+		int c;
+		if (pass == 0 && e != best_move)
+			break;
+		if (dnb_board[e] != DNB_EMPTY || !DNB_ISEDGE (e % board_wid, e / board_wid))
+			continue;
+		if (pass > 0 && e == best_move)
+			continue;
+		if (pass == 1 && !dnb_edge_is_safe (e))
+			continue;
+		if (pass == 2 && dnb_edge_is_safe (e))
+			continue;
+		count++;
+		c = dnb_draw (e);
+		val = c > 0 ? c + dnb_negamax (depth - 1, alpha - c, beta - c) 
+			: -dnb_negamax (depth - 1, -beta, -alpha);
+		dnb_undraw (e);
+		if (dnb_stop)
+			return 0;
+		if (val > best)
+		{
+			best = val;
+			best_move = e;
+		}
+		if (best > alpha)
+			alpha = best;
+		if (best >= beta)
+			break;
+		if (pass == 0)
+			break;
+	}
+	if (count == 0)
+		return 0;
+	
+	entry->key = dnb_key;
+	entry->val = best;
+	entry->move = best_move;
+	entry->depth = depth;
+	entry->flag = best <= alpha0 ? DNB_TT_UPPER 
+		: (best >= beta ? DNB_TT_LOWER : DNB_TT_EXACT);
+	return best;
+}
+
+//! Picks the next edge of the turn by iterative deepening
+static int dnb_search_edge (int num_free)
+{
+	int moves [DNB_NUM_CELLS], num_moves = 0;
+	int depth, max_depth, i, e, take, decline;
+
+	take = dnb_find_capture (&decline);
+	if (take >= 0 && decline < 0)
+		return take;
+	if (take >= 0)
+	{
+		moves[num_moves++] = take;
+		moves[num_moves++] = decline;
+	}
+	else
+	{
+		for (e=0; e<board_wid * board_heit; e++)
+			if (dnb_board[e] == DNB_EMPTY && DNB_ISEDGE (e % board_wid, e / board_wid))
+				moves[num_moves++] = e;
+	}
+	assert (num_moves > 0);
+	max_depth = ab_max_depth > 0 ? ab_max_depth 
+		: (time_per_move > 0 ? num_free : DNB_DEFAULT_DEPTH);
+	for (depth = 1; depth <= max_depth; depth++)
+	{
+		int best = -DNB_NUM_CELLS - 1, best_idx = 0;
+		// the best move so far is always moves[0]
+		for (i=0; i<num_moves; i++)
+		{
+			int c, val;
+			c = dnb_draw (moves[i]);
+			val = c > 0 ? c + dnb_negamax (depth - 1, best - c, DNB_NUM_CELLS) 
+				: -dnb_negamax (depth - 1, -DNB_NUM_CELLS, -best);
+			dnb_undraw (moves[i]);
+			if (dnb_stop)
+				break;
+			if (val > best)
+			{
+				best = val;
+				best_idx = i;
+			}
+		}
+		if (dnb_stop)
+			break;
+		e = moves[best_idx];
+		moves[best_idx] = moves[0];
+		moves[0] = e;
+		if (depth >= num_free || (time_per_move > 0 
+					&& g_timer_elapsed (dnb_timer, NULL) * 1000 > time_per_move / 2))
+			break;
+	}
+	return moves[0];
+}
+
+void dnb_search (Pos *pos, byte **movp)
+{
+	static byte move[2048];
+	byte *mp = move;
+	int x, y, e, num_free = 0;
+	byte box = (pos->player == WHITE ? DNB_RED : DNB_BLUE);
+
+	if (!dnb_timer)
+	{
+		guint64 z = G_GUINT64_CONSTANT(0x9e3779b97f4a7c15);
+		for (e=0; e<DNB_NUM_CELLS; e++)
+		{
+			z ^= z << 13; z ^= z >> 7; z ^= z << 17;
+			dnb_zobrist[e] = z;
+		}
+		dnb_timer = g_timer_new ();
+	}
+	g_timer_start (dnb_timer);
+	dnb_stop = FALSE;
+	dnb_nodes = 0;
+	memset (dnb_tt, 0, sizeof (dnb_tt));
+
+	memcpy (dnb_board, pos->board, board_wid * board_heit);
+	memset (dnb_walls, 0, sizeof (dnb_walls));
+	dnb_key = 0;
+	for (x=0; x<board_wid; x++)
+	for (y=0; y<board_heit; y++)
+	{
+		int boxes[2], n, i;
+		e = y * board_wid + x;
+		if (!DNB_ISEDGE (x, y))
+			continue;
+		if (dnb_board[e] == DNB_EMPTY)
+		{
+			num_free++;
+			continue;
+		}
+		dnb_key ^= dnb_zobrist[e];
+		n = dnb_edge_boxes (e, boxes);
+		for (i=0; i<n; i++)
+			dnb_walls[boxes[i]]++;
+	}
+	if (num_free == 0)
+	{
+		*movp = NULL;
 		return;
 	}
+
+	while (num_free > 0)
+	{
+		int boxes[2], n, i, c;
+		e = dnb_search_edge (num_free);
+		dnb_stop = FALSE;
+		c = dnb_draw (e);
+		num_free--;
+		*mp++ = e % board_wid;
+		*mp++ = e / board_wid;
+		*mp++ = dnb_board[e];
+		n = dnb_edge_boxes (e, boxes);
+		for (i=0; i<n; i++)
+			if (dnb_walls[boxes[i]] == 4)
+			{
+				dnb_board[boxes[i]] = box;
+				*mp++ = boxes[i] % board_wid;
+				*mp++ = boxes[i] / board_wid;
+				*mp++ = box;
+			}
+		if (c == 0)
+			break;
+	}
+	*mp++ = -1;
+	*movp = move;
 }
 
 // Local Variables:
@@ -25,6 +25,10 @@
 #include "move.h"
 #include "stack.h"
 #include "engine.h"
+#include "perft.h"
+#include "stats.h"
+#include "tb.h"
+#include "book.h"
 
 #include <signal.h>
 #include <string.h>
@@ -42,49 +46,153 @@ extern gboolean engine_flag;
 extern Pos cur_pos;
 
 extern Game *opt_game, *games[];
-extern int num_games;
+extern const int num_games;
 byte * engine_search (Pos *);
+byte * engine_search_timed (Pos *, int);
 static FILE *engine_fin, *engine_fout;
 
 //! Eval fn for white (can be NULL, in which case game_eval will be used for both)
-extern ResultType (*game_eval_white) (Pos *, Player, float *);
+extern float (*game_eval_white) (Pos *, int);
 //! Eval fn for black (can be NULL, in which case game_eval will be used for both)
-extern ResultType (*game_eval_black) (Pos *, Player, float *);
+extern float (*game_eval_black) (Pos *, int);
 
-// FIXME: following 3 extern decls must be removed by refactoring (i.e, move all fns common to client and server to a new file)
 extern void reset_game_params ();
-extern void set_game_params ();
 extern void game_set_init_pos_def (Pos *);
 
+extern gboolean game_use_hash;
+extern byte * hash_get_move (byte *, int, int);
+
 //! Alpha-beta search function (using depth first iterative deepening).
 extern byte *ab_dfid (Pos *, int);
 
+//! Alpha-beta search to a fixed depth
+extern float ab_fixed_depth (Pos *, int, byte *);
+
+extern int ab_max_depth, ab_max_nodes;
+extern void (*ab_iter_cb) (Pos *, int, float, byte *, int);
+
 //! The input pipe is accessed through a GIOChannel so that we can register a callback for events
 static GIOChannel *channel_in = NULL;
 
 //! If an event occurs when we are thinking this will be set to TRUE so that we will know to stop thinking
 gboolean engine_stop_search = FALSE;
 
+//! TRUE while we are searching
+/** Commands that arrive during a search are queued and executed in order after
+  the search returns, except for the ones that interrupt the search. This lets
+  clients pipeline commands (eg. many SET_POSITION/GET_EVAL pairs) without
+  them being executed in the middle of a search.*/
+static gboolean engine_searching = FALSE;
+
+//! Set when the client has closed the pipe. We exit once the queued commands are done.
+static gboolean engine_eof = FALSE;
+
 //! Indicates whether we have to stop and return the move or stop and cancel the move
 static gboolean cancel_move = FALSE;
 
 //! Max time per move. alpha-beta will often return earlier than this.
 int time_per_move = 5000;
 
+//! If not NULL the statistics of each search are appended to this file
+static FILE *engine_stats_file = NULL;
+
+//! The side for which the current search is being done. engine_eval() picks the heuristic based on this.
+static Player search_player = WHITE;
+
+static void engine_finish ();
+
 gboolean engine_hup_cb ()
 {
 	if (opt_verbose)
-		fprintf (stderr, "engine: Connection broken. Exiting.\n");
-	// FIXME: do we want to free anything here?
-	exit (1);
+		fprintf (stderr, "engine: Connection closed. Exiting.\n");
+	engine_eof = TRUE;
+	// the client may have closed the pipe right after sending its last commands, so we run those first
+	if (!engine_searching)
+		engine_finish ();
+	return FALSE;
+}
+
+ResultType engine_eval (Pos *pos, Player player, float *eval)
+{
+	*eval = search_player == WHITE ? game_eval_white (pos, player) :
+		game_eval_black (pos, player);
+	return RESULT_NOTYET;
+}
+
+static int hexval (char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+//! Decodes len bytes of hex from str into buf. Returns the char after the last digit or NULL on error.
+static char *hex_read (char *str, byte *buf, int len)
+{
+	int i, hi, lo;
+	for (i=0; i<len; i++)
+	{
+		if ((hi = hexval (str[2*i])) < 0 || (lo = hexval (str[2*i+1])) < 0)
+			return NULL;
+		buf[i] = (byte) (hi << 4 | lo);
+	}
+	return str + 2 * len;
 }
 
-ResultType engine_eval (Pos *pos, /*Player player,*/ float *eval)
+static void hex_write (byte *buf, int len, FILE *fout)
 {
-	ResultType result;
-	result = pos->player == WHITE ? game_eval_white(pos, pos->player, eval) :
-	game_eval_black (pos, pos->player, eval);
-	return result;
+	static const char digits[] = "0123456789abcdef";
+	int i;
+	for (i=0; i<len; i++)
+	{
+		guchar c = (guchar) buf[i];
+		putc (digits[c >> 4], fout);
+		putc (digits[c & 0xf], fout);
+	}
+}
+
+gboolean engine_pos_read (char *line, Pos *pos)
+{
+	char *tail;
+	Player player;
+	int num_moves;
+	
+	while (*line == ' ' || *line == '\t') line++;
+	switch (*line)
+	{
+		case 'w': case 'W': player = WHITE; break;
+		case 'b': case 'B': player = BLACK; break;
+		default: return FALSE;
+	}
+	line = strpbrk (line, " \t");
+	if (!line) return FALSE;
+	num_moves = strtol (line, &tail, 10);
+	if (tail == line || num_moves < 0) return FALSE;
+	line = tail;
+	while (*line == ' ' || *line == '\t') line++;
+	line = hex_read (line, pos->board, board_wid * board_heit);
+	if (!line) return FALSE;
+	while (*line == ' ' || *line == '\t') line++;
+	if (*line == '\0' || *line == '\n' || !game_stateful)
+		pos->state = NULL;
+	else if (!pos->state || !hex_read (line, pos->state, game_state_size))
+		return FALSE;
+	pos->player = player;
+	pos->num_moves = num_moves;
+	return TRUE;
+}
+
+void engine_pos_write (Pos *pos, FILE *fout)
+{
+	fprintf (fout, "%c %d ", pos->player == WHITE ? 'w' : 'b', pos->num_moves);
+	hex_write (pos->board, board_wid * board_heit, fout);
+	if (game_stateful && pos->state)
+	{
+		putc (' ', fout);
+		hex_write (pos->state, game_state_size, fout);
+	}
+	putc ('\n', fout);
 }
 
 void engine_set_to_play (char *line)
@@ -95,10 +203,9 @@ void engine_set_to_play (char *line)
 		cur_pos.player = BLACK;
 }
 
-void engine_take_move (char *line)
+//! Makes the move in cur_pos and pushes it on the stack
+void engine_apply_move (byte *move)
 {
-	byte *move = move_read (line);
-	movstack_trunc ();
 	movstack_push (cur_pos.board, move);
 	if (game_stateful)
 	{
@@ -111,12 +218,21 @@ void engine_take_move (char *line)
 	cur_pos.player = cur_pos.player == WHITE ? BLACK : WHITE;
 }
 
+void engine_take_move (char *line)
+{
+	byte *move = move_read (line);
+	movstack_trunc ();
+	engine_apply_move (move);
+}
+
 void engine_make_move ()
 {
 	byte *move;
 	movstack_trunc ();
 	cancel_move = FALSE;
-	move = engine_search (&cur_pos);
+	move = book_probe (&cur_pos);
+	if (!move)
+		move = engine_search (&cur_pos);
 	if (cancel_move)
 		return;
 	if (!move)
@@ -124,63 +240,67 @@ void engine_make_move ()
 		move_fwrite_nak ("Nice try", engine_fout);
 		return;
 	}
-	movstack_push (cur_pos.board, move);
-	if (game_stateful)
-	{
-		void *newstate = game_newstate (&cur_pos, move);
-		statestack_push (newstate);
-		cur_pos.state = statestack_peek ();
-	}
-	move_apply (cur_pos.board, move);
-	cur_pos.num_moves++;
+	engine_apply_move (move);
 	move_fwrite_ack (move, engine_fout);
-	cur_pos.player = cur_pos.player == WHITE ? BLACK : WHITE;
+}
+
+//! Finds a game, or a level of the current game, by name. Returns NULL if there is no such game.
+Game *engine_find_game (char *gamename)
+{
+	int i;
+	GameLevel *level;
+	for (i=0; i<num_games; i++)
+		if (!strcmp (games[i]->name, gamename))
+			return games[i];
+	// FIXME: isn't there a more elegant way to do this?
+	for (level = game_levels; level && level->name; level++)
+		if (!strcmp (level->game->name, gamename))
+			return level->game;
+	return NULL;
+}
+
+//! The last line accepted by engine_std_position(), to go back to if a later one is rejected
+static char *engine_last_position = NULL;
+
+void engine_set_game (Game *game)
+{
+	reset_game_params ();
+	g_free (engine_last_position);
+	engine_last_position = NULL;
+	opt_game = game;
+	if (opt_game->game_init)
+		opt_game->game_init(opt_game);
+	board_wid = game->board_wid;
+	board_heit = game->board_heit;
+	cur_pos.game = game;
+	// reset_game_params() has freed the board of the previous game
+	cur_pos.board = (byte *) malloc (board_wid * board_heit);
+	assert (cur_pos.board);
+	game_set_init_pos (&cur_pos);
+	stack_free ();
+	tb_init ();
+	book_init ();
 }
 
 void engine_new_game (char *gamename)
 {
-	int i, len;
-	Game *old_game = opt_game;
-	opt_game = NULL;
+	int len;
+	Game *game;
 	// strip trailing newline
 	if (gamename[len = strlen(gamename) - 1] == '\n')
 		gamename[len] = 0;
-	for (i=0; i<num_games; i++)
-		if (!strcmp (games[i]->name, gamename))
-		{
-			opt_game = games[i];
-			break;
-		}
-	if (!opt_game)
-	{
-		// FIXME: isn't there a more elegant way to do this?
-		GameLevel *level = game_levels;
-		assert (level);
-		while (level->name)
-		{
-			if (!strcmp (level->game->name, gamename))
-			{
-				opt_game = level->game;
-				break;
-			}
-			level++;
-		}
-	}
-	if (!opt_game)
+	game = engine_find_game (gamename);
+	if (!game)
 	{
 		fprintf (stderr, "engine: unknown game: %s\n", gamename);
 		exit(1);
 	}
-	reset_game_params ();
-	if (opt_game->game_init)
-		opt_game->game_init(opt_game);
-	set_game_params ();
+	engine_set_game (game);
 	if (game_set_init_pos != game_set_init_pos_def) 
 	{
 		fwrite (cur_pos.board, board_wid * board_heit, 1, engine_fout);
 		fflush (engine_fout);
 	}
-	stack_free ();
 }
 
 void engine_reset_game ()
@@ -225,6 +345,120 @@ void engine_forw_move ()
 	move_fwrite_ack (move, engine_fout);
 }
 
+//! Sets cur_pos from a line in the format of engine_pos_read(). Returns FALSE, leaving cur_pos alone, if the line is malformed
+gboolean engine_set_position (char *line)
+{
+	static byte *board = NULL;
+	static void *state = NULL;
+	static int board_size = 0, state_size = 0;
+	Pos pos;
+	if (!line) return FALSE;
+	if (board_size != board_wid * board_heit)
+	{
+		board = realloc (board, board_size = board_wid * board_heit);
+		assert (board);
+	}
+	if (game_stateful && state_size != game_state_size)
+	{
+		state = realloc (state, state_size = game_state_size);
+		assert (state);
+	}
+	pos.board = board;
+	pos.state = game_stateful ? state : NULL;
+	if (!engine_pos_read (line, &pos))
+	{
+		fprintf (stderr, "engine: malformed position: %s\n", line);
+		return FALSE;
+	}
+	stack_free ();
+	memcpy (cur_pos.board, pos.board, board_wid * board_heit);
+	cur_pos.state = NULL;
+	if (pos.state)
+	{
+		statestack_push (pos.state);
+		cur_pos.state = statestack_peek ();
+	}
+	cur_pos.player = pos.player;
+	cur_pos.num_moves = pos.num_moves;
+	return TRUE;
+}
+
+static void engine_set_position_cmd (char *line)
+{
+	engine_set_position (line);
+}
+
+void engine_get_eval (char *line)
+{
+	int depth = line ? atoi (line) : 0;
+	float eval;
+	if (!game_eval)
+	{
+		move_fwrite_nak (NULL, engine_fout);
+		return;
+	}
+	search_player = cur_pos.player;
+	if (depth > 0 && game_movegen)
+	{
+		engine_searching = TRUE;
+		eval = ab_fixed_depth (&cur_pos, depth, NULL);
+		engine_searching = FALSE;
+	}
+	else
+		game_eval (&cur_pos, cur_pos.player, &eval);
+	fprintf (engine_fout, "ACK %f\n", eval);
+	fflush (engine_fout);
+}
+
+void engine_set_heur (char *line)
+{
+	char *wheur, *bheur;
+	float (*eval_white) (Pos *, int) = NULL, (*eval_black) (Pos *, int) = NULL;
+	int i;
+	if (!line) return;
+	if (!game_htab)
+	{
+		fprintf (stderr, "engine: no support for changing eval fn. in %s\n",
+				opt_game ? opt_game->name : "this game");
+		return;
+	}
+	wheur = strtok (line, " \t\n");
+	bheur = strtok (NULL, " \t\n");
+	if (!wheur) return;
+	if (!bheur) bheur = wheur;
+	for (i=0; game_htab[i].name; i++)
+	{
+		if (!strcasecmp (wheur, game_htab[i].name))
+			eval_white = game_htab[i].eval_fun;
+		if (!strcasecmp (bheur, game_htab[i].name))
+			eval_black = game_htab[i].eval_fun;
+	}
+	if (!eval_white || !eval_black)
+	{
+		fprintf (stderr, "engine: no such eval fn: %s\n", 
+				eval_white ? bheur : wheur);
+		return;
+	}
+	game_eval_white = eval_white;
+	game_eval_black = eval_black;
+	game_eval = engine_eval;
+}
+
+void engine_suggest_move (char *line)
+{
+	byte *move;
+	cancel_move = FALSE;
+	move = engine_search (&cur_pos);
+	if (cancel_move)
+		return;
+	if (!move)
+	{
+		move_fwrite_nak (NULL, engine_fout);
+		return;
+	}
+	move_fwrite_ack (move, engine_fout);
+}
+
 void engine_msec_per_move (char *line)
 {
 	if (!line) return;
@@ -270,9 +504,13 @@ void engine_move_now (char *line)
 	engine_stop_search = TRUE;
 }
 
+//! The source id of the timeout for the current search (0 if it has expired)
+static guint search_timeout_tag = 0;
+
 int engine_timeout_cb ()
 {
 	engine_stop_search = TRUE;
+	search_timeout_tag = 0;
 	return FALSE;
 }
 
@@ -282,12 +520,326 @@ void engine_cancel_move (char *line)
 	cancel_move = TRUE;
 }
 
+/* The commands below make up the front-end protocol spoken by
+   gtkboard-engine. It is modeled on UCI; see doc/devel/index.html */
+
+//! Appends a move to str as a single token: the movelets separated by commas, or "pass"
+void engine_move_token (byte *move, GString *str)
+{
+	int i;
+	if (move[0] == -1)
+	{
+		g_string_append (str, "pass");
+		return;
+	}
+	for (i=0; move[3*i] != -1; i++)
+		g_string_append_printf (str, "%s%d,%d,%d", i ? "," : "", 
+				move[3*i] + 1, move[3*i+1] + 1, move[3*i+2]);
+}
+
+void engine_write_move_token (byte *move, FILE *fout)
+{
+	GString *str = g_string_new ("");
+	engine_move_token (move, str);
+	fputs (str->str, fout);
+	g_string_free (str, TRUE);
+}
+
+//! Parses a token written by engine_write_move_token(). Returns NULL if the token is malformed.
+byte *engine_read_move_token (char *token)
+{
+	char buf[1024], *c;
+	if (!strcmp (token, "pass"))
+		return move_read ("");
+	strncpy (buf, token, sizeof (buf) - 1);
+	buf[sizeof (buf) - 1] = '\0';
+	for (c = buf; *c; c++)
+		if (*c == ',')
+			*c = ' ';
+	return move_read_checked (buf);
+}
+
+//! Appends the principal variation to pv by following the moves stored in the hash table
+void engine_get_pv (Pos *pos, byte *best_move, int depth, GString *pv)
+{
+	Pos pvpos = *pos;
+	void *statebuf = NULL;
+	byte *move = best_move;
+	int i;
+	pvpos.board = (byte *) malloc (board_wid * board_heit);
+	assert (pvpos.board);
+	memcpy (pvpos.board, pos->board, board_wid * board_heit);
+	if (game_stateful)
+	{
+		statebuf = malloc (game_state_size);
+		assert (statebuf);
+	}
+	for (i=0; i<depth && move; i++)
+	{
+		byte *movlist = game_movegen (&pvpos);
+		gboolean legal = movlist_contains (movlist, move);
+		free (movlist);
+		if (!legal)
+			break;
+		g_string_append_c (pv, ' ');
+		engine_move_token (move, pv);
+		if (game_stateful)
+		{
+			memcpy (statebuf, game_newstate (&pvpos, move), game_state_size);
+			pvpos.state = statebuf;
+		}
+		move_apply (pvpos.board, move);
+		pvpos.num_moves++;
+		pvpos.player = pvpos.player == WHITE ? BLACK : WHITE;
+		if (!game_use_hash)
+			break;
+		move = hash_get_move (pvpos.board, board_wid * board_heit, pvpos.num_moves);
+	}
+	free (pvpos.board);
+	free (statebuf);
+}
+
+//! Timer for the current "go", used for the info lines
+static GTimer *go_timer = NULL;
+
+static void engine_info_cb (Pos *pos, int depth, float val, byte *best_move, int nodes)
+{
+	gulong micro_sec;
+	GString *pv;
+	double secs = g_timer_elapsed (go_timer, &micro_sec);
+	if (search_player == BLACK)
+		val = -val;
+	fprintf (engine_fout, "info depth %d score ", depth);
+	if (val >= GAME_EVAL_INFTY)
+		fprintf (engine_fout, "win");
+	else if (val <= -GAME_EVAL_INFTY)
+		fprintf (engine_fout, "loss");
+	else
+		fprintf (engine_fout, "%g", val);
+	fprintf (engine_fout, " nodes %d nps %d time %d pv", nodes, 
+			secs > 0 ? (int) (nodes / secs) : 0, (int) (secs * 1000));
+	pv = g_string_new ("");
+	engine_get_pv (pos, best_move, depth, pv);
+	fprintf (engine_fout, "%s\n", pv->str);
+	g_string_free (pv, TRUE);
+	fflush (engine_fout);
+}
+
+gboolean engine_set_stats_file (char *filename)
+{
+	if (engine_stats_file)
+		fclose (engine_stats_file);
+	engine_stats_file = NULL;
+	if (!filename || !filename[0])
+		return TRUE;
+	engine_stats_file = fopen (filename, "a");
+	return engine_stats_file != NULL;
+}
+
+void engine_std_hello (char *line)
+{
+	int i;
+	fprintf (engine_fout, "id name gtkboard-engine %s\n", GTKBOARD_VERSION);
+	if (opt_game)
+		fprintf (engine_fout, "id game %s\n", opt_game->name);
+	fprintf (engine_fout, "option name msec_per_move type spin default %d min 0\n", 
+			time_per_move);
+	fprintf (engine_fout, "option name hash type check default %s\n", 
+			game_use_hash ? "true" : "false");
+	fprintf (engine_fout, "option name stats_file type string default <empty>\n");
+	if (game_solve)
+		fprintf (engine_fout, "option name solve_moves type spin default %d min 0\n",
+				game_solve_moves);
+	fprintf (engine_fout, "option name book type check default %s\n", 
+			book_enabled ? "true" : "false");
+	if (game_htab)
+	{
+		fprintf (engine_fout, "option name heuristic type combo default %s", 
+				game_htab[0].name);
+		for (i=0; game_htab[i].name; i++)
+			fprintf (engine_fout, " var %s", game_htab[i].name);
+		fprintf (engine_fout, "\n");
+	}
+	for (i=0; i<num_games; i++)
+		fprintf (engine_fout, "game %s\n", games[i]->name);
+	fprintf (engine_fout, "gtkboardok\n");
+	fflush (engine_fout);
+}
+
+void engine_std_isready (char *line)
+{
+	fprintf (engine_fout, "readyok\n");
+	fflush (engine_fout);
+}
+
+void engine_std_setoption (char *line)
+{
+	char *name, *value;
+	if (!line || strncmp (line, "name ", 5)) return;
+	name = line + 5;
+	value = strstr (name, " value ");
+	if (!value) return;
+	*value = '\0';
+	value += 7;
+	if (!strcmp (name, "msec_per_move"))
+		engine_msec_per_move (value);
+	else if (!strcmp (name, "hash"))
+		game_use_hash = !strcmp (value, "true");
+	else if (!strcmp (name, "heuristic"))
+		engine_set_heur (value);
+	else if (!strcmp (name, "solve_moves"))
+		game_solve_moves = atoi (value);
+	else if (!strcmp (name, "book"))
+		book_enabled = !strcmp (value, "true");
+	else if (!strcmp (name, "stats_file"))
+	{
+		if (!engine_set_stats_file (strcmp (value, "<empty>") ? value : NULL))
+		{
+			fprintf (engine_fout, "info string can't open %s\n", value);
+			fflush (engine_fout);
+		}
+	}
+	else
+	{
+		fprintf (engine_fout, "info string unknown option %s\n", name);
+		fflush (engine_fout);
+	}
+}
+
+void engine_std_newgame (char *line)
+{
+	Game *game;
+	if (!line) return;
+	game = engine_find_game (line);
+	if (!game)
+	{
+		fprintf (engine_fout, "info string unknown game %s\n", line);
+		fflush (engine_fout);
+		return;
+	}
+	engine_set_game (game);
+}
+
+void engine_std_position (char *line)
+{
+	char *moves, *token, *copy;
+	if (!line || !opt_game) return;
+	copy = g_strdup (line);
+	moves = strstr (line, "moves");
+	if (moves && moves > line)
+		moves[-1] = '\0';
+	if (!strncmp (line, "startpos", 8))
+		engine_reset_game ();
+	else if (strncmp (line, "pos ", 4) || !engine_set_position (line + 4))
+	{
+		// cur_pos and engine_last_position are as they were
+		fprintf (engine_fout, "info string bad position\n");
+		fflush (engine_fout);
+		g_free (copy);
+		return;
+	}
+	for (token = moves ? strtok (moves + 5, " \t") : NULL; token; 
+			token = strtok (NULL, " \t"))
+	{
+		byte *move = engine_read_move_token (token), *movlist;
+		gboolean legal = move != NULL;
+		if (move && game_movegen)
+		{
+			movlist = game_movegen (&cur_pos);
+			legal = movlist_contains (movlist, move);
+			free (movlist);
+		}
+		if (!legal)
+		{
+			fprintf (engine_fout, "info string illegal move %s, position not changed\n", token);
+			fflush (engine_fout);
+			g_free (copy);
+			// the tokens before this one have been applied already
+			if (engine_last_position)
+			{
+				copy = g_strdup (engine_last_position);
+				engine_std_position (copy);
+				g_free (copy);
+			}
+			else
+				engine_reset_game ();
+			return;
+		}
+		movstack_trunc ();
+		engine_apply_move (move);
+	}
+	g_free (engine_last_position);
+	engine_last_position = copy;
+}
+
+void engine_std_go (char *line)
+{
+	char *token, *arg;
+	int depth = 0, movetime = 0, nodes = 0;
+	gboolean infinite = FALSE;
+	int old_time_per_move = time_per_move;
+	byte *move;
+	if (!opt_game) return;
+	for (token = line ? strtok (line, " \t") : NULL; token; 
+			token = strtok (NULL, " \t"))
+	{
+		if (!strcmp (token, "infinite"))
+		{
+			infinite = TRUE;
+			continue;
+		}
+		if (!(arg = strtok (NULL, " \t")))
+			break;
+		if (!strcmp (token, "depth"))
+			depth = atoi (arg);
+		else if (!strcmp (token, "movetime"))
+			movetime = atoi (arg);
+		else if (!strcmp (token, "nodes"))
+			nodes = atoi (arg);
+	}
+	if (movetime > 0)
+		time_per_move = movetime;
+	else if (infinite || depth > 0 || nodes > 0)
+		time_per_move = 0;
+	ab_max_depth = depth;
+	ab_max_nodes = nodes;
+	ab_iter_cb = engine_info_cb;
+	if (!go_timer) go_timer = g_timer_new ();
+	g_timer_start (go_timer);
+	cancel_move = FALSE;
+	move = engine_search_timed (&cur_pos, time_per_move);
+	ab_iter_cb = NULL;
+	ab_max_depth = ab_max_nodes = 0;
+	time_per_move = old_time_per_move;
+	stats_write_info (&ab_stats, engine_fout);
+	fprintf (engine_fout, "bestmove ");
+	if (move)
+		engine_write_move_token (move, engine_fout);
+	else
+		fprintf (engine_fout, "(none)");
+	fprintf (engine_fout, "\n");
+	fflush (engine_fout);
+}
+
+void engine_std_perft (char *line)
+{
+	int depth;
+	if (!line || !opt_game) return;
+	depth = atoi (line);
+	perft_run (depth, strstr (line, "divide") != NULL, engine_fout);
+}
+
+void engine_std_quit (char *line)
+{
+	exit (0);
+}
+
 
 //! This structure defines the protocol
 Command commands[] = 
 {
 	{ "MSEC_PER_MOVE"  , 1 , engine_msec_per_move},
-	{ "SUGGEST_MOVE"    , 0 , NULL},
+	{ "SUGGEST_MOVE"    , 1 , engine_suggest_move},
 	{ "TAKE_MOVE"       , 1 , engine_take_move},
 	{ "BACK_MOVE"       , 1 , engine_back_move},
 	{ "FORW_MOVE"       , 1 , engine_forw_move},
@@ -297,12 +849,22 @@ Command commands[] =
 	{ "END_GAME"        , 0 , NULL},
 	{ "RESET_GAME"      , 1 , engine_reset_game},
 	{ "TO_PLAY"         , 1 , engine_set_to_play},
-	{ "SET_POSITION"    , 0 , NULL},
+	{ "SET_POSITION"    , 1 , engine_set_position_cmd},
 	{ "NEW_GAME"        , 1 , engine_new_game},
-	{ "GET_EVAL"        , 0 , NULL},
-	{ "SET_HEUR"        , 0 , NULL},
+	{ "GET_EVAL"        , 1 , engine_get_eval},
+	{ "SET_HEUR"        , 1 , engine_set_heur},
 	{ "SET_STRATEGY"    , 0 , NULL},
 	{ "WHO_WON"			, 1 , engine_who_won},
+
+	{ "gtkboard"        , 1 , engine_std_hello},
+	{ "isready"         , 1 , engine_std_isready},
+	{ "setoption"       , 1 , engine_std_setoption},
+	{ "newgame"         , 1 , engine_std_newgame},
+	{ "position"        , 1 , engine_std_position},
+	{ "go"              , 1 , engine_std_go},
+	{ "stop"            , 1 , engine_move_now},
+	{ "perft"           , 1 , engine_std_perft},
+	{ "quit"            , 1 , engine_std_quit},
 };
 
 #define NUM_COMMANDS (sizeof (commands) / sizeof (commands[0]))
@@ -332,6 +894,13 @@ static void execute_command (char *line)
 
 
 static GSList *command_list = NULL;
+
+static gboolean is_interrupt (char *line)
+{
+	return !strncmp (line, "MOVE_NOW", 8) || !strncmp (line, "CANCEL_MOVE", 11)
+		|| !strcmp (line, "stop") || !strcmp (line, "quit");
+}
+
 static gboolean process_line ()
 {
 	char *line;
@@ -343,31 +912,78 @@ static gboolean process_line ()
 	return TRUE;
 }
 
+//! Executes the first queued command that interrupts the search, if any
+static gboolean process_interrupt ()
+{
+	GSList *l;
+	for (l = command_list; l; l = l->next)
+	{
+		char *line = (char *) l->data;
+		if (!is_interrupt (line))
+			continue;
+		command_list = g_slist_remove (command_list, line);
+		execute_command (line);
+		g_free (line);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+//! Reads whatever is available on the pipe and queues the complete lines. Returns the number of bytes read.
+static gsize channel_read_commands ()
+{
+	// a command may be split across several reads, so we keep the incomplete tail around
+	static GString *pending = NULL;
+	char buf[4096+1];
+	char *linep, *eol;
+	gsize bytes_read = 0;
+	if (!pending)
+		pending = g_string_new ("");
+	g_io_channel_read (channel_in, buf, sizeof (buf) - 1, &bytes_read);
+	buf[bytes_read] = '\0';
+	g_string_append (pending, buf);
+	linep = pending->str;
+	while ((eol = strchr (linep, '\n')) != NULL)
+	{
+		*eol = '\0';
+		if (opt_verbose) printf ("engine got command \"%s\"\n", linep);
+		command_list = g_slist_append (command_list, g_strdup (linep));
+		linep = eol + 1;
+	}	
+	g_string_erase (pending, 0, linep - pending->str);
+	return bytes_read;
+}
+
+//! Runs the commands that are still in the pipe and exits
+static void engine_finish ()
+{
+	while (channel_read_commands () > 0)
+		;
+	while (process_line ())
+		;
+	exit (0);
+}
+
 static gboolean channel_process_input ()
 {
-	static char linebuf[4096+1];
-	char *linep = linebuf;
-	char *line;
-	gsize bytes_read;
+	if (channel_read_commands () == 0)
+	{
+		engine_eof = TRUE;
+		if (!engine_searching)
+			engine_finish ();
+		return FALSE;
+	}
 #if GLIB_MAJOR_VERSION > 1
 	// we need to call this again because we will get new events before returning
 	// from this function
 	// semantics of add_watch silently changing between glib versions!!!!
 	g_io_add_watch (channel_in, G_IO_IN, (GIOFunc) channel_process_input, NULL);
 #endif
-	g_io_channel_read (channel_in, linebuf, 4096, &bytes_read);
-	linebuf[bytes_read] = '\0';
-	while (*linep != '\0')
-	{
-		line = linep;
-		while (*linep++ != '\n')
-			g_assert (linep[-1] != '\0');
-		linep[-1] = '\0';
-		if (opt_verbose) printf ("engine got command \"%s\"\n", line);
-		command_list = g_slist_append (command_list, g_strdup (line));
-	}	
-	while (process_line ())
-		;
+	if (!engine_searching)
+		while (process_line ())
+			;
+	if (engine_eof && !engine_searching)
+		engine_finish ();
 #if GLIB_MAJOR_VERSION == 1
 	return TRUE;
 #else
@@ -384,9 +1000,8 @@ void engine_poll ()
 		// listen for input in the pipe
 		while (g_main_iteration (FALSE))
 			;
-		// execute pending commands
-		// we execute only ONE command so that if there is a CANCEL_MOVE followed by a MAKE_MOVE we won't start on the new move before finishing this one
-		process_line ();
+		// we execute only the commands that affect the search. The others will be run after the search returns. Even among those we execute only ONE so that if there is a CANCEL_MOVE followed by a MAKE_MOVE we won't start on the new move before finishing this one
+		process_interrupt ();
 	}
 }
 
@@ -415,24 +1030,38 @@ void engine_main (int infd, int outfd)
 	g_main_run (loop);
 }
 
-byte * engine_search (Pos *pos/*, int player*/)
+//! Searches for a move in pos, giving up after msec milliseconds (or never if msec is not positive)
+byte * engine_search_timed (Pos *pos, int msec)
 {
-	int tag;
 	byte *move;
 	engine_stop_search = FALSE;
+	engine_searching = TRUE;
+	search_player = pos->player;
+	memset (&ab_stats, 0, sizeof (ab_stats));
 	if (game_search)
 		game_search (pos, &move);
 	else if (game_single_player)
 		move = NULL;
 	else
 	{
-		tag = g_timeout_add (2 * time_per_move, engine_timeout_cb, NULL);
+		if (msec > 0)
+			search_timeout_tag = g_timeout_add (msec, engine_timeout_cb, NULL);
 		move = ab_dfid (pos, pos->player);
-		g_source_remove (tag);
+		if (search_timeout_tag)
+			g_source_remove (search_timeout_tag);
+		search_timeout_tag = 0;
+		if (engine_stats_file)
+			stats_write_json (&ab_stats, pos, engine_stats_file);
 	}
+	engine_searching = FALSE;
 	return move;
 }
 
+byte * engine_search (Pos *pos/*, int player*/)
+{
+	return engine_search_timed (pos, 2 * time_per_move);
+}
+
 // Local Variables:
 // tab-width: 4
 // End:
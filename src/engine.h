@@ -34,7 +34,57 @@ typedef struct
 
 extern Command  commands[];
 
-ResultType engine_eval (Pos *, /*Player,*/ float *);
+ResultType engine_eval (Pos *, Player, float *);
+
+//! Parses a position of the form "<w|b> <num_moves> <board> [<state>]"
+/** This is the format used by the SET_POSITION command. The board is written 
+  in hex, two digits per square in the same order as Pos::board. The state,
+  which is optional, is #game_state_size bytes also in hex. pos->board must
+  point to a buffer of size board_wid * board_heit and for stateful games
+  pos->state must point to a buffer of size #game_state_size. If the state 
+  is missing pos->state is set to NULL, which means the initial state.
+  Returns FALSE if the line is malformed. */
+gboolean engine_pos_read (char *, Pos *);
+
+//! Writes the position in the format understood by engine_pos_read()
+void engine_pos_write (Pos *, FILE *);
+
+//! Makes game the current game, with the initial position
+void engine_set_game (Game *game);
+
+//! Finds a game, or a level of a game, by name. Returns NULL if there is no such game.
+Game *engine_find_game (char *gamename);
+
+//! Resets cur_pos to the initial position of the current game
+void engine_reset_game ();
+
+//! Makes the move in cur_pos and pushes it on the move stack
+void engine_apply_move (byte *move);
+
+//! Searches for a move in pos, giving up after msec milliseconds (or never if msec is not positive)
+/** Returns NULL if there is no move. The move is in a static buffer. */
+byte * engine_search_timed (Pos *pos, int msec);
+
+//! Appends the statistics of each following search to the file, as JSON lines
+/** NULL or "" stops writing them. Returns FALSE if the file can't be opened. */
+gboolean engine_set_stats_file (char *filename);
+
+//! Appends a move to str as a single word: the movelets joined by commas, or "pass"
+void engine_move_token (byte *move, GString *str);
+
+//! Writes a move as a single word, like engine_move_token()
+void engine_write_move_token (byte *move, FILE *fout);
+
+//! Parses a move written by engine_write_move_token()
+byte *engine_read_move_token (char *token);
+
+//! Appends the principal variation starting with best_move to pv, at most depth moves, each preceded by a space
+/** The rest of the variation is read from the hash table, so this
+  must be called before the search clears it, typically from #ab_iter_cb. */
+void engine_get_pv (Pos *pos, byte *best_move, int depth, GString *pv);
+
+//! The engine's main loop. Reads commands from infd and writes replies to outfd.
+void engine_main (int infd, int outfd);
 
 //! Functions that do the actual thinking must periodically call this function.
 /** It checks if new commands have arrived. */
@@ -0,0 +1,302 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "game.h"
+#include "engine.h"
+#include "analyze.h"
+#include "tourney.h"
+#include "bench.h"
+#include "perft.h"
+#include "book.h"
+#include "tb.h"
+
+/** \file engine_cli.c
+  \brief main() for gtkboard-engine, the engine without the user interface.
+
+  It reads commands on stdin and writes replies on stdout, so that it can be 
+  driven by scripts, tournament managers and GUIs other than gtkboard. See 
+  doc/devel/index.html for the protocol.
+  */
+
+extern Game *games[];
+extern const int num_games;
+extern Game *opt_game;
+extern int opt_verbose;
+extern int time_per_move;
+extern void reset_game_params ();
+
+//! Log file to analyze (--analyze)
+static FILE *opt_analyze = NULL;
+
+//! Fixed search depth for --analyze (0 means use the time per move)
+static int opt_depth = 0;
+
+//! Number of processes to use for --analyze and --tournament
+static int opt_jobs = 0;
+
+//! Number of games to play in --tournament
+static int opt_tourney = 0;
+
+//! Heuristics for --tournament
+static char *opt_wheur = NULL, *opt_bheur = NULL;
+
+//! Number of random moves at the start of each --tournament game
+static int opt_open_plies = 4;
+
+//! Run the benchmark (--bench)
+static gboolean opt_bench = FALSE;
+
+//! Depth for --perft
+static int opt_perft = 0;
+
+//! Break the last perft count down by move (--divide)
+static gboolean opt_divide = FALSE;
+
+//! Check the known perft counts (--perft-check)
+static gboolean opt_perft_check = FALSE;
+
+//! Log file to build the opening book from (--book)
+static FILE *opt_book = NULL;
+
+//! Build the endgame tablebase (--tablebase)
+static gboolean opt_tb = FALSE;
+
+static int get_seed ()
+{
+	GTimeVal timeval;
+	g_get_current_time (&timeval);
+	return timeval.tv_usec;
+}
+
+static void parse_opts (int argc, char **argv)
+{
+	int c, i;
+	int option_index = 0;
+	static struct option long_options[] = {
+	  {"game",1,0,'g'},
+	  {"delay",1,0,'d'},
+	  {"analyze",1,0,'a'},
+	  {"depth",1,0,'D'},
+	  {"jobs",1,0,'j'},
+	  {"tournament",1,0,'t'},
+	  {"w-heuristic",1,0,'w'},
+	  {"b-heuristic",1,0,'b'},
+	  {"opening",1,0,'o'},
+	  {"bench",0,0,'B'},
+	  {"perft",1,0,'P'},
+	  {"divide",0,0,'S'},
+	  {"perft-check",0,0,'C'},
+	  {"book",1,0,'k'},
+	  {"tablebase",0,0,'T'},
+	  {"stats",1,0,'s'},
+	  {"verbose",0,0,'v'},
+	  {"help",0,0,'h'},
+	  {"version",0,0,'V'},
+	  {0, 0, 0, 0}
+	};
+	while ((c = getopt_long (argc, argv, "g:d:a:D:j:t:w:b:o:BP:SCk:Ts:vhV",
+							 long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'g':
+				for (i=0; i<num_games; i++)
+					if (!strcasecmp (optarg, games[i]->name))
+						opt_game = games[i];
+				if (!opt_game)
+				{
+					fprintf (stderr, "%s: no such game\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'd':
+				time_per_move = atoi (optarg);
+				if (time_per_move <= 0)
+					time_per_move = 3000;
+				break;
+			case 'a':
+				opt_analyze = fopen (optarg, "r");
+				if (!opt_analyze)
+				{
+					fprintf (stderr, "could not open file %s for reading\n", optarg);
+					exit (1);
+				}
+				break;
+			case 'D':
+				opt_depth = atoi (optarg);
+				break;
+			case 'j':
+				opt_jobs = atoi (optarg);
+				break;
+			case 't':
+				opt_tourney = atoi (optarg);
+				break;
+			case 'w':
+				opt_wheur = optarg;
+				break;
+			case 'b':
+				opt_bheur = optarg;
+				break;
+			case 'o':
+				opt_open_plies = atoi (optarg);
+				break;
+			case 'B':
+				opt_bench = TRUE;
+				break;
+			case 'P':
+				opt_perft = atoi (optarg);
+				break;
+			case 'S':
+				opt_divide = TRUE;
+				break;
+			case 'C':
+				opt_perft_check = TRUE;
+				break;
+			case 'k':
+				opt_book = fopen (optarg, "r");
+				if (!opt_book)
+				{
+					fprintf (stderr, "could not open file %s for reading\n", optarg);
+					exit (1);
+				}
+				break;
+			case 'T':
+				opt_tb = TRUE;
+				break;
+			case 's':
+				if (!engine_set_stats_file (optarg))
+				{
+					fprintf (stderr, "can't open %s\n", optarg);
+					exit (1);
+				}
+				break;
+			case 'v':
+				opt_verbose = 1;
+				break;
+			case 'V':
+				printf("gtkboard-engine %s\n", GTKBOARD_VERSION);
+				exit(0);
+			case 'h':
+				printf ("Usage: gtkboard-engine \t[-vhV] [-g game] [-d msec]"
+						" [-a logfile | -t games [-w wheur -b bheur] [-o plies] | -B"
+						" | -P depth [-S] | -C | -k logfile | -T]"
+						" [-D depth] [-j jobs] [-s statsfile]"
+						"\n"
+						"\n"
+						"\t-g, --game\tname of the game\n"
+						"\t-d, --delay\tdefault time per move in milliseconds\n"
+						"\t-a, --analyze\tanalyze the games in a log file written with gtkboard -l\n"
+						"\t-t, --tournament\tplay this many games between two heuristics\n"
+						"\t-w, --w-heuristic\tname of the first heuristic for --tournament\n"
+						"\t-b, --b-heuristic\tname of the second heuristic for --tournament\n"
+						"\t-o, --opening\tnumber of random moves at the start of each game (default 4)\n"
+						"\t-B, --bench\tsearch the benchmark positions (of all games, unless -g is given)\n"
+						"\t-P, --perft\tcount the nodes of the game tree from the initial position\n"
+						"\t-S, --divide\tbreak the deepest perft count down by move\n"
+						"\t-C, --perft-check\tcompare perft counts with the known values\n"
+						"\t-k, --book\tbuild the opening book from a log file written with gtkboard -l;\n"
+						"\t\t\twith -D, also add the move of a search of that depth\n"
+						"\t-T, --tablebase\tbuild the endgame tablebase of the game\n"
+						"\t-D, --depth\tsearch depth (default: use the time per move)\n"
+						"\t-j, --jobs\tnumber of processes (default: number of cpus)\n"
+						"\t-s, --stats\tappend the statistics of each search to this file, as JSON lines\n"
+						"\t-v, --verbose\tbe verbose\n"
+						"\t-V, --version\tprint version and exit\n"
+						"\t-h, --help\tprint this help and exit\n"
+					   );
+				exit (0);
+			default:
+				exit (1);
+		}
+	}
+}
+
+int main (int argc, char **argv)
+{
+	srandom (get_seed());
+	reset_game_params ();
+	parse_opts (argc, argv);
+	if (opt_bench)
+	{
+		bench_run (opt_game, opt_depth);
+		return 0;
+	}
+	if (opt_perft_check)
+		return perft_check (opt_game, opt_depth) ? 1 : 0;
+	if (opt_game)
+		engine_set_game (opt_game);
+	if ((opt_analyze || opt_tourney > 0 || opt_book || opt_tb) && !opt_game)
+	{
+		fprintf (stderr, "game must be specified for --analyze, --tournament, --book and --tablebase\n");
+		exit (1);
+	}
+	if ((opt_wheur && !opt_bheur) || (opt_bheur && !opt_wheur))
+	{
+		fprintf (stderr, "specify heuristic for both players or neither\n");
+		exit (1);
+	}
+	if (opt_jobs <= 0)
+		opt_jobs = sysconf (_SC_NPROCESSORS_ONLN);
+	if (opt_perft > 0)
+	{
+		if (!opt_game)
+		{
+			fprintf (stderr, "game must be specified for --perft\n");
+			exit (1);
+		}
+		perft_run (opt_perft, opt_divide, stdout);
+		return 0;
+	}
+	if (opt_book)
+	{
+		if (!book_build (opt_book, opt_depth))
+		{
+			fprintf (stderr, "could not write the opening book\n");
+			return 1;
+		}
+		return 0;
+	}
+	if (opt_tb)
+	{
+		if (!tb_make ())
+		{
+			fprintf (stderr, "could not build the tablebase of %s\n", opt_game->name);
+			return 1;
+		}
+		return 0;
+	}
+	if (opt_analyze)
+	{
+		analyze_log (opt_analyze, opt_depth, opt_jobs);
+		return 0;
+	}
+	if (opt_tourney > 0)
+	{
+		tourney_run (opt_tourney, opt_wheur, opt_bheur, opt_depth, 
+				opt_open_plies, opt_jobs);
+		return 0;
+	}
+	engine_main (0, 1);
+	return 0;
+}
@@ -0,0 +1,275 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+/** \file game.c
+ \brief Definitions of the variables declared in game.h, and the list of games.
+
+ Everything here is shared by the ui and the engine, so nothing in this file
+ may depend on gtk.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+
+void game_set_init_pos_def (Pos *);
+
+extern Game 
+	Othello, Samegame, Rgb, Fifteen, Memory, 
+	Tetris, Chess, Antichess, Hiq, Checkers, 
+	Plot4, Maze, Infiltrate, Hypermaze, Ataxx, 
+	Pentaline, Mastermind, Pacman, Flw, Wordtris,
+	Ninemm, Stopgate, Knights, Breakthrough, 
+	CapturePento, Towers, Quarto, Kttour, Eightqueens, Dnb,
+	Blet, Othello6x6, Simple
+	;
+
+Game *games[] = { 
+	&Chess, 
+	&Antichess, 
+	&Breakthrough, 
+	
+	&Pacman, 
+	&Fifteen, 
+	&Samegame, 
+	&Tetris, 
+
+	&Blet, 
+	&Eightqueens, 
+	&Towers,
+	&Hiq,
+	
+	&Plot4, 
+	&Quarto, 
+	&Rgb, 
+	&Pentaline,
+	
+	&Dnb, 
+	&Stopgate, 
+	&CapturePento, 
+	&Knights, 
+
+	&Othello, 
+	&Othello6x6, 
+	
+	&Wordtris,
+	&Flw, 
+		
+	&Maze, 
+	&Hypermaze, 
+	
+	&Infiltrate, 
+	&Kttour, 
+	&Mastermind,
+	&Ataxx, 
+	&Checkers, 
+	&Memory, 
+	&Ninemm, 
+	&Simple
+		
+};
+
+const int num_games = sizeof (games) / sizeof (games[0]);
+
+gboolean engine_flag = FALSE; // are we client or server. server will set it to TRUE
+
+Pos cur_pos = {NULL, NULL, NULL, WHITE, NULL, NULL, 0, 0};
+
+int board_wid, board_heit;
+
+Game *opt_game = NULL;
+int opt_verbose = 0;
+
+static SCORE_FIELD score_fields_def[] = 
+{SCORE_FIELD_USER, SCORE_FIELD_SCORE, SCORE_FIELD_TIME, SCORE_FIELD_DATE, SCORE_FIELD_NONE};
+
+static gchar* score_field_names_def[] = {"User", "Score", "Time", "Date", NULL};
+
+static int scorecmp_dscore (gchar *score1, int temps1, gchar* score2, int temps2)
+{
+	int s1 = atoi (score1);
+	int s2 = atoi (score2);
+	if (s1 > s2) return 1;
+	if (s1 < s2) return -1;
+	if (temps1 < temps2) return 1;
+	if (temps1 > temps2) return -1;
+	return 0;
+}
+
+static int scorecmp_iscore (gchar *score1, int temps1, gchar* score2, int temps2)
+{
+	int s1 = atoi (score1);
+	int s2 = atoi (score2);
+	if (s1 < s2) return 1;
+	if (s1 > s2) return -1;
+	if (temps1 < temps2) return 1;
+	if (temps1 > temps2) return -1;
+	return 0;
+}
+
+static int scorecmp_time (gchar *score1, int temps1, gchar* score2, int temps2)
+{
+	if (temps1 < temps2) return 1;
+	if (temps1 > temps2) return -1;
+	return 0;
+}
+
+gboolean game_allow_undo = FALSE;
+
+gboolean game_single_player = FALSE;
+gboolean game_animation_use_movstack = TRUE;
+gboolean game_allow_back_forw = TRUE;
+int game_animation_time = 0;
+
+gchar *game_doc_about = NULL;
+gchar *game_doc_rules = NULL;
+gchar *game_doc_strategy = NULL;
+gchar *game_doc_history = NULL;
+CompletionStatus game_doc_about_status = STATUS_NONE;
+ 
+
+gchar *game_white_string = "White", *game_black_string = "Black";
+
+gboolean game_stateful = FALSE;
+gboolean game_draw_cell_boundaries = FALSE;
+gboolean game_start_immediately = FALSE;
+gboolean game_allow_flip = FALSE;
+gboolean game_file_label = 0,  game_rank_label = 0;
+
+char *game_highlight_colors = NULL;
+char game_highlight_colors_def[9] = {0xff, 0xff, 0, 0, 0, 0, 0, 0, 0};
+
+GameLevel *game_levels = NULL;
+HeurTab *game_htab = NULL;
+int game_state_size = 0;
+
+SCORE_FIELD * game_score_fields = score_fields_def;
+gchar **game_score_field_names = score_field_names_def;
+
+char **game_bg_pixmap = NULL;
+
+ResultType (*game_eval) (Pos *, Player, float *) = NULL;
+ResultType (*game_eval_incr) (Pos *, byte *, float *) = NULL;
+gboolean (*game_use_incr_eval) (Pos *) = NULL;
+float (*game_eval_white) (Pos *, int) = NULL;
+float (*game_eval_black) (Pos *, int) = NULL;
+void (*game_search) (Pos *, byte **) = NULL;
+int (*game_solve) (Pos *, byte *, float *, int *) = NULL;
+int game_solve_moves = 0;
+int game_tb_pieces = 0;
+gboolean (*game_tb_square) (int, int) = NULL;
+byte * (*game_movegen) (Pos *) = NULL;
+InputType (*game_event_handler) (Pos *, GtkboardEvent *, MoveInfo *) = NULL;
+int (*game_getmove) (Pos *, int, int, GtkboardEventType, Player, byte **, int **) = NULL;
+int (*game_getmove_kb) (Pos *, int, byte **, int **) = NULL;
+ResultType (*game_who_won) (Pos *, Player, char **) = NULL;
+int (*game_animate) (Pos *, byte **) = NULL;
+char **( *game_get_pixmap) (int, int) = NULL;
+guchar *( *game_get_rgbmap) (int, int) = NULL;
+void (*game_free) () = NULL;
+void * (*game_newstate) (Pos *, byte *) = NULL;
+void (*game_set_init_pos) (Pos *) = game_set_init_pos_def;
+void (*game_set_init_render) (Pos *) = NULL;
+void (*game_get_render) (Pos *, byte *, int **) = NULL;
+void (*game_reset_uistate) () = NULL;
+int (*game_scorecmp) (gchar *, int, gchar*, int) = NULL;
+int (*game_scorecmp_def_dscore) (gchar *, int, gchar*, int) = scorecmp_dscore;
+int (*game_scorecmp_def_iscore) (gchar *, int, gchar*, int) = scorecmp_iscore;
+int (*game_scorecmp_def_time) (gchar *, int, gchar*, int) = scorecmp_time;
+
+void game_set_init_pos_def (Pos *pos)
+{
+	int x, y;
+
+	for (x=0; x<board_wid; x++)
+		for (y=0; y<board_heit; y++)
+			pos->board[y * board_wid + x] = 
+				opt_game->init_pos ? 
+				opt_game->init_pos [(board_heit -1 - y) * board_wid + x] : 0;
+}
+
+
+void reset_game_params ()
+{
+	if (game_free) game_free ();
+	game_levels = NULL;
+	game_htab = NULL;
+	game_eval = NULL;
+	game_eval_incr = NULL;
+	game_use_incr_eval = NULL;
+	game_eval_white = NULL;
+	game_eval_black = NULL;
+	game_search = NULL;
+	game_solve = NULL;
+	game_solve_moves = 0;
+	game_tb_pieces = 0;
+	game_tb_square = NULL;
+	game_movegen = NULL;
+	game_event_handler = NULL;
+	game_getmove = NULL;
+	game_getmove_kb = NULL;
+	game_who_won  = NULL;
+	game_get_pixmap = NULL;
+	game_get_rgbmap = NULL;
+	game_set_init_pos = game_set_init_pos_def;
+	game_set_init_render = NULL;
+	game_get_render = NULL;
+	game_animate = NULL;
+	game_free = NULL;
+	game_scorecmp = NULL;
+	game_stateful = FALSE;
+	game_animation_use_movstack = TRUE;
+	game_allow_back_forw = TRUE;
+	game_single_player = FALSE;
+	game_allow_undo = FALSE;
+	game_doc_about_status = STATUS_NONE;
+	game_doc_about = NULL;
+	game_doc_rules = NULL;
+	game_doc_strategy = NULL;
+	game_doc_history = NULL;
+	game_white_string = "White";
+	game_black_string = "Black";
+	//state_player = WHITE;
+	// TODO: replace state_player by cur_pos.player globally
+	cur_pos.player = WHITE;
+	game_state_size = 0;
+	game_newstate = NULL;
+	game_reset_uistate = NULL;
+	game_highlight_colors = game_highlight_colors_def;
+	game_draw_cell_boundaries = FALSE;
+	game_start_immediately = FALSE;
+	game_allow_flip = FALSE;
+	game_file_label = FILERANK_LABEL_TYPE_NONE;
+	game_rank_label = FILERANK_LABEL_TYPE_NONE;
+	game_score_fields = score_fields_def;
+	game_score_field_names = score_field_names_def;
+	game_bg_pixmap = NULL;
+	if (cur_pos.board) free (cur_pos.board);
+	if (cur_pos.render) free (cur_pos.render);
+	cur_pos.game = NULL;
+	cur_pos.board = NULL;
+	cur_pos.render = NULL;
+	cur_pos.state = NULL;
+	cur_pos.ui_state = NULL;
+	cur_pos.num_moves = 0;
+	cur_pos.search_depth = 0;
+}
+
+// Local Variables:
+// tab-width: 4
+// End:
@@ -327,15 +327,52 @@ extern ResultType (*game_eval) (Pos *pos, Player player, float *eval);
  to implement game_eval even if you implement this function. Since
  premature optimization is the root of all evil, it is highly recommended
  that you get your game working and stable before you think of implementing
- this function :)*/
+ this function :)
+
+ The search adds the difference to the eval of pos, so it must be the
+ difference of the values that game_eval() would return. If the move
+ ends the game, return the result and set eval to the value of the final
+ position instead of the difference. pos is the position before the move,
+ and must be unchanged when the function returns. */
 extern ResultType (*game_eval_incr) (Pos *pos, byte *move, float *eval);
 
 //! Should we use the incr eval function
+/** Called with the position whose moves are about to be evaluated. If 
+ this is NULL, game_eval_incr is always used when it is set. */
 extern gboolean (*game_use_incr_eval) (Pos *pos);
 
 //! A function to search and return the best move - for games for which minimax is not appropriate
 extern void (*game_search) (Pos *pos, byte **move);
 
+//! A function to search a position exactly to the end of the game. Optional.
+/** If the game implements this, ab_dfid() calls it before starting the
+ alpha-beta search, and uses its answer if it has one. It should only
+ solve the position if that can be done quickly, typically when at most 
+ #game_solve_moves moves remain, and return 0 otherwise. If it solves the
+ position it copies the best move into best_move, sets eval to the exact
+ value (which should be at least GAME_EVAL_INFTY in absolute value if 
+ the game is not a draw), sets nodes to the number of positions searched,
+ and returns the number of ply searched. It should poll the engine
+ with engine_poll() and give up, returning 0, if engine_stop_search 
+ becomes TRUE. */
+extern int (*game_solve) (Pos *pos, byte *best_move, float *eval, int *nodes);
+
+//! game_solve should only solve positions with at most this many moves left
+/** Each game that uses it sets its own default in its init function; the 
+ solve_moves option of gtkboard-engine changes it until the next game is
+ selected. */
+extern int game_solve_moves;
+
+//! Positions with at most this many pieces are looked up in an endgame tablebase
+/** The default is 0, meaning no tablebase. See tb.h. The game must have
+ game_who_won and must not be stateful. */
+extern int game_tb_pieces;
+
+//! If not NULL, the tablebase only has positions with pieces on the squares where this is TRUE
+/** Leaving out squares that are never used, like the light squares in
+ checkers, makes the tablebase much smaller and quicker to build. */
+extern gboolean (*game_tb_square) (int x, int y);
+
 //! A pointer to the game's move generation function.
 /** Only for two player games. It <b>must</b> be implemented if you want
   the computer to be able to play the game. 
@@ -73,6 +73,9 @@ typedef struct
 	byte *best_move;
 } hash_t;
 
+//! A position is stored at most this many slots after the one it hashes to
+#define HASH_MAX_PROBES 11
+
 static int hash_table_size = 1 << 16;
 static int hash_table_max = 3 * 1 << 14;
 static int num_hash_coeffts = 1024;
@@ -81,6 +84,7 @@ static hash_t *hash_table = NULL;
 static int hash_filled = 0;
 static int hash_eval_hits = 0, hash_eval_misses = 0;
 static int hash_move_hits = 0, hash_move_misses = 0;
+static int hash_stores = 0, hash_collisions = 0;
 
 static void hash_init ()
 	/* malloc the stuff */
@@ -128,8 +132,8 @@ void hash_insert (byte *pos, int poslen, int num_moves, int depth, float eval,
 {
 	uint start = get_hash (pos, poslen) % hash_table_size;
 	uint check = get_check (pos, poslen);
-	int idx, cnt = 0;
-	for (idx=start; cnt <= 10; idx = (idx+1) % hash_table_size, cnt++)
+	int idx, cnt = 0, victim = -1;
+	for (idx=start; cnt < HASH_MAX_PROBES; idx = (idx+1) % hash_table_size, cnt++)
 	{
 		if (hash_table[idx].free)
 		{
@@ -146,7 +150,19 @@ void hash_insert (byte *pos, int poslen, int num_moves, int depth, float eval,
 			break;
 		if (hash_filled >= hash_table_max && depth > hash_table[idx].depth)
 			break;
+		if (victim < 0 || hash_table[idx].depth < hash_table[victim].depth)
+			victim = idx;
+	}
+	if (cnt == HASH_MAX_PROBES)
+	{
+		// the table is full: replace the shallowest entry seen, if any
+		if (victim < 0)
+			return;
+		idx = victim;
 	}
+	hash_stores++;
+	if (hash_table[idx].free == 0 && hash_table[idx].check != check)
+		hash_collisions++;
 	if (hash_table[idx].free == 0 && hash_table[idx].best_move)
 		free (hash_table[idx].best_move);
 	hash_table[idx].free = 0;
@@ -165,7 +181,9 @@ int hash_get_eval (byte *pos, int poslen, int num_moves, int depth, float *evalp
 {
 	uint idx = get_hash (pos, poslen) % hash_table_size;
 	uint check = get_check (pos, poslen);
-	for (; hash_table[idx].free == 0; idx = (idx+1) % hash_table_size)
+	int cnt;
+	for (cnt = 0; cnt < HASH_MAX_PROBES && hash_table[idx].free == 0; 
+			idx = (idx+1) % hash_table_size, cnt++)
 	{
 		if (hash_table[idx].check == check)	/* found it */
 		{
@@ -191,7 +209,9 @@ byte * hash_get_move (byte *pos, int poslen, int num_moves)
 {
 	uint idx = get_hash (pos, poslen) % hash_table_size;
 	uint check = get_check (pos, poslen);
-	for (; hash_table[idx].free == 0; idx = (idx+1) % hash_table_size)
+	int cnt;
+	for (cnt = 0; cnt < HASH_MAX_PROBES && hash_table[idx].free == 0; 
+			idx = (idx+1) % hash_table_size, cnt++)
 	{
 		if (hash_table[idx].check == check)	/* found it */
 		{
@@ -212,6 +232,8 @@ byte * hash_get_move (byte *pos, int poslen, int num_moves)
 void hash_clear ()
 {
 	int i;
+	if (!hash_table)
+		return;
 	for (i=0; i<hash_table_size; i++)
 	{
 		if (hash_table[i].free == 0 && hash_table[i].best_move)
@@ -221,6 +243,20 @@ void hash_clear ()
 	hash_filled = 0;
 }
 
+//! Number of calls to hash_get_eval() and how many of them found the position, since the last hash_print_stats()
+void hash_get_stats (int *probes, int *hits)
+{
+	*probes = hash_eval_hits + hash_eval_misses;
+	*hits = hash_eval_hits;
+}
+
+//! Number of calls to hash_insert() and how many of them replaced another position, since the last hash_print_stats()
+void hash_get_store_stats (int *stores, int *collisions)
+{
+	*stores = hash_stores;
+	*collisions = hash_collisions;
+}
+
 void hash_print_stats ()
 {
 	int i, stale=0;
@@ -228,7 +264,8 @@ void hash_print_stats ()
 			hash_table_size, hash_filled, 
 			hash_eval_hits, hash_eval_misses, hash_move_hits, hash_move_misses);
 	hash_eval_hits = hash_eval_misses = hash_move_hits = hash_move_misses = 0;
-	for (i=0; i<hash_table_size; i++)
+	hash_stores = hash_collisions = 0;
+	for (i=0; hash_table && i<hash_table_size; i++)
 	{
 		if (!hash_table[i].free && hash_table[i].stale)
 			stale++;
@@ -0,0 +1,52 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _KEYSYMS_H_
+#define _KEYSYMS_H_
+
+/** \file keysyms.h
+  \brief The key symbols that games use in game_getmove_kb() and game_event_handler().
+
+  The values are the same as in gdk/gdkkeysyms.h, which is what the ui
+  passes to the games. We keep our own copy so that the games can be
+  compiled without gtk. Add more as games need them.
+  */
+
+#ifndef GDK_space
+#define GDK_space 0x020
+#define GDK_A 0x041
+#define GDK_Z 0x05a
+#define GDK_a 0x061
+#define GDK_p 0x070
+#define GDK_z 0x07a
+#define GDK_Return 0xff0d
+#define GDK_Left 0xff51
+#define GDK_Up 0xff52
+#define GDK_Right 0xff53
+#define GDK_Down 0xff54
+#define GDK_KP_Home 0xff95
+#define GDK_KP_Left 0xff96
+#define GDK_KP_Up 0xff97
+#define GDK_KP_Right 0xff98
+#define GDK_KP_Down 0xff99
+#define GDK_KP_Page_Up 0xff9a
+#define GDK_KP_Page_Down 0xff9b
+#define GDK_KP_End 0xff9c
+#endif
+
+#endif
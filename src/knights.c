@@ -22,7 +22,8 @@
 #include <assert.h>
 
 #include "game.h"
-#include "gdk/gdkkeysyms.h"
+#include "keysyms.h"
+#include "knightsbb.h"
 #include "../pixmaps/chess.xpm"
 #include "../pixmaps/misc.xpm"
 
@@ -222,91 +223,12 @@ byte * knights_movegen (Pos *pos)
 	return movlist;
 }
 
-static gboolean eval_disconnected (byte *theboard)
-{
-	byte board[KNIGHTS_BOARD_WID * KNIGHTS_BOARD_HEIT];
-	int stack[KNIGHTS_BOARD_WID * KNIGHTS_BOARD_HEIT];
-	int stack_top = 0;
-	int i, curx, cury, x, y;
-
-	for (i=0; i<board_wid * board_heit; i++)
-		board[i] = theboard[i];
-
-	get_cur_pos (board, WHITE, &curx, &cury);
-	
-	stack[stack_top++] = cury * board_wid + curx;
-	while (stack_top > 0)
-	{
-		stack_top--;
-		curx = stack[stack_top] % board_wid;
-		cury = stack[stack_top] / board_wid;
-		for (i=0; i<8; i++)
-		{
-			x = curx + incx[i];
-			y = cury + incy[i];
-			if (!ISINBOARD (x, y)) continue;
-			if (board[y * board_wid + x] == KNIGHTS_BN)
-				return FALSE;
-			if (board[y * board_wid + x] != KNIGHTS_EMPTY)
-				continue;
-			board[y * board_wid + x] = KNIGHTS_CLOSED;
-			stack[stack_top++] = y * board_wid + x;
-		}
-	}
-	return TRUE;
-}
-
-// exhaustive DFS to solve the position exactly
-static int eval_max_path_len (byte *theboard, Player player)
-{
-	byte board[KNIGHTS_BOARD_WID * KNIGHTS_BOARD_HEIT];
-	int stack [KNIGHTS_BOARD_WID * KNIGHTS_BOARD_HEIT];
-	int current [KNIGHTS_BOARD_WID * KNIGHTS_BOARD_HEIT];
-	int stack_top = 0;
-	int i, curx, cury, x, y;
-	int max_len = 0;
-
-	for (i=0; i<board_wid * board_heit; i++)
-		board[i] = theboard[i];
-
-	get_cur_pos (board, player, &curx, &cury);
-	
-	current[stack_top] = 0;
-	stack[stack_top] = cury * board_wid + curx;
-
-	while (stack_top >= 0)
-	{
-		if (stack_top > max_len)
-			max_len = stack_top;
-		i = current[stack_top]++;
-		if (i == 8)
-		{
-			stack_top--;
-			continue;
-		}
-		curx = stack[stack_top] % board_wid;
-		cury = stack[stack_top] / board_wid;
-		x = curx + incx[i];
-		y = cury + incy[i];
-		if (!ISINBOARD (x, y)) continue;
-		if (board[y * board_wid + x] != KNIGHTS_EMPTY)
-			continue;
-		board[y * board_wid + x] = KNIGHTS_CLOSED;
-		stack_top++;
-		current[stack_top] = 0;
-		stack[stack_top] = y * board_wid + x;
-	}
-	return max_len;
-}
-
 // We may want to continue the game even when a result is apparent. The
 // parameter strict is for this. who_won() sets it to TRUE and eval() to FALSE.
 static ResultType knights_eval_real (Pos *pos, Player player, float *eval, gboolean strict)
 {
-	int i, j, k;
-	int wcnt = 0, bcnt = 0;
-	static int disconn_cnt [2 * KNIGHTS_BOARD_WID * KNIGHTS_BOARD_HEIT] = {0};
-	static int total_cnt [2 * KNIGHTS_BOARD_WID * KNIGHTS_BOARD_HEIT] = {0};
+	int wcnt, bcnt, wsq, bsq;
+	guint64 empty;
 
 	if (pos->state && ((Knights_state *)pos->state)->num_pauses >= 2)
 	{
@@ -314,39 +236,23 @@ static ResultType knights_eval_real (Pos *pos, Player player, float *eval, gbool
 		return RESULT_TIE;
 	}
 	
-	if (!strict && eval_disconnected (pos->board))
+	knightsbb_from_board (pos->board, KNIGHTS_EMPTY, KNIGHTS_WN, KNIGHTS_BN, 
+			&empty, &wsq, &bsq);
+
+	// once the knights can't meet, the longer path wins
+	if (!strict && !(knightsbb_attacks (knightsbb_reach (wsq, empty) | KNIGHTSBB_BIT (wsq)) 
+				& KNIGHTSBB_BIT (bsq)))
 	{
-		int wlen = 0, blen = 0;
-		disconn_cnt [pos->num_moves]++;
-		total_cnt[pos->num_moves]++;
-		wlen = eval_max_path_len (pos->board, WHITE);
-		blen = eval_max_path_len (pos->board, BLACK);
+		int wlen = knightsbb_path_len (wsq, empty);
+		int blen = knightsbb_path_len (bsq, empty);
 		*eval = 2 * (wlen - blen) + (player == WHITE ? -1 : 1);
 		if (wlen > blen) return RESULT_WHITE;
 		else if (wlen < blen) return RESULT_BLACK;
 		else return player == WHITE ? RESULT_BLACK : RESULT_WHITE;
 	}
 
-	total_cnt[pos->num_moves]++;
-//	if (total_cnt[pos->num_moves] % 10000 == 0) printf ("Ply: %d;\t total: %d;\t disc: %d\n", pos->num_moves, total_cnt[pos->num_moves], disconn_cnt[pos->num_moves]);
-
-	get_cur_pos (pos->board, WHITE, &i, &j);
-	for (k=0; k<8; k++)
-	{
-		int x = i + incx[k], y = j + incy[k];
-		if (!ISINBOARD (x, y)) continue;
-		if (pos->board[y * board_wid + x] == KNIGHTS_EMPTY)
-			wcnt++;
-	}
-
-	get_cur_pos (pos->board, BLACK, &i, &j);
-	for (k=0; k<8; k++)
-	{
-		int x = i + incx[k], y = j + incy[k];
-		if (!ISINBOARD (x, y)) continue;
-		if (pos->board[y * board_wid + x] == KNIGHTS_EMPTY)
-			bcnt++;
-	}
+	wcnt = knightsbb_count (knightsbb_attacks (KNIGHTSBB_BIT (wsq)) & empty);
+	bcnt = knightsbb_count (knightsbb_attacks (KNIGHTSBB_BIT (bsq)) & empty);
 	*eval = wcnt - bcnt;
 	if (player == WHITE && wcnt == 0)
 	{
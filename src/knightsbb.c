@@ -0,0 +1,128 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+/** \file knightsbb.c
+  \brief Bitboards for the 7x7 board of Balanced Joust.
+  */
+
+#include "knightsbb.h"
+
+#define FILE_0 G_GUINT64_CONSTANT(0x0040810204081)
+#define FILE_1 (FILE_0 << 1)
+#define FILE_5 (FILE_0 << 5)
+#define FILE_6 (FILE_0 << 6)
+#define SQUARES G_GUINT64_CONSTANT(0x1ffffffffffff)
+
+//! Knight moves in the order Balanced Joust has always tried them
+static const int path_dx[] = { -2, -2, -1, -1, 1, 1, 2, 2};
+static const int path_dy[] = { -1, 1, -2, 2, -2, 2, -1, 1};
+
+void knightsbb_from_board (byte *board, int empty_val, int wn_val, int bn_val,
+		guint64 *empty, int *wsq, int *bsq)
+{
+	int i;
+	*empty = 0;
+	*wsq = *bsq = -1;
+	for (i=0; i<49; i++)
+	{
+		if (board[i] == empty_val)
+			*empty |= KNIGHTSBB_BIT (i);
+		else if (board[i] == wn_val)
+			*wsq = i;
+		else if (board[i] == bn_val)
+			*bsq = i;
+	}
+}
+
+int knightsbb_count (guint64 b)
+{
+	b = b - ((b >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+	b = (b & G_GUINT64_CONSTANT(0x3333333333333333)) 
+		+ ((b >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+	b = (b + (b >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+	return (int) ((b * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56);
+}
+
+guint64 knightsbb_attacks (guint64 b)
+{
+	guint64 not_0 = b & ~FILE_0, not_6 = b & ~FILE_6;
+	guint64 not_01 = b & ~(FILE_0 | FILE_1), not_56 = b & ~(FILE_5 | FILE_6);
+	return ((not_6 << 15) | (not_0 << 13) | (not_56 << 9) | (not_01 << 5)
+		| (not_6 >> 13) | (not_0 >> 15) | (not_56 >> 5) | (not_01 >> 9)) & SQUARES;
+}
+
+guint64 knightsbb_reach (int sq, guint64 empty)
+{
+	guint64 reach = 0, frontier = KNIGHTSBB_BIT (sq);
+	while (frontier)
+	{
+		frontier = knightsbb_attacks (frontier) & empty & ~reach;
+		reach |= frontier;
+	}
+	return reach;
+}
+
+static int path_dfs (int sq, guint64 *open, int depth)
+{
+	int i, best = depth;
+	for (i=0; i<8; i++)
+	{
+		int x = sq % 7 + path_dx[i], y = sq / 7 + path_dy[i], len;
+		if (x < 0 || x >= 7 || y < 0 || y >= 7)
+			continue;
+		if (!(*open & KNIGHTSBB_BIT (y * 7 + x)))
+			continue;
+		*open &= ~KNIGHTSBB_BIT (y * 7 + x);
+		len = path_dfs (y * 7 + x, open, depth + 1);
+		if (len > best)
+			best = len;
+	}
+	return best;
+}
+
+//! log2 of the number of entries of the path length cache
+#define PATH_CACHE_BITS 16
+
+typedef struct
+{
+	guint64 region;
+	//! sq + 1, so that the zeroed table is empty
+	gint8 sq1;
+	gint8 len;
+} PathCacheEntry;
+
+//! Path lengths already searched, keyed on the region the knight can reach and its square
+/** The search never leaves the region, so the region and the square 
+  determine the result. Once the knights are cut off from each other the 
+  region only shrinks by the knight's own moves, and the same few regions 
+  come up at many leaves. */
+static PathCacheEntry path_cache [1 << PATH_CACHE_BITS];
+
+int knightsbb_path_len (int sq, guint64 empty)
+{
+	guint64 region = knightsbb_reach (sq, empty);
+	PathCacheEntry *entry = &path_cache 
+		[((region ^ sq) * G_GUINT64_CONSTANT(0x9e3779b97f4a7c15)) >> (64 - PATH_CACHE_BITS)];
+	if (entry->sq1 != sq + 1 || entry->region != region)
+	{
+		entry->region = region;
+		entry->sq1 = sq + 1;
+		entry->len = path_dfs (sq, &region, 0);
+	}
+	return entry->len;
+}
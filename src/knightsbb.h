@@ -0,0 +1,51 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _KNIGHTSBB_H_
+#define _KNIGHTSBB_H_
+
+#include "game.h"
+
+/** \file knightsbb.h
+  \brief Bitboards for the 7x7 board of Balanced Joust.
+
+  Square (x, y) is bit y * 7 + x, the same order as Pos::board.
+  */
+
+#define KNIGHTSBB_BIT(sq) (G_GUINT64_CONSTANT(1) << (sq))
+
+//! Makes a bitboard of the empty squares and finds the knights of a board in the format of Pos::board
+void knightsbb_from_board (byte *board, int empty_val, int wn_val, int bn_val,
+		guint64 *empty, int *wsq, int *bsq);
+
+//! Number of bits set
+int knightsbb_count (guint64 b);
+
+//! The squares a knight on any square of b attacks
+guint64 knightsbb_attacks (guint64 b);
+
+//! The squares of empty that a knight on sq can get to, one move at a time through empty
+guint64 knightsbb_reach (int sq, guint64 empty);
+
+//! The depth of a depth-first search of the knight from sq through empty
+/** Squares are not freed on backtracking, so this is linear in the number
+  of squares and only estimates the longest path from below. The results are 
+  cached. */
+int knightsbb_path_len (int sq, guint64 empty);
+
+#endif
@@ -23,7 +23,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
-#include <gdk/gdkkeysyms.h>
+#include "keysyms.h"
 
 #include "game.h"
 #include "aaball.h"
@@ -21,7 +21,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <math.h>
-#include <gdk/gdkkeysyms.h>
+#include "keysyms.h"
 
 #include "game.h"
 #include "aaball.h"
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <signal.h>
 
 extern int board_wid, board_heit;
@@ -60,6 +61,14 @@ byte *movlist_next (byte *move)
 	return move + 1;
 }
 
+gboolean movlist_contains (byte *movlist, byte *move)
+{
+	for (; movlist[0] != -2; movlist = movlist_next (movlist))
+		if (movcmp_literal (movlist, move))
+			return TRUE;
+	return FALSE;
+}
+
 void move_apply (byte *board, byte *move)
 {
 	int i, x, y;
@@ -133,6 +142,28 @@ byte *move_read (char *line)
 	return movbuf;
 }
 
+byte *move_read_checked (char *line)
+{
+	char *c, *end;
+	int nc = 0;
+	for (c = line; ; c = end, nc++)
+	{
+		long val = strtol (c, &end, 10);
+		if (end == c)
+			break;
+		if ((nc % 3 == 0 && (val < 1 || val > board_wid))
+				|| (nc % 3 == 1 && (val < 1 || val > board_heit))
+				|| (nc % 3 == 2 && (val < -128 || val > 127))
+				|| nc >= 1023)
+			return NULL;
+	}
+	while (isspace (*c))
+		c++;
+	if (*c || nc % 3 != 0)
+		return NULL;
+	return move_read (line);
+}
+
 static byte linebuf [4096];
 
 byte *move_fread (FILE *fin)
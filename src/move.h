@@ -67,6 +67,9 @@ void move_fwrite (byte *, FILE *);
 //! Parses a string into a move
 byte * move_read (char *);
 
+//! Like move_read(), but returns NULL for a line that is not a move on this board instead of asserting
+byte * move_read_checked (char *);
+
 //! Reads a move from the pipe.
 byte *move_fread (FILE *);
 
@@ -85,4 +88,7 @@ void move_fwrite_nak (char *, FILE *);
 //! Returns the next move in a movlist.
 /** A movlist is also an array of <tt>byte</tt>s. It is a sequence of moves terminated by -2 */
 byte *movlist_next (byte *);
+
+//! Returns TRUE if the move is in the movlist
+gboolean movlist_contains (byte *movlist, byte *move);
 #endif
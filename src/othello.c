@@ -20,10 +20,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-#include <gdk/gdkkeysyms.h>
+#include "keysyms.h"
 
 #include "game.h"
 #include "aaball.h"
+#include "othellobb.h"
 
 #define OTHELLO_CELL_SIZE 55
 #define OTHELLO_NUM_PIECES 2
@@ -64,9 +65,11 @@ ResultType othello_who_won (Pos *, Player, char **);
 ResultType othello_eval (Pos *, Player, float *);
 ResultType othello_eval_incr (Pos *, byte *, float *);
 byte * othello_movegen (Pos *);
+static int othello_solve (Pos *, byte *, float *, int *);
 char ** othello_get_pixmap (int, int);
 guchar *othello_get_rgbmap (int, int);
 gboolean othello_use_incr_eval (Pos *pos);
+extern HeurTab othello_heurtab[];
 
 Game Othello = { OTHELLO_CELL_SIZE, 8, 8,
 	OTHELLO_NUM_PIECES, 
@@ -86,6 +89,9 @@ void othello_init (Game *game)
 	game_eval_incr = othello_eval_incr;
 	game_use_incr_eval = othello_use_incr_eval;
 	game_movegen = othello_movegen;
+	game_solve = othello_solve;
+	game_solve_moves = 18;
+	game_htab = othello_heurtab;
 	game_get_rgbmap = othello_get_rgbmap;
 	game_white_string = "Red";
 	game_black_string = "Blue";
@@ -168,23 +174,19 @@ static int get_sandwich_len (Pos *pos, int x0, int y0, int dx, int dy, byte play
 // does player have a move in this position
 static gboolean hasmove (Pos *pos, Player player)
 {
-	int i, x, y, found = FALSE;
-	for (x=0; x<board_wid && !found; x++)
-		for (y=0; y<board_heit && !found; y++)
-		{
-			if (pos->board [y * board_wid + x] != OTHELLO_EMPTY)
-				continue;
-			for (i=0; i<8; i++)
-			{
-				if (get_sandwich_len (pos, x, y ,incx[i], incy[i], 
-						player == WHITE ? OTHELLO_WP : OTHELLO_BP) > 0)
-				{
-					found = TRUE;
-					break;
-				}
-			}
-		}
-	return found;
+	guint64 white, black;
+	othellobb_from_board (pos->board, &white, &black);
+	return player == WHITE ? othellobb_moves (white, black) != 0
+		: othellobb_moves (black, white) != 0;
+}
+
+//! The game is over when neither side can move, not only when the board is full
+static gboolean game_over (Pos *pos)
+{
+	guint64 white, black;
+	othellobb_from_board (pos->board, &white, &black);
+	return othellobb_moves (white, black) == 0 
+		&& othellobb_moves (black, white) == 0;
 }
 
 int othello_getmove_kb (Pos *pos, int key,  byte **movp, int **rmovp)
@@ -246,7 +248,8 @@ ResultType othello_who_won (Pos *pos, Player to_play, char **commp)
 		else if (pos->board[i] == OTHELLO_BP)
 			bscore++;
 	if (! (wscore == 0 || bscore == 0 
-				|| wscore + bscore == board_wid * board_heit))
+				|| wscore + bscore == board_wid * board_heit
+				|| game_over (pos)))
 	{
 		snprintf (comment, 32, "%d : %d", wscore, bscore);
 		*commp = comment;
@@ -266,40 +269,27 @@ ResultType othello_who_won (Pos *pos, Player to_play, char **commp)
 
 byte * othello_movegen (Pos *pos)
 {
-	int i, j, x, y, sw_len;
+	int x, y;
 	byte movbuf [4096];
 	byte *movlist, *movp = movbuf;
 	Player player = pos->player;
 	byte our = player == WHITE ? OTHELLO_WP : OTHELLO_BP;
-	gboolean game_over = TRUE;
-	for (x=0; x<board_wid; x++)
-		for (y=0; y<board_wid; y++)
+	guint64 white, black, own, opp, moves;
+	othellobb_from_board (pos->board, &white, &black);
+	own = player == WHITE ? white : black;
+	opp = player == WHITE ? black : white;
+	moves = othellobb_moves (own, opp);
+	for (x=0; x<board_wid && moves; x++)
+		for (y=0; y<board_heit; y++)
 		{
-			gboolean found = FALSE;
-			if (pos->board [y * board_wid + x] != OTHELLO_EMPTY)
+			if (!(moves & OTHELLOBB_BIT (x, y)))
 				continue;
-			game_over = FALSE;
-			for (i=0; i<8; i++)
-			{
-				sw_len = get_sandwich_len (pos, x, y ,incx[i], incy[i], 
-						player == WHITE ? OTHELLO_WP : OTHELLO_BP);
-				if (sw_len > 0) found = TRUE;
-				for (j=1; j<=sw_len; j++)
-				{
-					*movp++ = x + incx[i] * j;
-					*movp++ = y + incy[i] * j;
-					*movp++ = our;
-				}		
-			}
-			if (!found)
-				continue;
-			*movp++ = x;
-			*movp++ = y;
-			*movp++ = our;
-			*movp++ = -1;
+			movp = othellobb_write_move (movp, x, y, 
+					othellobb_flips (own, opp, x, y), our);
+			moves &= ~OTHELLOBB_BIT (x, y);
 		}
 	/* if we want to pass, we must return an empty move, NOT no move */
-	if (movp == movbuf && !game_over)
+	if (movp == movbuf && othellobb_moves (opp, own))
 		*movp++ = -1;
 	*movp++ = -2;
 	movlist = (byte *) (malloc (movp - movbuf));
@@ -318,26 +308,13 @@ static float othello_eval_count (Pos *pos)
 	return sum;
 }
 
+//! Number of moves that color has
 static int othello_eval_mobility_count (Pos *pos, int color)
 {
-	int i, x, y, found, sum = 0;
-	byte our = (color == WHITE ? OTHELLO_WP : OTHELLO_BP);
-	for (x=0; x<board_wid; x++)
-		for (y=0; y<board_heit; y++)
-		{
-			if (pos->board [y * board_wid + x] != our)
-				continue;
-			found = 0;
-			for (i=0; i<8; i++)
-				if (get_sandwich_len (pos, x, y ,incx[i], incy[i], our) > 0)
-				{
-					found = 1;
-					break;
-				}
-			if (found)
-				sum++;
-		}
-	return sum;
+	guint64 white, black;
+	othellobb_from_board (pos->board, &white, &black);
+	return othellobb_count (color == WHITE ? othellobb_moves (white, black)
+			: othellobb_moves (black, white));
 }
 
 static float othello_eval_mobility (Pos *pos)
@@ -349,24 +326,9 @@ static float othello_eval_mobility (Pos *pos)
 //! Faster approxmiation for mobility
 static float othello_eval_liberty (Pos *pos)
 {
-	int i, j, k;
-	int liberty = 0;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	{
-		if (pos->board [j * board_wid + i] != OTHELLO_EMPTY)
-			continue;
-		for (k=0; k<8; k++)
-		{
-			int x = i + incx[k], y = j + incy[k];
-			int val;
-			if (!ISINBOARD (x, y)) continue;
-			if ((val = pos->board [y * board_wid + x]) == OTHELLO_EMPTY)
-				continue;
-			liberty += (val == OTHELLO_WP ? -1 : 1);
-		}
-	}
-	return liberty;
+	guint64 white, black;
+	othellobb_from_board (pos->board, &white, &black);
+	return othellobb_liberty (white, black);
 }
 
 static int othello_eval_num_moves (Pos *pos)
@@ -522,21 +484,20 @@ static float othello_eval_weights (Pos *pos)
 
 ResultType othello_eval (Pos *pos, Player player, float *eval)
 {
-	int i;
-	gboolean found;
+	if (game_over (pos))
+	{
+		*eval = othello_eval_material (pos);
+		*eval *= GAME_EVAL_INFTY;
+		if (*eval > 0) return RESULT_WHITE;
+		if (*eval < 0) return RESULT_BLACK;
+		return RESULT_TIE;
+	}
 
-	if (pos->num_moves >= board_wid * board_heit)
+	// the search then adds up othello_eval_incr(), which counts discs
+	if (othello_use_incr_eval (pos))
 	{
-		for (i=0, found=FALSE; i<board_wid*board_heit; i++)
-			if (pos->board [i] == OTHELLO_EMPTY) {found = TRUE; break;}
-		if (!found)
-		{
-			*eval = othello_eval_material (pos);
-			*eval *= GAME_EVAL_INFTY;
-			if (*eval > 0) return RESULT_WHITE;
-			if (*eval < 0) return RESULT_BLACK;
-			return RESULT_NOTYET;
-		}
+		*eval = othello_eval_material (pos);
+		return RESULT_NOTYET;
 	}
 
 	*eval = 
@@ -547,16 +508,94 @@ ResultType othello_eval (Pos *pos, Player player, float *eval)
 	return RESULT_NOTYET;
 }
 
+static float othello_heur_standard (Pos *pos, int player)
+{
+	float eval;
+	othello_eval (pos, player, &eval);
+	return eval;
+}
+
+//! Like othello_eval() but with the exact mobility instead of the liberties
+static float othello_heur_mobility (Pos *pos, int player)
+{
+	if (game_over (pos))
+		return othello_eval_material (pos) * GAME_EVAL_INFTY;
+	return 10 * othello_eval_mobility (pos) 
+		+ 100 * othello_eval_safe (pos) 
+		+ othello_eval_weights (pos);
+}
+
+static float othello_heur_weights (Pos *pos, int player)
+{
+	if (game_over (pos))
+		return othello_eval_material (pos) * GAME_EVAL_INFTY;
+	return othello_eval_weights (pos);
+}
+
+HeurTab othello_heurtab[] = 
+{
+	{ "standard", othello_heur_standard, "liberties, stable discs and square weights", NULL },
+	{ "mobility", othello_heur_mobility, "legal moves, stable discs and square weights", NULL },
+	{ "weights", othello_heur_weights, "square weights only", NULL },
+	{ NULL, NULL, NULL, NULL },
+};
+
+//! Plays the last game_solve_moves empty squares perfectly
+static int othello_solve (Pos *pos, byte *best_move, float *eval, int *nodes)
+{
+	guint64 white, black, own, opp;
+	int empties, val, sq;
+	long solve_nodes;
+	othellobb_from_board (pos->board, &white, &black);
+	empties = othellobb_count (othellobb_squares () & ~(white | black));
+	if (empties > game_solve_moves)
+		return 0;
+	own = pos->player == WHITE ? white : black;
+	opp = pos->player == WHITE ? black : white;
+	val = othellobb_solve (own, opp, &sq, &solve_nodes);
+	*nodes = solve_nodes;
+	if (val < -64)
+		return 0;
+	if (sq >= 0)
+		othellobb_write_move (best_move, sq % 8, sq / 8, 
+				othellobb_flips (own, opp, sq % 8, sq / 8),
+				pos->player == WHITE ? OTHELLO_WP : OTHELLO_BP);
+	else
+		best_move[0] = -1;
+	if (pos->player == BLACK)
+		val = -val;
+	*eval = val * GAME_EVAL_INFTY;
+	return empties > 0 ? empties : 1;
+}
+
 ResultType othello_eval_incr (Pos *pos, byte *move, float *eval)
 {
 	int i;
+	guint64 white, black, *own, *opp;
 	for (i=0; move[3*i] != -1; i++)
 		;
 	if (i == 0) 
+	{
 		*eval = 0;
-	else
-		*eval = (pos->player == WHITE ? (2 * i - 1) : - (2 * i - 1));
-	return RESULT_NOTYET;
+		return RESULT_NOTYET;
+	}
+	*eval = (pos->player == WHITE ? (2 * i - 1) : - (2 * i - 1));
+
+	// does the move end the game?
+	othellobb_from_board (pos->board, &white, &black);
+	own = pos->player == WHITE ? &white : &black;
+	opp = pos->player == WHITE ? &black : &white;
+	for (i=0; move[3*i] != -1; i++)
+	{
+		*own |= OTHELLOBB_BIT (move[3*i], move[3*i+1]);
+		*opp &= ~OTHELLOBB_BIT (move[3*i], move[3*i+1]);
+	}
+	if (othellobb_moves (white, black) || othellobb_moves (black, white))
+		return RESULT_NOTYET;
+	*eval = (othellobb_count (white) - othellobb_count (black)) * GAME_EVAL_INFTY;
+	if (*eval > 0) return RESULT_WHITE;
+	if (*eval < 0) return RESULT_BLACK;
+	return RESULT_TIE;
 }
 
 gboolean othello_use_incr_eval (Pos *pos)
@@ -0,0 +1,360 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "game.h"
+#include "othellobb.h"
+
+/** \file othellobb.c
+  \brief Bitboards for Othello and Othello 6x6.
+
+  Moves and flips are found by shifting whole bitboards one square at a
+  time in each of the 8 directions, masking off the squares that wrap
+  around an edge of the board. This finds all the moves of a side at
+  once, instead of walking each ray from each empty square.
+  */
+
+//! The directions, in the order in which the flipped discs are listed in a move
+static int dir_x [8] = { -1, -1, -1, 0, 0, 1, 1, 1};
+static int dir_y [8] = { -1, 0, 1, -1, 1, -1, 0, 1};
+
+//! The squares a shift in each direction can land on, for boards of width squares_wid
+static guint64 dir_mask [8];
+static guint64 squares = 0;
+static int squares_wid = -1, squares_heit = -1;
+
+static void othellobb_setup ()
+{
+	int x, y, d;
+	if (squares_wid == board_wid && squares_heit == board_heit)
+		return;
+	squares_wid = board_wid;
+	squares_heit = board_heit;
+	squares = 0;
+	for (x=0; x<board_wid; x++)
+		for (y=0; y<board_heit; y++)
+			squares |= OTHELLOBB_BIT (x, y);
+	for (d=0; d<8; d++)
+	{
+		dir_mask [d] = squares;
+		for (y=0; y<8; y++)
+		{
+			if (dir_x [d] > 0)
+				dir_mask [d] &= ~OTHELLOBB_BIT (0, y);
+			if (dir_x [d] < 0)
+				dir_mask [d] &= ~OTHELLOBB_BIT (7, y);
+		}
+	}
+}
+
+static guint64 shift (guint64 b, int d)
+{
+	int s = dir_y [d] * 8 + dir_x [d];
+	return (s > 0 ? b << s : b >> -s) & dir_mask [d];
+}
+
+guint64 othellobb_squares ()
+{
+	othellobb_setup ();
+	return squares;
+}
+
+void othellobb_from_board (byte *board, guint64 *white, guint64 *black)
+{
+	int x, y;
+	*white = *black = 0;
+	for (y=0; y<board_heit; y++)
+		for (x=0; x<board_wid; x++)
+		{
+			if (board [y * board_wid + x] == 1)
+				*white |= OTHELLOBB_BIT (x, y);
+			else if (board [y * board_wid + x] == 2)
+				*black |= OTHELLOBB_BIT (x, y);
+		}
+}
+
+guint64 othellobb_moves (guint64 own, guint64 opp)
+{
+	guint64 moves = 0, empty, run;
+	int d, i;
+	othellobb_setup ();
+	empty = squares & ~(own | opp);
+	for (d=0; d<8; d++)
+	{
+		run = shift (own, d) & opp;
+		for (i=0; i<5; i++)
+			run |= shift (run, d) & opp;
+		moves |= shift (run, d) & empty;
+	}
+	return moves;
+}
+
+guint64 othellobb_flips (guint64 own, guint64 opp, int x, int y)
+{
+	guint64 flips = 0, run, b;
+	int d;
+	othellobb_setup ();
+	for (d=0; d<8; d++)
+	{
+		run = 0;
+		for (b = shift (OTHELLOBB_BIT (x, y), d); b & opp; b = shift (b, d))
+			run |= b;
+		if (b & own)
+			flips |= run;
+	}
+	return flips;
+}
+
+int othellobb_count (guint64 b)
+{
+	b = b - ((b >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+	b = (b & G_GUINT64_CONSTANT(0x3333333333333333)) 
+		+ ((b >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+	b = (b + (b >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+	return (int) ((b * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56);
+}
+
+byte *othellobb_write_move (byte *movp, int x, int y, guint64 flips, int val)
+{
+	int d, i, j;
+	for (d=0; d<8; d++)
+		for (i = x + dir_x [d], j = y + dir_y [d]; 
+				i >= 0 && i < 8 && j >= 0 && j < 8 && (flips & OTHELLOBB_BIT (i, j));
+				i += dir_x [d], j += dir_y [d])
+		{
+			*movp++ = i;
+			*movp++ = j;
+			*movp++ = val;
+		}
+	*movp++ = x;
+	*movp++ = y;
+	*movp++ = val;
+	*movp++ = -1;
+	return movp;
+}
+
+int othellobb_liberty (guint64 white, guint64 black)
+{
+	guint64 empty;
+	int d, liberty = 0;
+	othellobb_setup ();
+	empty = squares & ~(white | black);
+	for (d=0; d<8; d++)
+	{
+		guint64 next = shift (empty, d);
+		liberty += othellobb_count (next & black) - othellobb_count (next & white);
+	}
+	return liberty;
+}
+
+/* The endgame solver. Scores are the final disc difference from the
+   point of view of the side to move. */
+
+#define SOLVE_INFTY 100
+
+//! Positions with fewer empty squares than this are not stored in the hash table
+#define SOLVE_HASH_MIN_EMPTIES 7
+
+//! Below this many empty squares the moves are ordered only by parity
+#define SOLVE_FASTEST_FIRST_MIN_EMPTIES 5
+
+#define SOLVE_HASH_BITS 18
+
+typedef struct
+{
+	guint64 own, opp;
+	gint8 lower, upper;
+	//! Square of the best move, or -1
+	gint8 best;
+} SolveEntry;
+
+static SolveEntry *solve_hash = NULL;
+static long solve_nodes;
+static gboolean solve_stopped;
+//! The four quadrants of the board, for parity ordering
+static guint64 solve_regions [4];
+
+extern gboolean engine_stop_search;
+extern void engine_poll ();
+
+static int bb_first (guint64 b)
+{
+	int n = 0;
+	if (!(b & G_GUINT64_CONSTANT(0xffffffff))) { n += 32; b >>= 32; }
+	if (!(b & 0xffff)) { n += 16; b >>= 16; }
+	if (!(b & 0xff)) { n += 8; b >>= 8; }
+	if (!(b & 0xf)) { n += 4; b >>= 4; }
+	if (!(b & 0x3)) { n += 2; b >>= 2; }
+	if (!(b & 0x1)) n += 1;
+	return n;
+}
+
+static SolveEntry *solve_hash_entry (guint64 own, guint64 opp)
+{
+	guint64 key = own * G_GUINT64_CONSTANT(0x9e3779b97f4a7c15) 
+		^ opp * G_GUINT64_CONSTANT(0xc2b2ae3d27d4eb4f);
+	return solve_hash + (key >> (64 - SOLVE_HASH_BITS));
+}
+
+//! Final score when neither side can move
+static int solve_final (guint64 own, guint64 opp)
+{
+	return othellobb_count (own) - othellobb_count (opp);
+}
+
+//! Sorts the moves, best first, into sq[] and returns how many there are
+static int solve_order (guint64 own, guint64 opp, guint64 moves, int empties, 
+		int hash_best, int *sq)
+{
+	int num = 0, i, score [64];
+	guint64 empty = othellobb_squares () & ~(own | opp);
+	for (; moves; moves &= moves - 1)
+	{
+		int s = bb_first (moves), r, val = 0;
+		guint64 bit = G_GUINT64_CONSTANT(1) << s;
+		for (r=0; r<4; r++)
+			if ((solve_regions [r] & bit) && (othellobb_count (solve_regions [r] & empty) & 1))
+				val += 1;
+		if (empties >= SOLVE_FASTEST_FIRST_MIN_EMPTIES)
+		{
+			guint64 flips = othellobb_flips (own, opp, s % 8, s / 8);
+			val -= 4 * othellobb_count (othellobb_moves (opp ^ flips, own | flips | bit));
+		}
+		if (s == hash_best)
+			val = 1000;
+		for (i=num; i>0 && score [i-1] < val; i--)
+		{
+			score [i] = score [i-1];
+			sq [i] = sq [i-1];
+		}
+		score [i] = val;
+		sq [i] = s;
+		num++;
+	}
+	return num;
+}
+
+static int solve (guint64 own, guint64 opp, int alpha, int beta, 
+		gboolean passed, int empties, int *best_sq)
+{
+	guint64 moves;
+	SolveEntry *entry = NULL;
+	int sq [64], num, i, best = -SOLVE_INFTY, best_move = -1, orig_alpha = alpha;
+
+	if ((++solve_nodes & 4095) == 0)
+	{
+		engine_poll ();
+		if (engine_stop_search)
+			solve_stopped = TRUE;
+	}
+	if (solve_stopped)
+		return 0;
+
+	moves = othellobb_moves (own, opp);
+	if (!moves)
+	{
+		if (passed || empties == 0)
+			return solve_final (own, opp);
+		if (best_sq)
+			*best_sq = -1;
+		return -solve (opp, own, -beta, -alpha, TRUE, empties, NULL);
+	}
+
+	if (empties >= SOLVE_HASH_MIN_EMPTIES)
+	{
+		entry = solve_hash_entry (own, opp);
+		if (entry->own == own && entry->opp == opp)
+		{
+			if (!best_sq)
+			{
+				if (entry->lower >= beta)
+					return entry->lower;
+				if (entry->upper <= alpha)
+					return entry->upper;
+				if (entry->lower == entry->upper)
+					return entry->lower;
+			}
+			best_move = entry->best;
+		}
+	}
+
+	num = solve_order (own, opp, moves, empties, best_move, sq);
+	for (i=0; i<num; i++)
+	{
+		guint64 bit = G_GUINT64_CONSTANT(1) << sq [i];
+		guint64 flips = othellobb_flips (own, opp, sq [i] % 8, sq [i] / 8);
+		int val = -solve (opp ^ flips, own | flips | bit, -beta, -alpha, 
+				FALSE, empties - 1, NULL);
+		if (solve_stopped)
+			return 0;
+		if (val > best)
+		{
+			best = val;
+			best_move = sq [i];
+			if (val > alpha)
+				alpha = val;
+			if (alpha >= beta)
+				break;
+		}
+	}
+
+	if (entry)
+	{
+		entry->own = own;
+		entry->opp = opp;
+		entry->lower = best > orig_alpha ? best : -SOLVE_INFTY;
+		entry->upper = best < beta ? best : SOLVE_INFTY;
+		entry->best = best_move;
+	}
+	if (best_sq)
+		*best_sq = best_move;
+	return best;
+}
+
+int othellobb_solve (guint64 own, guint64 opp, int *best_sq, long *nodes)
+{
+	int r, x, y, val;
+	guint64 empty;
+	othellobb_setup ();
+	if (!solve_hash)
+	{
+		solve_hash = (SolveEntry *) malloc ((1 << SOLVE_HASH_BITS) * sizeof (SolveEntry));
+		assert (solve_hash);
+	}
+	memset (solve_hash, 0, (1 << SOLVE_HASH_BITS) * sizeof (SolveEntry));
+	for (r=0; r<4; r++)
+	{
+		solve_regions [r] = 0;
+		for (x=0; x<board_wid; x++)
+			for (y=0; y<board_heit; y++)
+				if ((x < board_wid / 2) == (r & 1) && (y < board_heit / 2) == (r >> 1))
+					solve_regions [r] |= OTHELLOBB_BIT (x, y);
+	}
+	empty = squares & ~(own | opp);
+	solve_nodes = 0;
+	solve_stopped = FALSE;
+	*best_sq = -1;
+	val = solve (own, opp, -SOLVE_INFTY, SOLVE_INFTY, FALSE, othellobb_count (empty), best_sq);
+	if (nodes)
+		*nodes = solve_nodes;
+	return solve_stopped ? -SOLVE_INFTY : val;
+}
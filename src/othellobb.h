@@ -0,0 +1,64 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _OTHELLOBB_H_
+#define _OTHELLOBB_H_
+
+#include "game.h"
+
+/** \file othellobb.h
+  \brief Bitboards for Othello and Othello 6x6.
+
+  Square (x, y) is bit y * 8 + x, whatever the size of the board, so on
+  the 6x6 board the last two files and ranks are never set. The size is
+  taken from board_wid and board_heit.
+  */
+
+#define OTHELLOBB_BIT(x, y) (G_GUINT64_CONSTANT(1) << ((y) * 8 + (x)))
+
+//! Makes bitboards of the white and the black discs of a board in the format of Pos::board
+void othellobb_from_board (byte *board, guint64 *white, guint64 *black);
+
+//! The squares of the current board
+guint64 othellobb_squares ();
+
+//! The squares where a disc of own would flip some discs of opp
+guint64 othellobb_moves (guint64 own, guint64 opp);
+
+//! The discs of opp that a disc of own placed at (x, y) would flip
+guint64 othellobb_flips (guint64 own, guint64 opp, int x, int y);
+
+//! Number of bits set
+int othellobb_count (guint64 b);
+
+//! Writes the movelets for placing a disc of value val at (x, y), flipping flips, and a -1
+/** The flipped discs are listed direction by direction, nearest
+  first, followed by the new disc. Returns a pointer past the -1. */
+byte *othellobb_write_move (byte *movp, int x, int y, guint64 flips, int val);
+
+//! Sum over the discs of the number of empty squares next to them, negative for the white discs
+int othellobb_liberty (guint64 white, guint64 black);
+
+//! Finds the exact final disc difference for own to move, by searching to the end of the game
+/** The best move is stored in best_sq as y * 8 + x, or -1 if own has 
+  to pass, and the number of positions searched in nodes if it is not
+  NULL. The search is stopped, with a result of less than -64, if
+  engine_stop_search gets set. */
+int othellobb_solve (guint64 own, guint64 opp, int *best_sq, long *nodes);
+
+#endif
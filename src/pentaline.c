@@ -27,6 +27,7 @@
 
 #include "game.h"
 #include "aaball.h"
+#include "engine.h"
 
 #define PENTALINE_CELL_SIZE 40
 #define PENTALINE_NUM_PIECES 2
@@ -52,10 +53,10 @@ static int pentaline_getmove (Pos *, int, int, GtkboardEventType, Player, byte *
 static ResultType pentaline_who_won (Pos *, Player , char **);
 static void pentaline_set_init_pos (Pos *pos);
 unsigned char * pentaline_get_rgbmap (int idx, int color);
-ResultType pentaline_eval_incr (Pos *, Player, byte *, float *);
 byte * pentaline_movegen (Pos *);
 ResultType pentaline_eval (Pos *, Player, float *);
 void *pentaline_newstate (Pos *pos, byte *move);
+static int pentaline_solve (Pos *, byte *, float *, int *);
 
 typedef struct 
 {
@@ -72,12 +73,12 @@ void pentaline_init ()
 	game_who_won = pentaline_who_won;
 	game_get_rgbmap = pentaline_get_rgbmap;
 	game_draw_cell_boundaries = TRUE;
-//	game_eval_incr = pentaline_eval_incr;
 	game_white_string = "Red";
 	game_black_string = "Blue";
 	game_stateful = TRUE;
 	game_state_size = sizeof (Pentaline_state);
 	game_newstate = pentaline_newstate;
+	game_solve = pentaline_solve;
 	game_allow_flip = TRUE;
 	game_doc_about_status = STATUS_COMPLETE;
 	game_doc_about = 
@@ -90,65 +91,414 @@ void pentaline_init ()
 		"This game is the same as the free-style variant of GoMoku.\n";
 }
 
-byte * pentaline_movegen (Pos *pos)
+static int incx[4] = { 0, 1, 1, -1 };
+static int incy[4] = { 1, 0, 1,  1 };
+
+/* Threats. A four is a move after which the player can make five with
+   the next move, and a three is a move after which they can make an open
+   four, that is, a four that can be completed in two ways. */
+
+//! Number of squares on the four lines through a square, within 4 of it
+#define LINE_SQUARES 32
+
+#define THREAT_MAX 64
+
+//! Max number of fours in a victory by continuous fours
+#define PENTALINE_VCF_DEPTH 20
+
+//! Max number of threes and fours in a victory by continuous threats
+#define PENTALINE_VCT_DEPTH 3
+
+//! The threat space search gives up after this many positions
+#define PENTALINE_TSS_MAX_NODES 300000
+
+extern gboolean engine_stop_search;
+
+/** While near_valid is set, near_count[c][e] is the largest number of stones of
+  colour c + 1 on one line through e within 4 squares of it, so that the
+  movegen doesn't have to look at the lines again for every test. Only
+  stones of the other colour may be put on the board meanwhile. */
+static byte near_count [2][PENTALINE_BOARD_WID * PENTALINE_BOARD_HEIT];
+static gboolean near_valid = FALSE;
+
+static void near_compute (byte *board)
 {
-	int i, j, k, l, x, y;
-	byte movbuf [1024];
-	byte *movlist, *movp = movbuf;
-	int val, found = 0;
-	int incx[4] = { 0, 1, 1, -1};
-	int incy[4] = { 1, 0, 1,  1};
-	int nbrx[] = { -1, -1, -1, 0, 0, 1, 1, 1};
-	int nbry[] = { -1, 0, 1, -1, 1, -1, 0, 1};
-	byte *board = pos->board;
-	Player player = pos->player;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
+	int e, i, k, x, y, c;
+	byte count [4][2][PENTALINE_BOARD_WID * PENTALINE_BOARD_HEIT];
+	memset (count, 0, sizeof (count));
+	for (e=0; e<board_wid * board_heit; e++)
 	{
-		if (board [j * board_heit + i] == PENTALINE_EMPTY)
+		if (board [e] == PENTALINE_EMPTY)
 			continue;
 		for (k=0; k<4; k++)
+		for (i=-4; i<=4; i++)
 		{
-			int found = 1, val;
-			for (l=0; l<5; l++)
+			x = e % board_wid + i * incx[k];
+			y = e / board_wid + i * incy[k];
+			if (i != 0 && ISINBOARD (x, y))
+				count [k][board [e] - 1][y * board_wid + x]++;
+		}
+	}
+	for (c=0; c<2; c++)
+	for (e=0; e<board_wid * board_heit; e++)
+	{
+		near_count [c][e] = 0;
+		for (k=0; k<4; k++)
+			if (count [k][c][e] > near_count [c][e])
+				near_count [c][e] = count [k][c][e];
+	}
+	near_valid = TRUE;
+}
+
+//! Would val at (x, y) make five or more in a row in the direction k?
+static gboolean five_in_dir (byte *board, int x, int y, int k, int val)
+{
+	int i, len = 1;
+	for (i=1; i<5 && ISINBOARD (x + i * incx[k], y + i * incy[k])
+			&& board [(y + i * incy[k]) * board_wid + x + i * incx[k]] == val; i++)
+		len++;
+	for (i=1; i<5 && ISINBOARD (x - i * incx[k], y - i * incy[k])
+			&& board [(y - i * incy[k]) * board_wid + x - i * incx[k]] == val; i++)
+		len++;
+	return len >= 5;
+}
+
+//! Does some line through (x, y) have at least min stones of val within 4 squares?
+/** A cheap test before looking for fours (min = 3) and threes (min = 2) */
+static gboolean near_stones (byte *board, int x, int y, int val, int min)
+{
+	int i, k, count;
+	if (near_valid)
+		return near_count [val - 1][y * board_wid + x] >= min;
+	for (k=0; k<4; k++)
+	{
+		for (i=-4, count=0; i<=4; i++)
+			if (i != 0 && ISINBOARD (x + i * incx[k], y + i * incy[k])
+					&& board [(y + i * incy[k]) * board_wid + x + i * incx[k]] == val)
+				count++;
+		if (count >= min)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+//! The empty squares on the lines through (x, y) where val would make five
+/** Returns how many there are, storing them in sq, which must have room for LINE_SQUARES. */
+static int five_squares (byte *board, int x, int y, int val, int *sq)
+{
+	int i, k, n = 0;
+	for (k=0; k<4; k++)
+	for (i=-4; i<=4; i++)
+	{
+		int ex = x + i * incx[k], ey = y + i * incy[k];
+		if (i == 0 || !ISINBOARD (ex, ey) || board [ey * board_wid + ex] != PENTALINE_EMPTY)
+			continue;
+		if (five_in_dir (board, ex, ey, k, val))
+			sq [n++] = ey * board_wid + ex;
+	}
+	return n;
+}
+
+//! The squares anywhere on the board where val would make five; stores at most max of them
+static int all_five_squares (byte *board, int val, int *sq, int max)
+{
+	int e, k, n = 0;
+	for (e=0; e<board_wid * board_heit && n < max; e++)
+	{
+		if (board [e] != PENTALINE_EMPTY 
+				|| !near_stones (board, e % board_wid, e / board_wid, val, 4))
+			continue;
+		for (k=0; k<4; k++)
+			if (five_in_dir (board, e % board_wid, e / board_wid, k, val))
 			{
-				if (j + l * incy[k] >= board_heit || i + l * incx[k] >= board_wid)
-				{ found = 0; break; }
-				val = board [(j + l * incy[k]) * board_wid + i + l * incx[k]];
-				if (val == PENTALINE_EMPTY) {found = 0; break;}
-				if (val != board [j * board_wid + i]) { found = 0; break; }
+				sq [n++] = e;
+				break;
 			}
-			if (found) { break; }
+	}
+	return n;
+}
+
+//! How many ways val at the empty square e would have to make five after that
+static int count_fours (byte *board, int e, int val)
+{
+	int n, sq [LINE_SQUARES];
+	if (!near_stones (board, e % board_wid, e / board_wid, val, 3))
+		return 0;
+	board [e] = val;
+	n = five_squares (board, e % board_wid, e / board_wid, val, sq);
+	board [e] = PENTALINE_EMPTY;
+	return n;
+}
+
+//! The squares where val would make an open four or two fours
+static int four_threats (byte *board, int val, int *sq, int max)
+{
+	int e, n = 0;
+	for (e=0; e<board_wid * board_heit && n < max; e++)
+		if (board [e] == PENTALINE_EMPTY && count_fours (board, e, val) >= 2)
+			sq [n++] = e;
+	return n;
+}
+
+//! Can val make a four anywhere?
+static gboolean has_four (byte *board, int val)
+{
+	int e;
+	for (e=0; e<board_wid * board_heit; e++)
+		if (board [e] == PENTALINE_EMPTY && count_fours (board, e, val) >= 1)
+			return TRUE;
+	return FALSE;
+}
+
+//! Does the other side at d stop all the threats (found by four_threats()) of val?
+static gboolean stops_threats (byte *board, int d, int val, int *threats, int nthreats)
+{
+	int i;
+	gboolean stopped = TRUE;
+	board [d] = val == PENTALINE_RP ? PENTALINE_BP : PENTALINE_RP;
+	for (i=0; i<nthreats && stopped; i++)
+		if (threats [i] != d && count_fours (board, threats [i], val) >= 2)
+			stopped = FALSE;
+	board [d] = PENTALINE_EMPTY;
+	return stopped;
+}
+
+static long tss_nodes;
+static gboolean tss_stopped;
+
+static gboolean tss_poll ()
+{
+	if ((++tss_nodes & 1023) == 0)
+		engine_poll ();
+	if (engine_stop_search || tss_nodes > PENTALINE_TSS_MAX_NODES)
+		tss_stopped = TRUE;
+	return tss_stopped;
+}
+
+//! Victory by continuous fours for att, to move
+/** Returns the number of ply to win, or 0 if there is no such win. The
+  first move is stored in move. */
+static int vcf (byte *board, int att, int def, int depth, int *move)
+{
+	int e, n, r, ndef, defsq [2], gains [LINE_SQUARES];
+	if (tss_poll ())
+		return 0;
+	if (all_five_squares (board, att, defsq, 1))
+	{
+		*move = defsq [0];
+		return 1;
+	}
+	ndef = all_five_squares (board, def, defsq, 2);
+	if (ndef >= 2 || depth == 0)
+		return 0;
+	for (e=0; e<board_wid * board_heit; e++)
+	{
+		// if the defender has a four we have to block it
+		if (board [e] != PENTALINE_EMPTY || (ndef == 1 && e != defsq [0]))
+			continue;
+		if (!near_stones (board, e % board_wid, e / board_wid, att, 3))
+			continue;
+		board [e] = att;
+		n = five_squares (board, e % board_wid, e / board_wid, att, gains);
+		r = 0;
+		if (n >= 2)
+			r = 1;
+		else if (n == 1)
+		{
+			int dummy;
+			board [gains [0]] = def;
+			r = vcf (board, att, def, depth - 1, &dummy);
+			board [gains [0]] = PENTALINE_EMPTY;
+		}
+		board [e] = PENTALINE_EMPTY;
+		if (r)
+		{
+			*move = e;
+			return r + 2;
 		}
+		if (tss_stopped)
+			return 0;
 	}
-	if (!found)
+	return 0;
+}
+
+//! Victory by continuous threats (threes and fours) for att, to move
+/** Like vcf(). Only the defences next to the threats are tried, and a
+  three is given up on if the defender has a four to reply with, so
+  this misses some wins but shouldn't claim false ones. */
+static int vct (byte *board, int att, int def, int depth, int *move)
+{
+	int e, d, i, k, r, dist, dummy, nthreats, threats [THREAT_MAX];
+	byte tried [PENTALINE_BOARD_WID * PENTALINE_BOARD_HEIT];
+	r = vcf (board, att, def, PENTALINE_VCF_DEPTH, move);
+	if (r || depth == 0 || tss_stopped)
+		return r;
+	if (all_five_squares (board, def, &dummy, 1))
+		return 0;
+	for (e=0; e<board_wid * board_heit; e++)
 	{
-		for (i=0; i<board_wid; i++)
-		for (j=0; j<board_heit; j++)
+		int worst = 0;
+		gboolean refuted = FALSE;
+		if (board [e] != PENTALINE_EMPTY 
+				|| !near_stones (board, e % board_wid, e / board_wid, att, 2))
+			continue;
+		board [e] = att;
+		nthreats = four_threats (board, att, threats, THREAT_MAX);
+		if (nthreats == 0 || has_four (board, def)
+				|| vcf (board, def, att, PENTALINE_VCF_DEPTH, &dummy))
 		{
-			if (board[j * board_wid + i] != PENTALINE_EMPTY) continue;
-			for (k=0; k<8; k++)
-			{
-				x = i + nbrx[k];
-				y = j + nbry[k];
-				if (x >= 0 && y >= 0 && x < board_wid && y < board_heit 
-						&& board [y * board_wid + x] != PENTALINE_EMPTY)
-				{
-					*movp++ = i;
-					*movp++ = j;
-					*movp++ = (player == WHITE ? PENTALINE_RP : PENTALINE_BP);
-					*movp++ = -1;
-				}
-			}
+			board [e] = PENTALINE_EMPTY;
+			if (tss_stopped)
+				return 0;
+			continue;
+		}
+		// a defence must be on a line through every threat, within 4 of it
+		memset (tried, 0, board_wid * board_heit);
+		for (i=0; i<nthreats && !refuted; i++)
+		for (k=0; k<4 && !refuted; k++)
+		for (dist=-4; dist<=4 && !refuted; dist++)
+		{
+			int x = threats [i] % board_wid + dist * incx[k];
+			int y = threats [i] / board_wid + dist * incy[k];
+			if (!ISINBOARD (x, y))
+				continue;
+			d = y * board_wid + x;
+			if (board [d] != PENTALINE_EMPTY || tried [d])
+				continue;
+			tried [d] = 1;
+			if (!stops_threats (board, d, att, threats, nthreats))
+				continue;
+			board [d] = def;
+			r = vct (board, att, def, depth - 1, &dummy);
+			board [d] = PENTALINE_EMPTY;
+			if (!r)
+				refuted = TRUE;
+			else if (r > worst)
+				worst = r;
+		}
+		board [e] = PENTALINE_EMPTY;
+		if (tss_stopped)
+			return 0;
+		if (!refuted)
+		{
+			*move = e;
+			return worst + 2;
 		}
 	}
-	if (movp == movbuf) // empty board
+	return 0;
+}
+
+//! Looks for a forced win for the side to move with the threat space search
+static int pentaline_solve (Pos *pos, byte *best_move, float *eval, int *nodes)
+{
+	byte board [PENTALINE_BOARD_WID * PENTALINE_BOARD_HEIT];
+	int att = pos->player == WHITE ? PENTALINE_RP : PENTALINE_BP;
+	int def = pos->player == WHITE ? PENTALINE_BP : PENTALINE_RP;
+	int sq, plies;
+	memcpy (board, pos->board, board_wid * board_heit);
+	tss_nodes = 0;
+	tss_stopped = FALSE;
+	plies = vct (board, att, def, PENTALINE_VCT_DEPTH, &sq);
+	*nodes = tss_nodes;
+	if (!plies || tss_stopped)
+		return 0;
+	best_move [0] = sq % board_wid;
+	best_move [1] = sq / board_wid;
+	best_move [2] = att;
+	best_move [3] = -1;
+	*eval = pos->player == WHITE ? GAME_EVAL_INFTY : -GAME_EVAL_INFTY;
+	return plies;
+}
+
+//! The colour that has made five in a row, or PENTALINE_EMPTY
+/** This is a lookup in the chain counts kept by pentaline_newstate(); 
+  the board is scanned only if there is no state yet. */
+static int pentaline_five (Pos *pos)
+{
+	int e, k;
+	Pentaline_state *state = (Pentaline_state *) pos->state;
+	if (state)
+		return state->chains[4][0][0] > 0 ? PENTALINE_RP
+			: state->chains[4][0][1] > 0 ? PENTALINE_BP : PENTALINE_EMPTY;
+	for (e=0; e<board_wid * board_heit; e++)
+		if (pos->board [e] != PENTALINE_EMPTY)
+			for (k=0; k<4; k++)
+				if (five_in_dir (pos->board, e % board_wid, e / board_wid, k, pos->board [e]))
+					return pos->board [e];
+	return PENTALINE_EMPTY;
+}
+
+static byte *pentaline_write_move (byte *movp, int e, int val)
+{
+	*movp++ = e % board_wid;
+	*movp++ = e / board_wid;
+	*movp++ = val;
+	*movp++ = -1;
+	return movp;
+}
+
+//! The empty squares next to some stone, pruned by the threats on the board
+/** If we can make five we do; if the opponent can, we block; if the
+  opponent has a three we either stop it or make a four. Fours come first. */
+byte * pentaline_movegen (Pos *pos)
+{
+	int i, k, e, n, pass;
+	byte movbuf [1024];
+	byte *movlist, *movp = movbuf;
+	int nbrx[] = { -1, -1, -1, 0, 0, 1, 1, 1};
+	int nbry[] = { -1, 0, 1, -1, 1, -1, 0, 1};
+	byte *board = pos->board;
+	int our = pos->player == WHITE ? PENTALINE_RP : PENTALINE_BP;
+	int their = pos->player == WHITE ? PENTALINE_BP : PENTALINE_RP;
+	int sq [LINE_SQUARES], threats [THREAT_MAX], nthreats = 0;
+
+	near_compute (board);
+	if (pentaline_five (pos) != PENTALINE_EMPTY)
+		;
+	else if (all_five_squares (board, our, sq, 1))
+		movp = pentaline_write_move (movp, sq [0], our);
+	else if ((n = all_five_squares (board, their, sq, LINE_SQUARES)) > 0)
+		for (i=0; i<n; i++)
+			movp = pentaline_write_move (movp, sq [i], our);
+	else
 	{
-		*movp++ = board_wid / 2 - random() % 2;
-		*movp++ = board_heit / 2 - random() % 2;
-		*movp++ = (player == WHITE ? PENTALINE_RP : PENTALINE_BP);
-		*movp++ = -1;
+		nthreats = four_threats (board, their, threats, THREAT_MAX);
+		for (pass = 0; pass < 4; pass++)
+		{
+			// if we can't stop the threats, any move will do
+			if (pass == 2 && movp != movbuf)
+				break;
+			for (e=0; e<board_wid * board_heit; e++)
+			{
+				int x = e % board_wid, y = e / board_wid, four;
+				if (board [e] != PENTALINE_EMPTY)
+					continue;
+				for (k=0; k<8; k++)
+					if (ISINBOARD (x + nbrx[k], y + nbry[k]) 
+							&& board [(y + nbry[k]) * board_wid + x + nbrx[k]] != PENTALINE_EMPTY)
+						break;
+				if (k == 8)
+					continue;
+				four = count_fours (board, e, our) > 0;
+				if (four != (pass % 2 == 0))
+					continue;
+				if (pass < 2 && nthreats && !four 
+						&& !stops_threats (board, e, their, threats, nthreats))
+					continue;
+				movp = pentaline_write_move (movp, e, our);
+			}
+		}
+		for (e=0; e<board_wid * board_heit && board [e] == PENTALINE_EMPTY; e++)
+			;
+		if (e == board_wid * board_heit) // empty board
+		{
+			*movp++ = board_wid / 2 - random() % 2;
+			*movp++ = board_heit / 2 - random() % 2;
+			*movp++ = our;
+			*movp++ = -1;
+		}
 	}
+	near_valid = FALSE;
 	*movp++ = -2;
 	movlist = (byte *) (malloc (movp - movbuf));
 	memcpy (movlist, movbuf, (movp - movbuf));
@@ -157,44 +507,16 @@ byte * pentaline_movegen (Pos *pos)
 
 ResultType pentaline_who_won (Pos *pos, Player to_play, char **commp)
 {
-	int i, j, k, l;
-	int incx[4] = { 0, 1, 1, -1};
-	int incy[4] = { 1, 0, 1,  1};
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	for (k=0; k<4; k++)
+	switch (pentaline_five (pos))
 	{
-		int found = 1, val;
-		for (l=0; l<5; l++)
-		{
-			if (j + l * incy[k] >= board_heit || i + l * incx[k] >= board_wid)
-			{ found = 0; break; }
-			val = pos->board [(j + l * incy[k]) * board_wid + i + l * incx[k]];
-			if (val == PENTALINE_EMPTY) {found = 0; break; }
-			if (val != pos->board [j * board_wid + i]) { found = 0; break; }
-		}
-		if (found) {*commp = (to_play == WHITE ? "Blue won" : "Red won");
-			return (to_play == WHITE ? RESULT_BLACK : RESULT_WHITE);}
+		case PENTALINE_RP:
+			*commp = "Red won";
+			return RESULT_WHITE;
+		case PENTALINE_BP:
+			*commp = "Blue won";
+			return RESULT_BLACK;
 	}
 	*commp = NULL;
-/*	{
-		int len, open, color;
-		for (color = 0; color < 2 && pos->state; color++)
-		{
-			printf ("player = %s:   ", color==0?"Red ":"Blue");
-			for (open = 0; open < 2; open++)
-			{
-				printf ("open=%d: ", open+1);
-				for (len = 0; len < 5; len++)
-				printf ("%d ", 
-						((Pentaline_state *)pos->state)->chains[len][open][color]);
-				printf ("\t");
-			}
-			printf ("\n");
-		}
-		printf ("\n");
-	}
-*/
 	return RESULT_NOTYET;
 }
 
@@ -229,81 +551,6 @@ unsigned char * pentaline_get_rgbmap (int idx, int color)
 	return rgbbuf;
 }
 
-static float eval_line (byte *board, int x, int y, int incx, int incy)
-{
-	int open = 0;
-	int newx, newy;
-	int len, val, sgn;
-	newx = x - incx, newy = y - incy;
-	val = board [y * board_wid + x];
-	if (val == PENTALINE_EMPTY) return 0;
-	sgn = (val == PENTALINE_RP ? 1 : -1);
-	if (newx >= 0 && newy >= 0 && newx < board_wid && newy < board_heit)
-	{
-		if(board [newy * board_wid + newx] == val)
-			return 0;
-		if(board [newy * board_wid + newx] == PENTALINE_EMPTY)
-			open = 1;
-	}
-	for (len = 0; ; x+= incx, y+=incy, len++)
-	{
-		if (x < 0 || y < 0 || x >= board_wid || y >= board_heit) break;
-		if (board [y * board_wid + x] != val) break;
-	}	
-	if (!(x < 0 || y < 0 || x >= board_wid || y >= board_heit)
-			&& board [y * board_wid + x] == PENTALINE_EMPTY) 
-		open++;
-	if (len >= 5) return GAME_EVAL_INFTY * sgn;
-	return open * open * (1 << len) * sgn;
-}
-
-static float eval_line_bidir (byte *board, int x, int y, int incx, int incy)
-{
-	int val = board[y * board_wid + x];
-	do
-	{
-		x -= incx;
-		y -= incy;
-	}
-	while (x >= 0 && y >= 0 && x < board_wid && y < board_heit 
-			&& board [y * board_wid + x] == val);
-	x += incx;
-	y += incy;
-	return eval_line (board, x, y, incx, incy);
-}
-
-static float eval_runs (byte *board)
-{
-	int i, j, k;
-	int incx[4] = { 0, 1, 1, -1 };
-	int incy[4] = { 1, 0, 1,  1 };
-	float eval = 0;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	{
-		if (board [j * board_wid + i] == PENTALINE_EMPTY)
-			continue;
-		for (k=0; k<4; k++)
-			eval += eval_line (board, i, j, incx[k], incy[k]);
-	}
-	return eval;
-}
-
-static int incx[4] = { 0, 1, 1, -1 };
-static int incy[4] = { 1, 0, 1,  1 };
-
-ResultType pentaline_eval_incr (Pos *pos, Player to_play, byte *move, float *eval)
-{
-	int  k;
-	float val = 0;
-	pos->board [move[1] * board_wid + move[0]] = move[2];
-	for (k=0; k<4; k++)
-		val += eval_line_bidir (pos->board, move[0], move[1], incx[k], incy[k]);
-	pos->board [move[1] * board_wid + move[0]] = 0;
-	*eval = val;
-	return RESULT_NOTYET;
-}
-
 ResultType pentaline_eval (Pos *pos, Player player, float *eval)
 {
 #define FIRST_WON { *eval = player == WHITE ? (1 << 20) : - (1 << 20); return player == WHITE ? RESULT_WHITE : RESULT_BLACK; }
@@ -0,0 +1,207 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "game.h"
+#include "move.h"
+#include "engine.h"
+#include "stack.h"
+#include "perft.h"
+
+/** \file perft.c
+  \brief Counting the nodes of the game tree, to test and time the movegens.
+  */
+
+extern Pos cur_pos;
+extern gboolean engine_flag;
+
+extern gboolean chess_fen_read (char *fen, byte *board, Player *player, void *state);
+
+//! Known counts from a position of a game
+typedef struct
+{
+	char *game;
+	//! The position as a FEN for Chess, or NULL for the initial position
+	char *fen;
+	//! counts[i] is the count at depth i+1; terminated by 0
+	long counts[10];
+} PerftCounts;
+
+static PerftCounts perft_known[] = 
+{
+	{ "Chess", NULL, { 20, 400, 8902, 197281, 4865609, 0 } },
+	// "Kiwipete": castling, en passant and promotions, all in the first few ply
+	{ "Chess", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		{ 48, 2039, 97862, 4085603, 0 } },
+	{ "Chess", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -", 
+		{ 14, 191, 2812, 43238, 674624, 0 } },
+	{ "Chess", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq -", 
+		{ 6, 264, 9467, 422333, 0 } },
+	{ "Chess", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ -", 
+		{ 44, 1486, 62379, 2103487, 0 } },
+	{ "Othello", NULL, { 4, 12, 56, 244, 1396, 8200, 55092, 390216, 0 } },
+	{ "Othello 6x6", NULL, { 4, 12, 56, 244, 1364, 7604, 47740, 308716, 0 } },
+	{ "Checkers", NULL, { 7, 49, 302, 1469, 7361, 36768, 0 } },
+	{ "Ataxx", NULL, { 16, 256, 6460, 155888, 4752668, 0 } },
+	{ NULL, NULL, { 0 } }
+};
+
+//! Sets up cur_pos from a FEN, see chess_fen_read()
+static gboolean perft_set_fen (char *fen)
+{
+	void *state = malloc (game_state_size);
+	Player player;
+	assert (state);
+	if (!chess_fen_read (fen, cur_pos.board, &player, state))
+	{
+		free (state);
+		return FALSE;
+	}
+	stack_free ();
+	statestack_push (state);
+	free (state);
+	cur_pos.state = statestack_peek ();
+	cur_pos.player = player;
+	return TRUE;
+}
+
+long perft (Pos *pos, int depth)
+{
+	byte *movlist, *move;
+	Pos newpos;
+	long count = 0;
+	if (depth == 0)
+		return 1;
+	movlist = game_movegen (pos);
+	newpos.game = pos->game;
+	newpos.render = NULL;
+	newpos.ui_state = NULL;
+	newpos.search_depth = pos->search_depth + 1;
+	newpos.num_moves = pos->num_moves + 1;
+	newpos.player = pos->player == WHITE ? BLACK : WHITE;
+	newpos.board = (byte *) malloc (board_wid * board_heit);
+	newpos.state = game_stateful ? malloc (game_state_size) : NULL;
+	assert (newpos.board && (newpos.state || !game_stateful));
+	for (move = movlist; move[0] != -2; move = movlist_next (move))
+	{
+		if (depth == 1)
+		{
+			count++;
+			continue;
+		}
+		memcpy (newpos.board, pos->board, board_wid * board_heit);
+		if (game_stateful)
+			memcpy (newpos.state, game_newstate (pos, move), game_state_size);
+		move_apply (newpos.board, move);
+		count += perft (&newpos, depth - 1);
+	}
+	free (newpos.board);
+	free (newpos.state);
+	free (movlist);
+	return count;
+}
+
+//! perft() broken down by the first move
+static long perft_divide (Pos *pos, int depth, FILE *fout)
+{
+	byte *movlist, *move;
+	Pos newpos = *pos;
+	long count, total = 0;
+	movlist = game_movegen (pos);
+	newpos.num_moves++;
+	newpos.player = pos->player == WHITE ? BLACK : WHITE;
+	newpos.board = (byte *) malloc (board_wid * board_heit);
+	newpos.state = game_stateful ? malloc (game_state_size) : NULL;
+	assert (newpos.board && (newpos.state || !game_stateful));
+	for (move = movlist; move[0] != -2; move = movlist_next (move))
+	{
+		memcpy (newpos.board, pos->board, board_wid * board_heit);
+		if (game_stateful)
+			memcpy (newpos.state, game_newstate (pos, move), game_state_size);
+		move_apply (newpos.board, move);
+		count = perft (&newpos, depth - 1);
+		total += count;
+		engine_write_move_token (move, fout);
+		fprintf (fout, " %ld\n", count);
+	}
+	free (newpos.board);
+	free (newpos.state);
+	free (movlist);
+	return total;
+}
+
+void perft_run (int depth, gboolean divide, FILE *fout)
+{
+	int d;
+	GTimer *timer = g_timer_new ();
+	gulong micro_sec;
+	for (d=1; d<=depth; d++)
+	{
+		long count;
+		double secs;
+		g_timer_start (timer);
+		if (divide && d == depth)
+			count = perft_divide (&cur_pos, d, fout);
+		else
+			count = perft (&cur_pos, d);
+		secs = g_timer_elapsed (timer, &micro_sec);
+		fprintf (fout, "perft %d %ld  time %d  nps %.0f\n", d, count, (int) (secs * 1000),
+				secs > 0 ? count / secs : 0);
+		fflush (fout);
+	}
+	g_timer_destroy (timer);
+}
+
+int perft_check (Game *game, int depth)
+{
+	PerftCounts *known;
+	int d, mismatches = 0;
+	engine_flag = TRUE;
+	for (known = perft_known; known->game; known++)
+	{
+		if (game && strcmp (game->name, known->game))
+			continue;
+		engine_set_game (engine_find_game (known->game));
+		engine_reset_game ();
+		if (known->fen && !perft_set_fen (known->fen))
+		{
+			printf ("%-16s bad position %s\n", known->game, known->fen);
+			mismatches++;
+			continue;
+		}
+		if (known->fen)
+			printf ("%-16s %s\n", known->game, known->fen);
+		for (d=1; known->counts[d-1] && (depth <= 0 || d <= depth); d++)
+		{
+			long count = perft (&cur_pos, d);
+			printf ("%-16s perft %d %12ld  %s\n", known->game, d, count,
+					count == known->counts[d-1] ? "ok" : "MISMATCH");
+			if (count != known->counts[d-1])
+			{
+				printf ("%-16s expected %ld\n", known->game, known->counts[d-1]);
+				mismatches++;
+			}
+			fflush (stdout);
+		}
+	}
+	return mismatches;
+}
@@ -0,0 +1,41 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _PERFT_H_
+#define _PERFT_H_
+
+#include <stdio.h>
+#include "game.h"
+
+//! Counts the positions at depth ply from pos, using only the movegen
+/** Moves are made with move_apply() and game_newstate(). Positions 
+  where game_movegen() returns no moves are not counted. */
+long perft (Pos *pos, int depth);
+
+//! Writes perft counts and timings for depths 1 to depth from cur_pos
+/** If divide is TRUE, the count at the last depth is also broken 
+  down by the first move. */
+void perft_run (int depth, gboolean divide, FILE *fout);
+
+//! Checks the perft counts of the initial positions, and of some harder Chess positions, against the known values
+/** Only the positions of game are checked if game is not NULL; if depth 
+  is positive no deeper counts are checked. Returns the number of 
+  mismatches. */
+int perft_check (Game *game, int depth);
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "game.h"
 #include "aaball.h"
+#include "plot4bb.h"
 
 #define PLOT4_CELL_SIZE 55
 #define PLOT4_NUM_PIECES 3
@@ -58,6 +59,7 @@ static void plot4_set_init_pos (Pos *pos);
 static char ** plot4_get_pixmap (int, int);
 static byte * plot4_movegen (Pos *);
 static ResultType plot4_eval (Pos *, Player, float *);
+static int plot4_solve (Pos *, byte *, float *, int *);
 
 
 static const int RUN_WT = 20;
@@ -69,6 +71,8 @@ void plot4_init ()
 	game_movegen = plot4_movegen;
 	game_getmove = plot4_getmove;
 	game_who_won = plot4_who_won;
+	game_solve = plot4_solve;
+	game_solve_moves = 18;
 	game_set_init_pos = plot4_set_init_pos;
 	game_get_pixmap = plot4_get_pixmap;
 	game_white_string = "Green";
@@ -94,16 +98,17 @@ ResultType plot4_who_won (Pos *pos, Player to_play, char **commp)
 {
 	static char comment[32];
 	char *who_str [3] = { "Green won", "Yellow won", "Its a tie" };
-	int i, wscore, bscore, who_idx;
-	wscore = eval_runs (pos, WHITE) / RUN_WT;
-	bscore = eval_runs (pos, BLACK) / RUN_WT * -1;
+	int wscore, bscore, who_idx;
+	guint64 white, black;
+	plot4bb_from_board (pos->board, &white, &black);
+	wscore = plot4bb_lines (white);
+	bscore = plot4bb_lines (black);
 	*commp = comment;
-	for (i=0; i<board_wid * board_heit; i++)
-		if (pos->board[i] == PLOT4_EMPTY) 
-		{
-			snprintf (comment, 32, "%d : %d", wscore, bscore);
-			return RESULT_NOTYET;
-		}
+	if ((white | black) != plot4bb_squares ())
+	{
+		snprintf (comment, 32, "%d : %d", wscore, bscore);
+		return RESULT_NOTYET;
+	}
 	if (wscore > bscore) who_idx = 0;
 	else if (wscore < bscore) who_idx = 1;
 	else who_idx = 2;
@@ -115,6 +120,36 @@ ResultType plot4_who_won (Pos *pos, Player to_play, char **commp)
 	return RESULT_TIE;
 }
 
+//! Plays the last game_solve_moves empty squares perfectly
+static int plot4_solve (Pos *pos, byte *best_move, float *eval, int *nodes)
+{
+	guint64 white, black, own, opp;
+	int empties, val, x, y;
+	long solve_nodes;
+	plot4bb_from_board (pos->board, &white, &black);
+	empties = board_wid * board_heit - plot4bb_count (white | black);
+	if (empties > game_solve_moves || empties == 0)
+		return 0;
+	own = pos->player == WHITE ? white : black;
+	opp = pos->player == WHITE ? black : white;
+	val = plot4bb_solve (own, opp, &x, &solve_nodes);
+	*nodes = solve_nodes;
+	if (val < -69)
+		return 0;
+	assert (x >= 0);
+	for (y = 0; y < board_heit; y++)
+		if (pos->board [y * board_wid + x] == PLOT4_EMPTY)
+			break;
+	best_move[0] = x;
+	best_move[1] = y;
+	best_move[2] = pos->player == WHITE ? PLOT4_WP : PLOT4_BP;
+	best_move[3] = -1;
+	if (pos->player == BLACK)
+		val = -val;
+	*eval = val * GAME_EVAL_INFTY;
+	return empties;
+}
+
 int plot4_islegal (byte *board, int x, int y)
 	/* check bounds
 	   check if (x,y) is empty
@@ -0,0 +1,212 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "game.h"
+#include "plot4bb.h"
+
+/** \file plot4bb.c
+  \brief Bitboards and an endgame solver for Plot 4.
+
+  The game doesn't end with the first line of four, so the solver
+  searches to the full board and scores it with plot4bb_lines(). Most
+  of the pruning comes from bounding the final score by the lines each
+  side can still complete.
+  */
+
+#define PLOT4BB_WID 7
+#define PLOT4BB_HEIT 6
+
+//! The bottom square of every column
+#define BOTTOM G_GUINT64_CONSTANT(0x0040810204081)
+
+//! All the squares of the board, without the spare bits
+#define FULL (BOTTOM * ((1 << PLOT4BB_HEIT) - 1))
+
+#define SOLVE_INFTY 100
+
+#define SOLVE_HASH_BITS 18
+
+typedef struct
+{
+	guint64 own, opp;
+	gint8 lower, upper;
+	//! Column of the best move, or -1
+	gint8 best;
+} SolveEntry;
+
+static SolveEntry *solve_hash = NULL;
+static long solve_nodes;
+static gboolean solve_stopped;
+
+//! The columns, middle ones first
+static int solve_order [PLOT4BB_WID] = { 3, 2, 4, 1, 5, 0, 6 };
+
+extern gboolean engine_stop_search;
+extern void engine_poll ();
+
+int plot4bb_count (guint64 b)
+{
+	b = b - ((b >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+	b = (b & G_GUINT64_CONSTANT(0x3333333333333333)) 
+		+ ((b >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+	b = (b + (b >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+	return (int) ((b * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56);
+}
+
+guint64 plot4bb_squares ()
+{
+	return FULL;
+}
+
+void plot4bb_from_board (byte *board, guint64 *white, guint64 *black)
+{
+	int x, y;
+	*white = *black = 0;
+	assert (board_wid == PLOT4BB_WID && board_heit == PLOT4BB_HEIT);
+	for (x=0; x<board_wid; x++)
+		for (y=0; y<board_heit; y++)
+		{
+			// the values of PLOT4_WP and PLOT4_BP
+			if (board [y * board_wid + x] == 1)
+				*white |= PLOT4BB_BIT (x, y);
+			else if (board [y * board_wid + x] == 2)
+				*black |= PLOT4BB_BIT (x, y);
+		}
+}
+
+int plot4bb_lines (guint64 b)
+{
+	// vertical, horizontal and the two diagonals
+	static int shifts [4] = { 1, PLOT4BB_HEIT + 1, PLOT4BB_HEIT, PLOT4BB_HEIT + 2 };
+	int d, lines = 0;
+	for (d=0; d<4; d++)
+	{
+		guint64 m = b & (b >> shifts [d]);
+		lines += plot4bb_count (m & (m >> (2 * shifts [d])));
+	}
+	return lines;
+}
+
+static SolveEntry *solve_hash_entry (guint64 own, guint64 opp)
+{
+	guint64 key = own * G_GUINT64_CONSTANT(0x9e3779b97f4a7c15) 
+		^ opp * G_GUINT64_CONSTANT(0xc2b2ae3d27d4eb4f);
+	return solve_hash + (key >> (64 - SOLVE_HASH_BITS));
+}
+
+static int solve (guint64 own, guint64 opp, int alpha, int beta, int *best_col)
+{
+	guint64 mask = own | opp, moves, empty;
+	SolveEntry *entry;
+	int i, lower, upper, best = -SOLVE_INFTY, best_move = -1, orig_alpha;
+
+	if ((++solve_nodes & 4095) == 0)
+	{
+		engine_poll ();
+		if (engine_stop_search)
+			solve_stopped = TRUE;
+	}
+	if (solve_stopped)
+		return 0;
+
+	// the lines already made, and the ones that can still be made
+	empty = FULL & ~mask;
+	lower = plot4bb_lines (own) - plot4bb_lines (opp | empty);
+	upper = plot4bb_lines (own | empty) - plot4bb_lines (opp);
+	// the root has to search on to find a move
+	if (!best_col && (lower == upper || lower >= beta))
+		return lower;
+	if (!best_col && upper <= alpha)
+		return upper;
+	if (alpha < lower)
+		alpha = lower;
+	if (beta > upper)
+		beta = upper;
+
+	entry = solve_hash_entry (own, opp);
+	if (entry->own == own && entry->opp == opp)
+	{
+		if (!best_col)
+		{
+			if (entry->lower >= beta)
+				return entry->lower;
+			if (entry->upper <= alpha)
+				return entry->upper;
+			if (entry->lower == entry->upper)
+				return entry->lower;
+		}
+		best_move = entry->best;
+	}
+	orig_alpha = alpha;
+
+	moves = (mask + BOTTOM) & FULL;
+	for (i=-1; i<PLOT4BB_WID; i++)
+	{
+		int col = i < 0 ? best_move : solve_order [i], val;
+		guint64 m;
+		if (col < 0 || (i >= 0 && col == best_move))
+			continue;
+		m = moves & (FULL & (((G_GUINT64_CONSTANT(1) << PLOT4BB_HEIT) - 1) << (col * 7)));
+		if (!m)
+			continue;
+		val = -solve (opp, own | m, -beta, -alpha, NULL);
+		if (solve_stopped)
+			return 0;
+		if (val > best)
+		{
+			best = val;
+			best_move = col;
+			if (val > alpha)
+				alpha = val;
+			if (alpha >= beta)
+				break;
+		}
+	}
+
+	entry->own = own;
+	entry->opp = opp;
+	entry->lower = best > orig_alpha ? best : -SOLVE_INFTY;
+	entry->upper = best < beta ? best : SOLVE_INFTY;
+	entry->best = best_move;
+	if (best_col)
+		*best_col = best_move;
+	return best;
+}
+
+int plot4bb_solve (guint64 own, guint64 opp, int *best_col, long *nodes)
+{
+	int val;
+	if (!solve_hash)
+	{
+		solve_hash = (SolveEntry *) malloc ((1 << SOLVE_HASH_BITS) * sizeof (SolveEntry));
+		assert (solve_hash);
+	}
+	memset (solve_hash, 0, (1 << SOLVE_HASH_BITS) * sizeof (SolveEntry));
+	solve_nodes = 0;
+	solve_stopped = FALSE;
+	*best_col = -1;
+	val = solve (own, opp, -SOLVE_INFTY, SOLVE_INFTY, best_col);
+	if (nodes)
+		*nodes = solve_nodes;
+	return solve_stopped ? -SOLVE_INFTY : val;
+}
@@ -0,0 +1,53 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _PLOT4BB_H_
+#define _PLOT4BB_H_
+
+#include "game.h"
+
+/** \file plot4bb.h
+  \brief Bitboards for Plot 4.
+
+  Square (x, y) is bit x * 7 + y, with y = 0 at the bottom. Each column
+  has a spare bit above its top square, so that shifting a line of four
+  never wraps from one column into the next.
+  */
+
+#define PLOT4BB_BIT(x, y) (G_GUINT64_CONSTANT(1) << ((x) * 7 + (y)))
+
+//! Makes bitboards of the white and the black balls of a board in the format of Pos::board
+void plot4bb_from_board (byte *board, guint64 *white, guint64 *black);
+
+//! All the squares of the board
+guint64 plot4bb_squares ();
+
+//! Number of bits set in b
+int plot4bb_count (guint64 b);
+
+//! Number of lines of four, in any direction, all of whose squares are in b
+/** This is the score of a player whose balls are b, once the board is full. */
+int plot4bb_lines (guint64 b);
+
+//! Finds the exact final score difference for own to move, by searching to the end of the game
+/** The best column is stored in best_col, and the number of positions
+  searched in nodes if it is not NULL. The search is stopped, with a
+  result of less than -69, if engine_stop_search gets set. */
+int plot4bb_solve (guint64 own, guint64 opp, int *best_col, long *nodes);
+
+#endif
@@ -36,11 +36,6 @@ static Score scores[MAX_HIGHSCORES];
 static int num_highscores = 0;
 static gchar *gamename; // ugly
 
-SCORE_FIELD prefs_score_fields_def[] = 
-{SCORE_FIELD_USER, SCORE_FIELD_SCORE, SCORE_FIELD_TIME, SCORE_FIELD_DATE, SCORE_FIELD_NONE};
-
-gchar* prefs_score_field_names_def[] = {"User", "Score", "Time", "Date", NULL};
-
 ConfigVar prefs_config_vars[] = 
 {
 	{ "sound_dir", "Directory to load sounds from", NULL, NULL, NULL, NULL },
@@ -309,35 +304,6 @@ gboolean prefs_save_scores (gchar *name)
 	return TRUE;
 }
 
-int prefs_scorecmp_dscore (gchar *score1, int temps1, gchar* score2, int temps2)
-{
-	int s1 = atoi (score1);
-	int s2 = atoi (score2);
-	if (s1 > s2) return 1;
-	if (s1 < s2) return -1;
-	if (temps1 < temps2) return 1;
-	if (temps1 > temps2) return -1;
-	return 0;
-}
-
-int prefs_scorecmp_iscore (gchar *score1, int temps1, gchar* score2, int temps2)
-{
-	int s1 = atoi (score1);
-	int s2 = atoi (score2);
-	if (s1 < s2) return 1;
-	if (s1 > s2) return -1;
-	if (temps1 < temps2) return 1;
-	if (temps1 > temps2) return -1;
-	return 0;
-}
-
-int prefs_scorecmp_time (gchar *score1, int temps1, gchar* score2, int temps2)
-{
-	if (temps1 < temps2) return 1;
-	if (temps1 > temps2) return -1;
-	return 0;
-}
-
 static int  highscore_temps, highscore_index, highscore_date;
 static gchar highscore_score[32];
 
@@ -62,17 +62,11 @@ typedef struct
 } ConfigVar;
 
 
-extern SCORE_FIELD prefs_score_fields_def[];
-extern gchar* prefs_score_field_names_def[];
-
 gboolean prefs_load_scores (gchar *);
 gboolean prefs_save_scores (gchar *);
 void prefs_show_scores ();
 void prefs_zap_highscores ();
 gboolean prefs_add_highscore (gchar *, int);
-int prefs_scorecmp_dscore (gchar *, int, gchar*, int);
-int prefs_scorecmp_iscore (gchar *, int, gchar*, int);
-int prefs_scorecmp_time (gchar *, int, gchar*, int);
 void prefs_read_config_file ();
 gchar *prefs_get_config_val (gchar *key);
 void prefs_set_config_val (gchar *key, gchar *value);
@@ -65,6 +65,7 @@ static ResultType quarto_who_won (Pos *, Player, char **);
 void quarto_init (void);
 static byte * quarto_movegen (Pos *);
 static ResultType quarto_eval (Pos *, Player, float *eval);
+static int quarto_solve (Pos *, byte *, float *, int *);
 static void quarto_reset_uistate (Pos *pos);
 static unsigned char * quarto_get_rgbmap (int idx, int color);
 void quarto_get_render (Pos *pos, byte *move, int **rmovp);
@@ -74,6 +75,7 @@ void quarto_init ()
 	game_eval = quarto_eval;
 	game_movegen = quarto_movegen;
 	game_who_won = quarto_who_won;
+	game_solve = quarto_solve;
 	game_getmove = quarto_getmove;
 	game_get_rgbmap = quarto_get_rgbmap;
 	game_draw_cell_boundaries = TRUE;
@@ -98,6 +100,7 @@ static ResultType quarto_who_won (Pos *pos, Player player, char **commp)
 	result = quarto_eval (pos, player, &eval);
 	if (result == RESULT_WHITE) *commp = "White won";
 	if (result == RESULT_BLACK) *commp = "Black won";
+	if (result == RESULT_TIE) *commp = "Its a tie";
 	return result;
 }
 
@@ -143,8 +146,15 @@ static ResultType quarto_eval (Pos *pos, Player player, float *eval)
 	if (eval_column (pos->board, 0, 3, 1, -1))
 		return result;
 
-	*eval = random() * 0.01 / RAND_MAX;
-	return RESULT_NOTYET;
+	*eval = 0;
+	for (i=0; i<4; i++)
+		for (j=0; j<4; j++)
+			if (pos->board [j * board_wid + i] == QUARTO_EMPTY)
+			{
+				*eval = random() * 0.01 / RAND_MAX;
+				return RESULT_NOTYET;
+			}
+	return RESULT_TIE;
 }
 
 static int cur_piece = -1, curx = -1, cury = -1;
@@ -235,48 +245,445 @@ void quarto_reset_uistate (Pos *pos)
 	cur_piece = curx = cury = -1;
 }
 
+/* The solver. A position is the pieces on the 4x4 board, as 16 nibbles
+   with square (x, y) at nibble 4 * y + x holding the piece - 1 (0 if the
+   square is empty), the mask of occupied squares and the mask of pieces
+   not yet played. Since the player to move picks the piece, a line of
+   three that some remaining piece completes is a win for them, so the
+   only moves worth searching are the ones which don't leave such a line.
+
+   The transposition table is keyed on a canonical form of the position
+   under the 32 symmetries of the board which keep the lines, and the 384
+   renamings of the pieces which keep their attributes: a permutation of
+   the four attributes and a flip of any of them. */
+
+#define QUARTO_SOLVE_HASH_BITS 20
+
+//! The solver gives up after this many positions and leaves the move to ab_dfid
+#define QUARTO_SOLVE_MAX_NODES 10000000
+
+//! The solver is only tried once at most this many squares are empty
+#define QUARTO_SOLVE_EMPTIES 12
+
+//! Positions with fewer empty squares are cheaper to search than to canonicalize
+#define QUARTO_SOLVE_HASH_MIN_EMPTIES 7
+
+#define QUARTO_NUM_LINES 10
+
+extern gboolean engine_stop_search;
+extern void engine_poll ();
+
+typedef struct
+{
+	//! The attributes of the pieces, see solve_canon()
+	guint64 attrs;
+	guint16 occ;
+	gint8 lower, upper;
+} SolveEntry;
+
+static SolveEntry *solve_hash = NULL;
+static long solve_nodes;
+static gboolean solve_stopped;
+
+static guint16 solve_line_mask [QUARTO_NUM_LINES];
+static int solve_line_sq [QUARTO_NUM_LINES][4];
+//! The lines through each square, terminated by -1
+static int solve_sq_lines [16][4];
+//! solve_completers[a][b] is the set of pieces which have one of the attributes in a or lack one of the ones in b
+static guint16 solve_completers [16][16];
+//! solve_syms[t][e] is the square that symmetry t moves to square e
+static int solve_syms [32][16];
+
+#define SOLVE_PIECE(pieces, e) ((int) ((pieces) >> (4 * (e))) & 0xf)
+
+static void solve_init ()
+{
+	int l, e, k, a, b, p, t;
+	int perms [8][4], nperms = 0;
+	static int lines [QUARTO_NUM_LINES][3] = 
+	{
+		// x0, y0, direction
+		{0, 0, 0}, {0, 1, 0}, {0, 2, 0}, {0, 3, 0},
+		{0, 0, 1}, {1, 0, 1}, {2, 0, 1}, {3, 0, 1},
+		{0, 0, 2}, {0, 3, 3},
+	};
+	static int incx[4] = { 1, 0, 1, 1 };
+	static int incy[4] = { 0, 1, 1, -1 };
+	int nlines [16];
+
+	memset (nlines, 0, sizeof (nlines));
+	for (l=0; l<QUARTO_NUM_LINES; l++)
+	{
+		solve_line_mask [l] = 0;
+		for (k=0; k<4; k++)
+		{
+			e = 4 * (lines[l][1] + k * incy[lines[l][2]]) + lines[l][0] + k * incx[lines[l][2]];
+			solve_line_sq [l][k] = e;
+			solve_line_mask [l] |= 1 << e;
+			solve_sq_lines [e][nlines [e]++] = l;
+		}
+	}
+	for (e=0; e<16; e++)
+		solve_sq_lines [e][nlines [e]] = -1;
+
+	for (a=0; a<16; a++)
+		for (b=0; b<16; b++)
+		{
+			solve_completers [a][b] = 0;
+			for (p=0; p<16; p++)
+				if ((p & a) || (~p & b))
+					solve_completers [a][b] |= 1 << p;
+		}
+
+	// the permutations of 0..3 which commute with i -> 3 - i
+	for (p=0; p<256; p++)
+	{
+		int s[4], ok = 1;
+		for (k=0; k<4; k++)
+			s[k] = (p >> (2 * k)) & 3;
+		for (k=0; k<4; k++)
+			if (s[3-k] != 3 - s[k])
+				ok = 0;
+		for (a=0; a<4; a++)
+			for (b=a+1; b<4; b++)
+				if (s[a] == s[b])
+					ok = 0;
+		if (ok)
+			memcpy (perms [nperms++], s, sizeof (s));
+	}
+	assert (nperms == 8);
+
+	// the same permutation of the rows and columns, or of the rows and
+	// the columns reversed, with or without a transposition
+	for (t=0; t<32; t++)
+	{
+		int *s = perms [t % 8];
+		for (e=0; e<16; e++)
+		{
+			int x = e % 4, y = e / 4, nx, ny;
+			nx = (t / 8) % 2 ? 3 - s[x] : s[x];
+			ny = s[y];
+			if (t / 16)
+				solve_syms [t][4 * nx + ny] = e;
+			else
+				solve_syms [t][4 * ny + nx] = e;
+		}
+	}
+
+	solve_hash = (SolveEntry *) malloc ((1 << QUARTO_SOLVE_HASH_BITS) * sizeof (SolveEntry));
+	assert (solve_hash);
+}
+
+//! The attributes all the pieces on the line have, and the ones none of them has
+static void solve_line_common (guint64 pieces, int occ, int l, int *have, int *lack)
+{
+	int k;
+	*have = *lack = QUARTO_ALL_PIECES_MASK;
+	for (k=0; k<4; k++)
+		if (occ & (1 << solve_line_sq [l][k]))
+		{
+			int p = SOLVE_PIECE (pieces, solve_line_sq [l][k]);
+			*have &= p;
+			*lack &= ~p;
+		}
+}
+
+static int solve_count (int b)
+{
+	int n;
+	for (n=0; b; n++)
+		b &= b - 1;
+	return n;
+}
+
+//! The pieces which, on the empty square of line l, would complete it
+static int solve_line_completers (guint64 pieces, int occ, int l)
+{
+	int have, lack;
+	if (solve_count (occ & solve_line_mask [l]) != 3)
+		return 0;
+	solve_line_common (pieces, occ, l, &have, &lack);
+	return solve_completers [have][lack];
+}
+
+//! A winning move, found by storing the square in e and the piece in p, or FALSE
+static gboolean solve_find_win (guint64 pieces, int occ, int avail, int *e, int *p)
+{
+	int l, k, c;
+	for (l=0; l<QUARTO_NUM_LINES; l++)
+		if ((c = solve_line_completers (pieces, occ, l) & avail))
+		{
+			for (k=0; occ & (1 << solve_line_sq [l][k]); k++)
+				;
+			*e = solve_line_sq [l][k];
+			for (*p=0; !(c & (1 << *p)); (*p)++)
+				;
+			return TRUE;
+		}
+	return FALSE;
+}
+
+//! Does the piece just put on square e leave the opponent a win
+/** The position before the move mustn't have had a win. */
+static gboolean solve_gives_win (guint64 pieces, int occ, int avail, int e)
+{
+	int i;
+	for (i=0; solve_sq_lines [e][i] >= 0; i++)
+		if (solve_line_completers (pieces, occ, solve_sq_lines [e][i]) & avail)
+			return TRUE;
+	return FALSE;
+}
+
+/** Writes the canonical form of the position into attrs and occ. For each
+  symmetry the pieces are read off in the order of the transformed squares
+  and xor'ed with the first one; then attribute k gives a row of bits, one
+  for each piece, and the rows are sorted. The smallest of these over the
+  symmetries is the canonical form. */
+static void solve_canon (guint64 pieces, int occ, guint64 *attrs, guint16 *occp)
+{
+	int t, e, k, n, first, tmp;
+	guint64 best_attrs = 0;
+	int best_occ = -1;
+	for (t=0; t<32; t++)
+	{
+		int tocc = 0, rows[4] = {0, 0, 0, 0};
+		guint64 tattrs;
+		first = -1;
+		for (e=0, n=0; e<16; e++)
+		{
+			int sq = solve_syms [t][e], p;
+			if (!(occ & (1 << sq)))
+				continue;
+			tocc |= 1 << e;
+			p = SOLVE_PIECE (pieces, sq);
+			if (first < 0)
+				first = p;
+			p ^= first;
+			for (k=0; k<4; k++)
+				if (p & (1 << k))
+					rows [k] |= 1 << n;
+			n++;
+		}
+		if (best_occ >= 0 && tocc > best_occ)
+			continue;
+		for (k=1; k<4; k++)
+			for (n=k; n>0 && rows [n-1] < rows [n]; n--)
+			{
+				tmp = rows [n];
+				rows [n] = rows [n-1];
+				rows [n-1] = tmp;
+			}
+		tattrs = ((guint64) rows[0] << 48) | ((guint64) rows[1] << 32)
+			| ((guint64) rows[2] << 16) | rows[3];
+		if (best_occ < 0 || tocc < best_occ || tattrs < best_attrs)
+		{
+			best_occ = tocc;
+			best_attrs = tattrs;
+		}
+	}
+	*attrs = best_attrs;
+	*occp = best_occ;
+}
+
+//! 1 if the player to move wins, -1 if they lose and 0 for a draw
+static int solve (guint64 pieces, int occ, int avail, int alpha, int beta)
+{
+	int e, p, val, best = -1, orig_alpha = alpha, we, wp;
+	guint64 attrs;
+	guint16 cocc;
+	SolveEntry *entry;
+
+	if ((++solve_nodes & 4095) == 0)
+		engine_poll ();
+	if (engine_stop_search || solve_nodes > QUARTO_SOLVE_MAX_NODES)
+		solve_stopped = TRUE;
+	if (solve_stopped)
+		return 0;
+
+	if (occ == 0xffff)
+		return 0;
+	if (solve_find_win (pieces, occ, avail, &we, &wp))
+		return 1;
+
+	entry = NULL;
+	if (16 - solve_count (occ) >= QUARTO_SOLVE_HASH_MIN_EMPTIES)
+	{
+		solve_canon (pieces, occ, &attrs, &cocc);
+		entry = solve_hash + (((attrs ^ cocc) * G_GUINT64_CONSTANT(0x9e3779b97f4a7c15)) 
+				>> (64 - QUARTO_SOLVE_HASH_BITS));
+		if (entry->attrs == attrs && entry->occ == cocc)
+		{
+			if (entry->lower >= beta || entry->lower == entry->upper)
+				return entry->lower;
+			if (entry->upper <= alpha)
+				return entry->upper;
+			if (entry->lower > alpha)
+				alpha = entry->lower;
+			if (entry->upper < beta)
+				beta = entry->upper;
+		}
+	}
+
+	for (e=0; e<16 && alpha < beta; e++)
+	{
+		if (occ & (1 << e))
+			continue;
+		for (p=0; p<16; p++)
+		{
+			guint64 newpieces = pieces | ((guint64) p << (4 * e));
+			if (!(avail & (1 << p)))
+				continue;
+			if (solve_gives_win (newpieces, occ | (1 << e), avail & ~(1 << p), e))
+				continue;
+			val = -solve (newpieces, occ | (1 << e), avail & ~(1 << p), -beta, -alpha);
+			if (solve_stopped)
+				return 0;
+			if (val > best)
+			{
+				best = val;
+				if (val > alpha)
+					alpha = val;
+				if (alpha >= beta)
+					break;
+			}
+		}
+	}
+
+	if (entry)
+	{
+		entry->attrs = attrs;
+		entry->occ = cocc;
+		entry->lower = best > orig_alpha ? best : -1;
+		entry->upper = best < beta ? best : 1;
+	}
+	return best;
+}
+
+static void solve_from_board (byte *board, guint64 *pieces, int *occ, int *avail)
+{
+	int x, y;
+	*pieces = 0;
+	*occ = 0;
+	*avail = 0xffff;
+	for (x=0; x<4; x++)
+		for (y=0; y<4; y++)
+		{
+			int val = board [y * board_wid + x];
+			if (val == QUARTO_EMPTY)
+				continue;
+			*pieces |= (guint64) (val - 1) << (4 * (4 * y + x));
+			*occ |= 1 << (4 * y + x);
+			*avail &= ~(1 << (val - 1));
+		}
+}
+
+//! Plays perfectly once the solver can get to the end within QUARTO_SOLVE_MAX_NODES
+/** Unlike the other solvers this ignores game_solve_moves: from the first
+ moves it would only use up its node budget without an answer. */
+static int quarto_solve (Pos *pos, byte *best_move, float *eval, int *nodes)
+{
+	guint64 pieces;
+	int occ, avail, e, p, val, best = -2, best_e = -1, best_p = -1;
+	float dummy;
+	if (quarto_eval (pos, pos->player, &dummy) != RESULT_NOTYET)
+		return 0;
+	solve_from_board (pos->board, &pieces, &occ, &avail);
+	if (16 - solve_count (occ) > QUARTO_SOLVE_EMPTIES)
+		return 0;
+	if (!solve_hash)
+		solve_init ();
+	memset (solve_hash, 0, (1 << QUARTO_SOLVE_HASH_BITS) * sizeof (SolveEntry));
+	solve_nodes = 0;
+	solve_stopped = FALSE;
+
+	if (solve_find_win (pieces, occ, avail, &best_e, &best_p))
+		best = 1;
+	for (e=0; e<16 && best < 1; e++)
+	{
+		if (occ & (1 << e))
+			continue;
+		for (p=0; p<16 && best < 1; p++)
+		{
+			guint64 newpieces = pieces | ((guint64) p << (4 * e));
+			if (!(avail & (1 << p)))
+				continue;
+			if (solve_gives_win (newpieces, occ | (1 << e), avail & ~(1 << p), e))
+				val = -1;
+			else
+				val = -solve (newpieces, occ | (1 << e), avail & ~(1 << p), -1, best < 0 ? 1 : -best);
+			if (solve_stopped)
+				break;
+			if (val > best)
+			{
+				best = val;
+				best_e = e;
+				best_p = p;
+			}
+		}
+	}
+	*nodes = solve_nodes;
+	if (solve_stopped)
+		return 0;
+
+	best_move [0] = best_e % 4;
+	best_move [1] = best_e / 4;
+	best_move [2] = best_p + 1;
+	best_move [3] = -1;
+	*eval = best * (pos->player == WHITE ? GAME_EVAL_INFTY : -GAME_EVAL_INFTY);
+	return 16 - solve_count (occ);
+}
+
+static byte *quarto_write_move (byte *movp, int e, int p)
+{
+	*movp++ = e % 4;
+	*movp++ = e / 4;
+	*movp++ = p + 1;
+	*movp++ = -1;
+	return movp;
+}
+
+//! All the moves, pruned by the lines of three
+/** If we can complete a line, we do. Otherwise only the moves that don't
+  let the opponent complete one are generated, unless all of them do. */
 byte *quarto_movegen (Pos *pos)
 {
 	byte movbuf[2048];
 	byte *movlist, *movp = movbuf;
-	int from_x, from_y, to_x, to_y;
+	guint64 pieces;
+	int occ, avail, e, p, pass;
 	Player player = pos->player;
 
-	int count = 0;
-	for (to_x=0; to_x<4; to_x++)
-	for (to_y=0; to_y<4; to_y++)
-		if (pos->board [to_y * board_wid + to_x] != QUARTO_EMPTY)
-			count++;
-	assert ((player == WHITE && count % 2 == 0) || (player == BLACK && count % 2 == 1));
+	if (!solve_hash)
+		solve_init ();
+	solve_from_board (pos->board, &pieces, &occ, &avail);
+	assert ((player == WHITE && solve_count (occ) % 2 == 0) 
+			|| (player == BLACK && solve_count (occ) % 2 == 1));
 
-		
-	for (from_x=5; from_x<9; from_x++)
-	for (from_y=0; from_y<4; from_y++)
+	if (solve_find_win (pieces, occ, avail, &e, &p))
 	{
-		gboolean found = FALSE;
-		int val = pos->board [from_y * board_wid + from_x];
-		for (to_x=0; to_x<4; to_x++)
-		for (to_y=0; to_y<4; to_y++)
-			if (val == pos->board [to_y * board_wid + to_x])
-			{
-				found = TRUE;
-				break;
-			}
-		if (!found)
+		movp = quarto_write_move (movp, e, p);
+		*movp++ = -2;
+		movlist = (byte *) (malloc (movp - movbuf));
+		memcpy (movlist, movbuf, (movp - movbuf));
+		return movlist;
+	}
+
+	for (pass = 0; pass < 2 && movp == movbuf; pass++)
+		for (p=0; p<16; p++)
 		{
-			for (to_x=0; to_x<4; to_x++)
-			for (to_y=0; to_y<4; to_y++)
+			if (!(avail & (1 << p)))
+				continue;
+			for (e=0; e<16; e++)
 			{
-				if (pos->board [to_y * board_wid + to_x] == QUARTO_EMPTY)
-				{
-					*movp++ = to_x;
-					*movp++ = to_y;
-					*movp++ = val;
-					*movp++ = -1;
-				}
+				guint64 newpieces = pieces | ((guint64) p << (4 * e));
+				if (occ & (1 << e))
+					continue;
+				if (pass == 0 && solve_gives_win 
+						(newpieces, occ | (1 << e), avail & ~(1 << p), e))
+					continue;
+				movp = quarto_write_move (movp, e, p);
 			}
 		}
-	}
 	*movp++ = -2;
 	movlist = (byte *) (malloc (movp - movbuf));
 	memcpy (movlist, movbuf, (movp - movbuf));
@@ -25,6 +25,9 @@
 #include "game.h"
 #include "aaball.h"
 
+extern int time_per_move;
+extern int ab_max_depth;
+
 #define SAMEGAME_NUM_ANIM 8
 
 #define SAMEGAME_CELL_SIZE 40
@@ -56,9 +59,9 @@ typedef struct
 SCORE_FIELD samegame_score_fields[] = {SCORE_FIELD_RANK, SCORE_FIELD_USER, SCORE_FIELD_SCORE, SCORE_FIELD_TIME, SCORE_FIELD_DATE, SCORE_FIELD_NONE};
 char *samegame_score_field_names[] = {"Rank", "User", "Score", "Time", "Date", NULL};
 
-static void recursive_delete (byte *board, int x, int y, int val);
-static void pull_down (byte *board);
-static byte * synth_move (byte *newboard, byte *board);
+static void recursive_delete (byte *board, int x, int y, int val, int *minx);
+static void pull_down (byte *board, int minx);
+static byte * synth_move (byte *newboard, byte *board, int minx);
 
 static int samegame_animate (Pos *pos, byte **movp);
 static int samegame_getmove (Pos *, int, int, GtkboardEventType, Player, byte **, int **);
@@ -66,7 +69,6 @@ static char **samegame_get_pixmap (int , int);
 static void *samegame_newstate (Pos *, byte *);
 static ResultType samegame_who_won (Pos *, Player, char **);
 static void samegame_search (Pos *pos, byte **movp);
-static void samegame_getxy (byte *board, int *x, int *y);
 
 static int anim_curx=-1, anim_cury=-1;
 
@@ -238,7 +240,8 @@ int samegame_animate (Pos *pos, byte **movp)
 
 static int getmove_real (Pos *pos, int x, int y, byte **movp)
 {
-	byte *newboard, val;
+	byte newboard [SAMEGAME_BOARD_WID * SAMEGAME_BOARD_HEIT], val;
+	int minx = x;
 	if ((val = pos->board[y * board_wid + x]) == 0)	
 		return -1;
 	/* do we have at least 1 neighbor */
@@ -250,19 +253,16 @@ static int getmove_real (Pos *pos, int x, int y, byte **movp)
 			break;
 		if (y > 0 && val == pos->board[(y-1) * board_wid + x])
 			break;
-		if (y < board_heit && val == pos->board[(y+1) * board_wid + x])
+		if (y < board_heit - 1 && val == pos->board[(y+1) * board_wid + x])
 			break;
 		return -1;
 	} while (0);
 		
-	newboard = (byte *) malloc (board_wid * board_heit);
-	assert (newboard);
 	memcpy (newboard, pos->board, board_wid * board_heit);
-	recursive_delete (newboard, x, y, newboard[y * board_wid + x]);
-	pull_down (newboard);
+	recursive_delete (newboard, x, y, newboard[y * board_wid + x], &minx);
+	pull_down (newboard, minx);
 	if (movp)
-		*movp = synth_move (newboard, pos->board);
-	free (newboard);
+		*movp = synth_move (newboard, pos->board, minx);
 	
 	return 1;
 }
@@ -286,64 +286,47 @@ int samegame_getmove
 	return getmove_real (pos, x, y, movp);
 }
 
-static void recursive_delete (byte *board, int x, int y, int val)
+static void recursive_delete (byte *board, int x, int y, int val, int *minx)
 {
 	if (x < 0 || y < 0 || x >= board_wid || y >= board_heit)
 		return;
 	if (board[y * board_wid + x] != val)
 		return;
 	board[y * board_wid + x] = 0;
-	recursive_delete (board, x - 1, y   , val);
-	recursive_delete (board, x + 1, y   , val);
-	recursive_delete (board, x    , y - 1, val);
-	recursive_delete (board, x    , y + 1, val);
+	if (x < *minx)
+		*minx = x;
+	recursive_delete (board, x - 1, y   , val, minx);
+	recursive_delete (board, x + 1, y   , val, minx);
+	recursive_delete (board, x    , y - 1, val, minx);
+	recursive_delete (board, x    , y + 1, val, minx);
 }
 
-static void pull_down (byte *board)
+//! Lets the balls fall and closes up empty columns; nothing left of column minx changes
+static void pull_down (byte *board, int minx)
 {
-	int i, j, k, cnt;
-	byte *tempcol;
-	tempcol = (byte *) malloc (board_heit);
-	assert (tempcol);
-
-	/* for each column apply gravity */
-	for (i=0; i<board_wid; i++)
+	int i, j, k, col = minx;
+	for (i=minx; i<board_wid; i++)
 	{
 		for (j=0, k=0; j<board_heit; j++)
-		{
 			if (board[j * board_wid + i])
-				tempcol[k++] = board [j * board_wid + i];
-		}
+				board[k++ * board_wid + col] = board[j * board_wid + i];
+		// an empty column is overwritten by the next one
+		if (k == 0)
+			continue;
 		for (; k<board_heit; k++)
-			tempcol[k] = 0;
-		for (j=0; j<board_heit; j++)
-			board[j * board_wid + i] = tempcol [j];
-	}
-
-	for (cnt = 0; cnt < board_wid; cnt++) // ugly, but works
-	{
-		/* if a column is empty move the col to its right in its place */
-		for (i=0; i<board_wid - 1; i++)
-		{
-			for (j=0; j<board_heit; j++)
-				if (board[j * board_wid + i])
-					break;
-			if (j == board_heit)	/* col is empty */
-				for (j=0; j<board_heit; j++)
-				{
-					board [j * board_wid + i]	= board [j * board_wid + i + 1];
-					board [j * board_wid + i + 1] = 0;
-				}
-		}
+			board[k * board_wid + col] = 0;
+		col++;
 	}
-	free (tempcol);
+	for (; col<board_wid; col++)
+		for (j=0; j<board_heit; j++)
+			board[j * board_wid + col] = 0;
 }
 
-static byte * synth_move (byte *newboard, byte *board)
+static byte * synth_move (byte *newboard, byte *board, int minx)
 {
 	static byte movbuf [1024];
 	int i, j, m = 0;
-	for (i=0; i<board_wid; i++)
+	for (i=minx; i<board_wid; i++)
 		for (j=0; j<board_heit; j++)
 			if (newboard [j * board_wid + i] != board [j * board_wid + i])
 			{
@@ -383,31 +366,226 @@ char ** samegame_get_pixmap (int idx, int color)
 	return pixmap_header_gen (SAMEGAME_CELL_SIZE, pixbuf, fg, bg);
 }
 
-void samegame_search (Pos *pos, byte **movp)
+/* The solver. It runs a beam search over the removals of blocks, keeping
+   the positions that look most promising after each removal, and starts
+   over with twice as wide a beam for as long as time permits. A position
+   is scored by its score so far plus the points it would get if each
+   color came off as a single block. The best finished game so far gives
+   the move. */
+
+#define SAMEGAME_NUM_CELLS (SAMEGAME_BOARD_WID * SAMEGAME_BOARD_HEIT)
+
+//! The widest beam tried
+#define SAMEGAME_BEAM_MAX 512
+
+//! Number of widths tried when neither a depth nor a time is given
+#define SAMEGAME_BEAM_ROUNDS 6
+
+//! Most blocks a position can have
+#define SAMEGAME_MAX_BLOCKS (SAMEGAME_NUM_CELLS / 2)
+
+typedef struct
+{
+	//! The colors (1 to 3) of the balls, without the animation frames
+	byte board [SAMEGAME_NUM_CELLS];
+	//! Block of each ball, as labeled by samegame_label()
+	guint8 label [SAMEGAME_NUM_CELLS];
+	//! Sizes of the blocks
+	guint8 size [SAMEGAME_NUM_CELLS];
+	int num_blocks;
+	//! Number of balls of each color
+	int count [4];
+	int score;
+	//! The first removal on the way here, as a square of the original board
+	int firstx, firsty;
+} SamegameNode;
+
+typedef struct
+{
+	int parent;
+	//! A square of the block to remove
+	int cell;
+	int val;
+} SamegameCand;
+
+static SamegameNode samegame_beam [2][SAMEGAME_BEAM_MAX];
+static SamegameCand samegame_cands [SAMEGAME_BEAM_MAX * SAMEGAME_MAX_BLOCKS];
+
+static int samegame_cand_cmp (const void *a, const void *b)
 {
-	int x, y;
-	int retval;
-	samegame_getxy (pos->board, &x, &y);
-	retval = getmove_real (pos, x, y, movp);
-	assert (retval > 0);
+	return ((SamegameCand *)b)->val - ((SamegameCand *)a)->val;
 }
 
-void samegame_getxy (byte *board, int *x, int *y)
+static int samegame_potential (int count)
 {
-	int i, j;
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
+	return count > 2 ? (count - 2) * (count - 2) : 0;
+}
+
+//! Labels the blocks of node in one pass, and finds where each one starts
+static void samegame_label (SamegameNode *node, int *start)
+{
+	int stack [SAMEGAME_NUM_CELLS];
+	int i, top, n = 0;
+	memset (node->label, 0xff, sizeof (node->label));
+	for (i=0; i<board_wid * board_heit; i++)
 	{
-		int val = board [j * board_wid + i];
-		if (val == SAMEGAME_EMPTY) continue;
-		if ((i > 0 && board [j * board_wid + i-1] == val) || 
-				(j > 0 && board [(j-1) * board_wid + i] == val))
+		int size = 0;
+		if (!node->board[i] || node->label[i] != 0xff)
+			continue;
+		node->label[i] = n;
+		stack[0] = i;
+		for (top = 1; top > 0; )
 		{
-			*x = i;
-			*y = j;
-			return;
+			int c = stack[--top], x = c % board_wid, nbrs[4], k;
+			size++;
+			nbrs[0] = x > 0 ? c - 1 : -1;
+			nbrs[1] = x < board_wid - 1 ? c + 1 : -1;
+			nbrs[2] = c >= board_wid ? c - board_wid : -1;
+			nbrs[3] = c + board_wid < board_wid * board_heit ? c + board_wid : -1;
+			for (k=0; k<4; k++)
+				if (nbrs[k] >= 0 && node->label[nbrs[k]] == 0xff 
+						&& node->board[nbrs[k]] == node->board[i])
+				{
+					node->label[nbrs[k]] = n;
+					stack[top++] = nbrs[k];
+				}
 		}
+		node->size[n] = size;
+		start[n++] = i;
+	}
+	node->num_blocks = n;
+}
+
+//! Removes the block at cell from node, which must be labeled
+static void samegame_remove (SamegameNode *node, int cell)
+{
+	int i, minx = board_wid, block = node->label[cell];
+	for (i=0; i<board_wid * board_heit; i++)
+		if (node->label[i] == block)
+		{
+			node->board[i] = 0;
+			if (i % board_wid < minx)
+				minx = i % board_wid;
+		}
+	pull_down (node->board, minx);
+}
+
+//! Runs a beam of the given width from root; returns the best finished game and its first move
+static int samegame_beam_search (SamegameNode *root, int width, int *bestx, int *besty)
+{
+	int cur = 0, num = 1, i, j, best = -1;
+	int start [SAMEGAME_NUM_CELLS];
+	guint64 seen [2 * SAMEGAME_BEAM_MAX];
+	samegame_beam[0][0] = *root;
+	while (num > 0)
+	{
+		int num_cands = 0, next = 0;
+		for (i=0; i<num; i++)
+		{
+			SamegameNode *node = &samegame_beam[cur][i];
+			int movable = 0;
+			samegame_label (node, start);
+			for (j=0; j<node->num_blocks; j++)
+			{
+				int size = node->size[j], color = node->board[start[j]], val;
+				if (size < 2)
+					continue;
+				movable++;
+				val = node->score + (size - 2) * (size - 2);
+				if (size == node->count[1] + node->count[2] + node->count[3])
+					val += 1000;
+				for (color = 1; color <= 3; color++)
+					val += samegame_potential (node->count[color] 
+							- (color == node->board[start[j]] ? size : 0));
+				samegame_cands[num_cands].parent = i;
+				samegame_cands[num_cands].cell = start[j];
+				samegame_cands[num_cands].val = val;
+				num_cands++;
+			}
+			if (movable == 0)
+			{
+				int score = node->score;
+				if (node->count[1] + node->count[2] + node->count[3] == 0)
+					score += 1000;
+				if (score > best)
+				{
+					best = score;
+					*bestx = node->firstx;
+					*besty = node->firsty;
+				}
+			}
+		}
+		qsort (samegame_cands, num_cands, sizeof (SamegameCand), samegame_cand_cmp);
+		memset (seen, 0, sizeof (seen));
+		for (i=0; i<num_cands && next<width; i++)
+		{
+			SamegameCand *cand = &samegame_cands[i];
+			SamegameNode *parent = &samegame_beam[cur][cand->parent];
+			SamegameNode *child = &samegame_beam[1-cur][next];
+			int size = parent->size[parent->label[cand->cell]];
+			guint64 key = G_GUINT64_CONSTANT(14695981039346656037);
+			*child = *parent;
+			child->count[child->board[cand->cell]] -= size;
+			child->score += (size - 2) * (size - 2);
+			if (parent->firstx < 0)
+			{
+				child->firstx = cand->cell % board_wid;
+				child->firsty = cand->cell / board_wid;
+			}
+			samegame_remove (child, cand->cell);
+			// the same position is often reached in different orders
+			for (j=0; j<board_wid * board_heit; j++)
+				key = (key ^ child->board[j]) * G_GUINT64_CONSTANT(1099511628211);
+			key |= 1;
+			j = key & (2 * SAMEGAME_BEAM_MAX - 1);
+			while (seen[j] && seen[j] != key)
+				j = (j + 1) & (2 * SAMEGAME_BEAM_MAX - 1);
+			if (seen[j] == key)
+				continue;
+			seen[j] = key;
+			next++;
+		}
+		cur = 1 - cur;
+		num = next;
+	}
+	return best;
+}
+
+void samegame_search (Pos *pos, byte **movp)
+{
+	static GTimer *timer = NULL;
+	SamegameNode root;
+	int i, width, rounds, bestx = -1, besty = -1, best = -1;
+	if (!timer)
+		timer = g_timer_new ();
+	g_timer_start (timer);
+	memset (&root, 0, sizeof (root));
+	for (i=0; i<board_wid * board_heit; i++)
+	{
+		if (pos->board[i])
+			root.board[i] = (pos->board[i] - 1) / SAMEGAME_NUM_ANIM + 1;
+		root.count[root.board[i]]++;
+	}
+	root.score = pos->state ? ((Samegame_state *)pos->state)->score : 0;
+	root.firstx = root.firsty = -1;
+	rounds = ab_max_depth > 0 ? ab_max_depth 
+		: (time_per_move > 0 ? 32 : SAMEGAME_BEAM_ROUNDS);
+	for (i = 0, width = 1; i < rounds && width <= SAMEGAME_BEAM_MAX; i++, width *= 2)
+	{
+		int x, y, score = samegame_beam_search (&root, width, &x, &y);
+		if (score > best && x >= 0)
+		{
+			best = score;
+			bestx = x;
+			besty = y;
+		}
+		// the next width takes about twice as long
+		if (time_per_move > 0 && ab_max_depth <= 0 
+				&& g_timer_elapsed (timer, NULL) * 1000 * 3 > time_per_move)
+			break;
 	}
+	if (bestx < 0 || getmove_real (pos, bestx, besty, movp) <= 0)
+		*movp = NULL;
 }
 
 // Local Variables:
@@ -0,0 +1,83 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+
+#include "game.h"
+#include "stats.h"
+
+/** \file stats.c
+  \brief Writing out the statistics of a search.
+
+  The counts are collected by ab_dfid() in #ab_stats. The protocol
+  command "go" reports them in an "info stats" line, and the engine can
+  also append them to a file, one JSON object per search, so that they
+  are easy to load into other programs.
+  */
+
+float stats_ebf (SearchStats *stats)
+{
+	int n = stats->num_iter;
+	if (n < 2 || stats->iter_nodes[n-2] == 0)
+		return 0;
+	return (float) stats->iter_nodes[n-1] / stats->iter_nodes[n-2];
+}
+
+//! Writes the numbers in list, separated by sep
+static void stats_write_list (int *list, int len, char *sep, FILE *fout)
+{
+	int i;
+	for (i=0; i<len; i++)
+		fprintf (fout, "%s%d", i ? sep : "", list[i]);
+}
+
+void stats_write_info (SearchStats *stats, FILE *fout)
+{
+	fprintf (fout, "info stats depth %d nodes %d leaves %d"
+			" ttprobes %d tthits %d ttstores %d ttcollisions %d"
+			" cutoffs %d firstcutoffs %d ebf %.2f time %d",
+			stats->depth, stats->nodes, stats->leaves,
+			stats->tt_probes, stats->tt_hits, stats->tt_stores, stats->tt_collisions,
+			stats->cutoffs, stats->first_cutoffs, stats_ebf (stats), stats->time);
+	if (stats->num_iter > 0)
+	{
+		fprintf (fout, " iternodes ");
+		stats_write_list (stats->iter_nodes, stats->num_iter, ",", fout);
+		fprintf (fout, " itertime ");
+		stats_write_list (stats->iter_time, stats->num_iter, ",", fout);
+	}
+	fprintf (fout, "\n");
+}
+
+void stats_write_json (SearchStats *stats, Pos *pos, FILE *fout)
+{
+	fprintf (fout, "{\"game\": \"%s\", \"move\": %d, \"player\": \"%s\", "
+			"\"depth\": %d, \"nodes\": %d, \"leaves\": %d, "
+			"\"tt_probes\": %d, \"tt_hits\": %d, \"tt_stores\": %d, \"tt_collisions\": %d, "
+			"\"cutoffs\": %d, \"first_cutoffs\": %d, \"ebf\": %.2f, \"time\": %d, ",
+			pos->game->name, pos->num_moves, pos->player == WHITE ? "white" : "black",
+			stats->depth, stats->nodes, stats->leaves,
+			stats->tt_probes, stats->tt_hits, stats->tt_stores, stats->tt_collisions,
+			stats->cutoffs, stats->first_cutoffs, stats_ebf (stats), stats->time);
+	fprintf (fout, "\"iter_nodes\": [");
+	stats_write_list (stats->iter_nodes, stats->num_iter, ", ", fout);
+	fprintf (fout, "], \"iter_time\": [");
+	stats_write_list (stats->iter_time, stats->num_iter, ", ", fout);
+	fprintf (fout, "]}\n");
+	fflush (fout);
+}
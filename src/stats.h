@@ -0,0 +1,73 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdio.h>
+#include "game.h"
+
+/** \file stats.h
+  \brief Statistics of an alpha-beta search.
+  */
+
+//! Iterations beyond this many are not recorded individually
+#define STATS_MAX_ITER 64
+
+typedef struct
+{
+	//! Number of ply of the last completed iteration
+	int depth;
+	//! Positions searched, including the leaves
+	int nodes;
+	//! Positions evaluated at the search horizon
+	int leaves;
+	//! Lookups of the value of a position in the transposition table
+	int tt_probes;
+	//! How many of tt_probes found the position at the right depth
+	int tt_hits;
+	int tt_stores;
+	//! Stores into a slot that was holding another position
+	int tt_collisions;
+	//! Nodes where a move caused a beta cutoff
+	int cutoffs;
+	//! How many of the cutoffs were caused by the first move searched
+	int first_cutoffs;
+	//! Total time in milliseconds
+	int time;
+	//! Number of completed iterations recorded in iter_nodes and iter_time
+	int num_iter;
+	//! Nodes searched in each iteration
+	int iter_nodes [STATS_MAX_ITER];
+	//! Milliseconds taken by each iteration
+	int iter_time [STATS_MAX_ITER];
+} SearchStats;
+
+//! Statistics of the last search by ab_dfid()
+extern SearchStats ab_stats;
+
+//! Effective branching factor: the growth in nodes from the second last iteration to the last
+float stats_ebf (SearchStats *stats);
+
+//! Writes the statistics as a protocol line starting with "info stats"
+void stats_write_info (SearchStats *stats, FILE *fout);
+
+//! Writes the statistics of a search of pos as a JSON object on one line
+void stats_write_json (SearchStats *stats, Pos *pos, FILE *fout);
+
+#endif
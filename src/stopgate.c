@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
 
 #include "game.h"
 #include "aaball.h"
@@ -283,66 +284,263 @@ ResultType stopgate_who_won (Pos *pos, Player player, char ** commp)
 
 #define EVAL_OPENSQUARE(x, y) (EVAL_ISEMPTY ((x), (y)) && (EVAL_ISEMPTY ((x)-1,(y)) || EVAL_ISEMPTY ((x)+1, (y))) && (EVAL_ISEMPTY ((x),(y)-1) || EVAL_ISEMPTY ((x), (y)+1)))
 
-enum {
-	REGION_WHITE = STOPGATE_NUM_PIECES + 1, 
-	REGION_BLACK, 
-	REGION_OPEN_X = 1 << 4,
-	REGION_OPEN_Y = 1 << 5,
-};
+/* The empty squares fall apart into connected regions, and the game is the
+   sum of the games on the regions. Small regions are valued exactly in the
+   sense of combinatorial game theory and the values are kept in a table
+   keyed by the shape of the region, so a region is analyzed only once
+   however many times the search runs into it. */
 
+//! Regions with more squares than this are only estimated
+#define STOPGATE_SOLVE_MAX 18
 
+//! The finest fraction a value is tracked to
+#define STOPGATE_VAL_DEN 64
 
-static int regions[STOPGATE_BOARD_WID * STOPGATE_BOARD_HEIT];
+//! Number of entries of the table of regions; must be a power of 2
+#define STOPGATE_SHAPE_CACHE_SIZE (1 << 16)
 
-/* Find which regions are open, which are vertical (REGION_WHITE) and which
-   are horizontal (REGION_BLACK)
-   clever algo that avoids a queue: every square in an open region must
-   be on a straight line from a square which has unfilled nbrs in both directions
-   */
-static void find_regions (byte *board)
+typedef struct
 {
-	int i, j;
-	static int count = 0;
-	for (i=0; i<board_wid*board_heit; i++)
-		regions[i] = 0;
-	for (i=0; i < board_wid; i++)
-	for (j=0; j < board_heit; j++)
+	//! The squares of the region, normalized by shape_normalize()
+	guint64 key;
+	//! Whether the region is a number, in which case mean is its exact value
+	gboolean number;
+	//! Roughly what the region is worth to Vertical
+	float mean;
+	//! Roughly what a move in the region is worth to the player to move
+	float temp;
+} ShapeInfo;
+
+static ShapeInfo shape_cache [STOPGATE_SHAPE_CACHE_SIZE];
+
+static int shape_count (guint64 b)
+{
+	int count = 0;
+	for (; b; b &= b - 1)
+		count++;
+	return count;
+}
+
+/* A shape is a mask of squares y * w + x in a box of width w. The key has
+   the mask moved to the top left corner of its box, with the width in
+   bits 58 to 61 and bit 63 set so that no key is 0. Returns 0 if the box
+   is too big to fit. */
+static guint64 shape_normalize (guint64 mask, int w)
+{
+	int minx = w, miny = -1, maxx = -1, maxy = 0, i, nw;
+	guint64 b, key = 0;
+	for (b = mask; b; b &= b - 1)
 	{
-		int x;
-		if (regions [j * board_wid + i] & REGION_OPEN_X)
-			continue;
-		if (EVAL_OPENSQUARE (i, j))
+		i = shape_count ((b & -b) - 1);
+		if (i % w < minx) minx = i % w;
+		if (i % w > maxx) maxx = i % w;
+		if (miny < 0) miny = i / w;
+		maxy = i / w;
+	}
+	nw = maxx - minx + 1;
+	if (nw * (maxy - miny + 1) > 58)
+		return 0;
+	for (b = mask; b; b &= b - 1)
+	{
+		i = shape_count ((b & -b) - 1);
+		key |= G_GUINT64_CONSTANT(1) << ((i / w - miny) * nw + i % w - minx);
+	}
+	return key | ((guint64) (nw - 1) << 58) | (G_GUINT64_CONSTANT(1) << 63);
+}
+
+//! The simplest number strictly between the options; FALSE if it is too fine
+static gboolean shape_simplest_number (gboolean has_l, float l, 
+		gboolean has_r, float r, float *val)
+{
+	int k;
+	if (!has_l && !has_r)
+		return *val = 0, TRUE;
+	if (!has_l)
+		return *val = (r > 0 ? 0 : ceil (r) - 1), TRUE;
+	if (!has_r)
+		return *val = (l < 0 ? 0 : floor (l) + 1), TRUE;
+	if (l < 0 && r > 0)
+		return *val = 0, TRUE;
+	if (l >= 0 && floor (l) + 1 < r)
+		return *val = floor (l) + 1, TRUE;
+	if (r <= 0 && ceil (r) - 1 > l)
+		return *val = ceil (r) - 1, TRUE;
+	for (k = 2; k <= STOPGATE_VAL_DEN; k *= 2)
+	{
+		*val = (floor (l * k) + 1) / k;
+		if (*val < r)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void shape_analyze (guint64 key, ShapeInfo *info);
+
+//! Values the regions that the squares of mask, in a box of width w, fall apart into
+static void shape_sum (guint64 mask, int w, ShapeInfo *sum)
+{
+	guint64 col0 = 0, colw = 0, comp, frontier;
+	int i;
+	for (i=0; i<58; i+=w)
+	{
+		col0 |= G_GUINT64_CONSTANT(1) << i;
+		colw |= G_GUINT64_CONSTANT(1) << (i + w - 1);
+	}
+	sum->number = TRUE;
+	sum->mean = sum->temp = 0;
+	while (mask)
+	{
+		ShapeInfo info;
+		comp = frontier = mask & -mask;
+		while (frontier)
 		{
-			for (x=i; EVAL_ISEMPTY (x, j); x++)
-				regions [j * board_wid + x] |=  REGION_OPEN_X;
-			for (x=i; EVAL_ISEMPTY (x, j); x--)
-				regions [j * board_wid + x] |=  REGION_OPEN_X;
+			frontier = ((frontier & ~colw) << 1) | ((frontier & ~col0) >> 1)
+				| (frontier << w) | (frontier >> w);
+			frontier &= mask & ~comp;
+			comp |= frontier;
 		}
+		mask &= ~comp;
+		shape_analyze (shape_normalize (comp, w), &info);
+		sum->number = sum->number && info.number;
+		sum->mean += info.mean;
+		if (info.temp > sum->temp)
+			sum->temp = info.temp;
 	}
-	for (i=0; i < board_wid; i++)
-	for (j=0; j < board_heit; j++)
+}
+
+static void shape_analyze (guint64 key, ShapeInfo *info)
+{
+	ShapeInfo *entry = &shape_cache [(key ^ (key >> 17) ^ (key >> 41)) 
+		& (STOPGATE_SHAPE_CACHE_SIZE - 1)];
+	ShapeInfo opt;
+	guint64 mask = key & ((G_GUINT64_CONSTANT(1) << 58) - 1), b;
+	int w = ((key >> 58) & 15) + 1, i;
+	gboolean has_l = FALSE, has_r = FALSE, number = TRUE;
+	float l = 0, r = 0;
+
+	assert (key);
+	if (entry->key == key)
 	{
-		int y;
-		if (regions [j * board_wid + i] & REGION_OPEN_Y)
-			continue;
-		if (EVAL_OPENSQUARE (i, j))
+		*info = *entry;
+		return;
+	}
+	for (b = mask; b; b &= b - 1)
+	{
+		i = shape_count ((b & -b) - 1);
+		// Vertical is Left
+		if (mask & (G_GUINT64_CONSTANT(1) << (i + w)))
 		{
-			for (y=j; EVAL_ISEMPTY (i, y); y++)
-				regions [y * board_wid + i] |=  REGION_OPEN_Y;
-			for (y=j; EVAL_ISEMPTY (i, y); y--)
-				regions [y * board_wid + i] |=  REGION_OPEN_Y;
+			shape_sum (mask & ~(G_GUINT64_CONSTANT(1) << i | G_GUINT64_CONSTANT(1) << (i + w)), 
+					w, &opt);
+			number = number && opt.number;
+			if (!has_l || opt.mean > l)
+				l = opt.mean;
+			has_l = TRUE;
 		}
+		if (i % w < w - 1 && (mask & (G_GUINT64_CONSTANT(2) << i)))
+		{
+			shape_sum (mask & ~(G_GUINT64_CONSTANT(3) << i), w, &opt);
+			number = number && opt.number;
+			if (!has_r || opt.mean < r)
+				r = opt.mean;
+			has_r = TRUE;
+		}
+	}
+	info->key = key;
+	info->temp = 0;
+	if (!number || !shape_simplest_number (has_l, l, has_r, r, &info->mean))
+	{
+		// hot, or too complicated to bother with: take it as the switch {l | r}
+		if (!has_l) l = r - 1;
+		if (!has_r) r = l + 1;
+		info->number = FALSE;
+		info->mean = (l + r) / 2;
+		info->temp = (l - r) / 2;
+		if (info->temp < 0)
+			info->temp = 0;
+	}
+	else
+		info->number = TRUE;
+	*entry = *info;
+}
+
+/* For a region too big to analyze: the squares where only one player can
+   move count for that player, and the rest balance out */
+static float region_estimate (byte *board, byte *comp)
+{
+	int i, j, val = 0;
+	for (i=0; i<board_wid; i++)
+	for (j=0; j<board_heit; j++)
+	{
+		if (!comp[j * board_wid + i])
+			continue;
+		if (EVAL_ISEMPTY (i, j+1) || EVAL_ISEMPTY (i, j-1))
+			val++;
+		if (EVAL_ISEMPTY (i+1, j) || EVAL_ISEMPTY (i-1, j))
+			val--;
 	}
-	for (i=0; i < board_wid; i++)
-	for (j=0; j < board_heit; j++)
-		if (board [j * board_wid + i] == 0 && regions[j * board_wid + i] == 0)
+	return val / 2.0;
+}
+
+//! Adds up the regions of the board into sum
+static void find_regions (byte *board, ShapeInfo *sum)
+{
+	byte seen [STOPGATE_BOARD_WID * STOPGATE_BOARD_HEIT];
+	byte comp [STOPGATE_BOARD_WID * STOPGATE_BOARD_HEIT];
+	int stack [STOPGATE_BOARD_WID * STOPGATE_BOARD_HEIT];
+	int i, j, k, n, stack_top;
+	sum->number = TRUE;
+	sum->mean = sum->temp = 0;
+	memset (seen, 0, sizeof (seen));
+	for (i=0; i<board_wid; i++)
+	for (j=0; j<board_heit; j++)
+	{
+		int minx = i, maxx = i, miny = j, maxy = j;
+		guint64 key = 0;
+		ShapeInfo info;
+		if (seen [j * board_wid + i] || !EVAL_ISEMPTY (i, j))
+			continue;
+		memset (comp, 0, sizeof (comp));
+		stack_top = n = 0;
+		seen [j * board_wid + i] = comp [j * board_wid + i] = 1;
+		stack[stack_top++] = j * board_wid + i;
+		while (stack_top > 0)
+		{
+			int x = stack[--stack_top] % board_wid, y = stack[stack_top] / board_wid;
+			n++;
+			if (x < minx) minx = x;
+			if (x > maxx) maxx = x;
+			if (y < miny) miny = y;
+			if (y > maxy) maxy = y;
+			for (k=1; k<8; k+=2)
+			{
+				int nx = x + incx[k], ny = y + incy[k];
+				if (!EVAL_ISEMPTY (nx, ny) || seen [ny * board_wid + nx])
+					continue;
+				seen [ny * board_wid + nx] = comp [ny * board_wid + nx] = 1;
+				stack[stack_top++] = ny * board_wid + nx;
+			}
+		}
+		if (n <= STOPGATE_SOLVE_MAX && (maxx - minx + 1) * (maxy - miny + 1) <= 58)
+		{
+			int x, y, w = maxx - minx + 1;
+			for (x=minx; x<=maxx; x++)
+			for (y=miny; y<=maxy; y++)
+				if (comp [y * board_wid + x])
+					key |= G_GUINT64_CONSTANT(1) << ((y - miny) * w + x - minx);
+			shape_analyze (shape_normalize (key, w), &info);
+		}
+		else
 		{
-			if (EVAL_ISEMPTY (i,j+1) || EVAL_ISEMPTY (i,j-1))
-				regions[j * board_wid + i] = REGION_WHITE;
-			else if (EVAL_ISEMPTY (i+1,j) || EVAL_ISEMPTY (i-1,j))
-				regions[j * board_wid + i] = REGION_BLACK;
+			info.number = FALSE;
+			info.mean = region_estimate (board, comp);
+			info.temp = 1;
 		}
-	// TODO: find the lengths of the runs also
+		sum->number = sum->number && info.number;
+		sum->mean += info.mean;
+		if (info.temp > sum->temp)
+			sum->temp = info.temp;
+	}
 }
 
 
@@ -378,103 +576,21 @@ byte * stopgate_movegen (Pos *pos)
 
 ResultType stopgate_eval (Pos *pos, Player player, float *eval)
 {
-	int i, j;
-	float val = 0;
-	gboolean wfound = FALSE, bfound = FALSE, openfound = FALSE;
-	int run_len=0;
-	int run_eval_w = 0, run_eval_b = 0;
-	byte *board = pos->board;
-	find_regions (board);
-	for (i=0; i<board_wid; i++)
-	{
-		for (j=0; j<board_heit; j++)
-			if (regions[j * board_wid + i] == REGION_WHITE)
-				run_len++;
-			else
-			{
-				run_eval_w += 2 * (run_len / 2);
-				run_len = 0;
-			}
-		run_eval_w += 2 * (run_len / 2);
-		run_len = 0;
-	}
-	for (j=0; j<board_heit; j++)
-	{
-		for (i=0; i<board_wid; i++)
-			if (regions[j * board_wid + i] == REGION_BLACK)
-				run_len++;
-			else
-			{
-				run_eval_b += 2 * (run_len / 2);
-				run_len = 0;
-			}
-		run_eval_b += 2 * (run_len / 2);
-		run_len = 0;
-	}
-	val = run_eval_w - run_eval_b;
-/*	if (++count == 5000)
+	ShapeInfo sum;
+	find_regions (pos->board, &sum);
+	if (sum.number)
 	{
-		count = 0;
-		val = run_eval_w - run_eval_b;
-		printf ("%d, %d\n", run_eval_w, run_eval_b);
-		for (j=board_heit-1; j>=0; j--)
-		{
-			for (i=0; i<board_wid; i++)
-			{
-				if (board [j * board_wid + i])
-					printf (" #");
-				else if (regions[j * board_wid + i] == REGION_WHITE)
-					printf (" W");
-				else if (regions[j * board_wid + i] == REGION_BLACK)
-					printf (" B");
-				else printf (" _");
-			}
-			printf ("\n");
-		}
-		printf ("\n");
-	}	
-*/
-	for (i=0; i<board_wid; i++)
-	for (j=0; j<board_heit; j++)
-	{
-		if (board [j * board_wid + i] != STOPGATE_EMPTY) continue;
-		if (regions[j * board_wid + i] == REGION_WHITE)
-			wfound = TRUE;
-		else if (regions[j * board_wid + i] == REGION_BLACK)
-			bfound = TRUE;
-		else
+		// with only numbers left, the player to move loses unless ahead
+		if (sum.mean > 0 || (sum.mean == 0 && player == BLACK))
 		{
-		   	if (EVAL_ISEMPTY (i, j+1) || EVAL_ISEMPTY (i, j-1))
-			{
-				val++;
-				wfound = TRUE;
-				openfound = TRUE;
-			}
-			if (EVAL_ISEMPTY (i+1, j) || EVAL_ISEMPTY (i-1, j))
-			{
-				val--;
-				bfound = TRUE;
-				openfound = TRUE;
-			}
+			*eval = sum.mean + 1;
+			return RESULT_WHITE;
 		}
-	}
-	if (!openfound)
-	{
-		val += (player == WHITE ? -1 : 1);
-		*eval = val;
-		return val > 0 ? RESULT_WHITE : RESULT_BLACK;
-	}
-	if (player == WHITE && !wfound)
-	{
-		*eval = (val-1);
+		*eval = sum.mean - 1;
 		return RESULT_BLACK;
 	}
-	if (player == BLACK && !bfound)
-	{
-		*eval = (val+1);
-		return RESULT_WHITE;
-	}
-	*eval =  val + 0.01 * random () / RAND_MAX;
+	*eval = sum.mean + (player == WHITE ? sum.temp : -sum.temp)
+		+ 0.01 * random () / RAND_MAX;
 	return RESULT_NOTYET;
 }
 
@@ -0,0 +1,569 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+/** \file tb.c
+  \brief Endgame tablebases built by retrograde analysis.
+  */
+
+#include "config.h"
+
+#include "game.h"
+#include "move.h"
+#include "tb.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+/* The positions are split by material: how many pieces of each kind are
+   on the board. Within a material, the squares of each kind of piece are
+   ranked as a combination, the kinds are combined as a mixed radix 
+   number and the player to move is the lowest bit. Some indices put two
+   pieces on the same square, and are never used. The squares are only
+   those allowed by game_tb_square, numbered in the order of the board.
+
+   A value of d + 1 means the player to move wins in d plies, -(d + 1) 
+   that they lose in d plies, and 0 a draw. Distances too long for a
+   byte are stored as the longest one. */
+
+extern Game *opt_game;
+extern int opt_verbose;
+
+#define TB_MAGIC "gbtb002"
+#define TB_UNKNOWN -128
+#define TB_MAX_SQUARES 256
+#define TB_MAX_KINDS 16
+//! Tablebases with more positions than this aren't built
+#define TB_MAX_SIZE (1 << 28)
+
+typedef struct
+{
+	char magic [8];
+	char game [32];
+	gint32 board_wid, board_heit, num_squares, num_pieces, max_pieces;
+	gint32 size;
+} TBHeader;
+
+typedef struct
+{
+	//! Number of pieces of each kind, and their total
+	int counts [TB_MAX_KINDS + 1], total;
+	//! Index of the first position and number of positions
+	int offset, size;
+} TBMaterial;
+
+static gint8 *tb_vals = NULL;
+static int tb_size = 0;
+//! The mapping of the tablebase file, or NULL if tb_vals was malloc'ed
+static void *tb_map = NULL;
+static size_t tb_map_len = 0;
+
+static TBMaterial *tb_materials = NULL;
+static int tb_num_materials = 0;
+static int tb_num_kinds, tb_num_squares;
+//! The board index of each square of the tablebase
+static int tb_board_square [TB_MAX_SQUARES];
+//! The square of the tablebase of each board index, or -1 if it has none
+static int *tb_square_of = NULL;
+static gint64 tb_binom [TB_MAX_SQUARES + 1][TB_MAX_PIECES + 1];
+
+//! Adds the materials with the counts of kinds from kind onwards still to be chosen
+/** Returns the total number of positions */
+static gint64 tb_add_materials (int *counts, int kind, int left, gint64 size)
+{
+	int i, n;
+	if (kind > tb_num_kinds)
+	{
+		TBMaterial *mat = &tb_materials[tb_num_materials++];
+		gint64 matsize = 2;
+		mat->total = 0;
+		for (i=1; i<=tb_num_kinds; i++)
+		{
+			mat->counts[i] = counts[i];
+			mat->total += counts[i];
+			matsize *= tb_binom[tb_num_squares][counts[i]];
+		}
+		mat->offset = MIN (size, TB_MAX_SIZE);
+		mat->size = MIN (matsize, TB_MAX_SIZE);
+		return size + matsize;
+	}
+	for (n=0; n<=left; n++)
+	{
+		counts[kind] = n;
+		size = tb_add_materials (counts, kind + 1, left - n, size);
+	}
+	return size;
+}
+
+//! Sets up the materials of the current game. Returns FALSE if the tablebase would be too big
+static gboolean tb_setup ()
+{
+	int counts [TB_MAX_KINDS + 1];
+	int n, k, num;
+	gint64 size;
+	tb_num_kinds = opt_game->num_pieces;
+	if (tb_num_kinds > TB_MAX_KINDS)
+		return FALSE;
+	tb_square_of = g_new (int, board_wid * board_heit);
+	tb_num_squares = 0;
+	for (n=0; n<board_wid * board_heit; n++)
+	{
+		tb_square_of[n] = -1;
+		if (game_tb_square && !game_tb_square (n % board_wid, n / board_wid))
+			continue;
+		if (tb_num_squares == TB_MAX_SQUARES)
+			return FALSE;
+		tb_board_square[tb_num_squares] = n;
+		tb_square_of[n] = tb_num_squares++;
+	}
+	for (n=0; n<=tb_num_squares; n++)
+	for (k=0; k<=TB_MAX_PIECES; k++)
+		tb_binom[n][k] = (k == 0 ? 1 : n == 0 ? 0 : 
+				tb_binom[n-1][k-1] + tb_binom[n-1][k]);
+	// the number of ways to split the pieces among the kinds
+	for (num = 1, k = 0; k < game_tb_pieces; k++)
+		num = num * (tb_num_kinds + 1 + k) / (k + 1);
+	tb_materials = g_new (TBMaterial, num);
+	tb_num_materials = 0;
+	size = tb_add_materials (counts, 1, game_tb_pieces, 0);
+	assert (tb_num_materials == num);
+	if (size > TB_MAX_SIZE)
+		return FALSE;
+	tb_size = size;
+	return TRUE;
+}
+
+static TBMaterial * tb_find_material (int *counts)
+{
+	int i, k;
+	for (i=0; i<tb_num_materials; i++)
+	{
+		for (k=1; k<=tb_num_kinds; k++)
+			if (tb_materials[i].counts[k] != counts[k])
+				break;
+		if (k > tb_num_kinds)
+			return &tb_materials[i];
+	}
+	return NULL;
+}
+
+//! The index of a position, or -1 if it isn't covered
+static int tb_index (byte *board, Player player)
+{
+	int counts [TB_MAX_KINDS + 1], ranks [TB_MAX_KINDS + 1];
+	int i, k, total = 0, idx = 0;
+	TBMaterial *mat;
+	for (k=1; k<=tb_num_kinds; k++)
+		counts[k] = ranks[k] = 0;
+	for (i=0; i<board_wid * board_heit; i++)
+	{
+		if (!board[i])
+			continue;
+		if (board[i] > tb_num_kinds || tb_square_of[i] < 0 || ++total > game_tb_pieces)
+			return -1;
+		k = board[i];
+		// the squares come in increasing order
+		ranks[k] += tb_binom[tb_square_of[i]][++counts[k]];
+	}
+	mat = tb_find_material (counts);
+	if (!mat)
+		return -1;
+	for (k=1; k<=tb_num_kinds; k++)
+		idx = idx * tb_binom[tb_num_squares][counts[k]] + ranks[k];
+	return mat->offset + 2 * idx + (player == WHITE ? 0 : 1);
+}
+
+//! The inverse of tb_index(). Returns FALSE if idx puts two pieces on a square
+static gboolean tb_position (int idx, byte *board, Player *player)
+{
+	int m, k, i, s;
+	TBMaterial *mat;
+	for (m=0; m<tb_num_materials - 1; m++)
+		if (tb_materials[m+1].offset > idx)
+			break;
+	mat = &tb_materials[m];
+	idx -= mat->offset;
+	*player = (idx & 1) ? BLACK : WHITE;
+	idx >>= 1;
+	memset (board, 0, board_wid * board_heit);
+	for (k=tb_num_kinds; k>=1; k--)
+	{
+		int rank = idx % tb_binom[tb_num_squares][mat->counts[k]];
+		idx /= tb_binom[tb_num_squares][mat->counts[k]];
+		for (i=mat->counts[k], s=tb_num_squares-1; i>=1; i--)
+		{
+			while (tb_binom[s][i] > rank)
+				s--;
+			rank -= tb_binom[s][i];
+			if (board[tb_board_square[s]])
+				return FALSE;
+			board[tb_board_square[s]] = k;
+		}
+	}
+	return TRUE;
+}
+
+//! Appends the parents of each position to parents, as a list per position
+static void tb_get_parents (int *child_start, int *children, int **parent_startp, int **parentsp)
+{
+	int *parent_start = g_new0 (int, tb_size + 1);
+	int *parents = g_new (int, child_start[tb_size]);
+	int *fill = g_new (int, tb_size);
+	int i, j;
+	for (i=0; i<child_start[tb_size]; i++)
+		parent_start[children[i] + 1]++;
+	for (i=0; i<tb_size; i++)
+		parent_start[i+1] += parent_start[i];
+	memcpy (fill, parent_start, tb_size * sizeof (int));
+	for (i=0; i<tb_size; i++)
+		for (j=child_start[i]; j<child_start[i+1]; j++)
+			parents[fill[children[j]]++] = i;
+	g_free (fill);
+	*parent_startp = parent_start;
+	*parentsp = parents;
+}
+
+//! States of a position while building
+enum { TB_OPEN, TB_DONE, TB_INVALID, TB_OPEN_EXIT };
+
+//! Builds the tablebase into tb_vals
+static void tb_build ()
+{
+	byte *board = g_new (byte, board_wid * board_heit), *newboard = g_new (byte, board_wid * board_heit);
+	byte *state = g_new0 (byte, tb_size);
+	int *remaining = g_new0 (int, tb_size);
+	int *child_start = g_new (int, tb_size + 1), *children, *parent_start, *parents;
+	int *queue = g_new (int, tb_size), head = 0, tail = 0;
+	int num_children = 0, max_children = 1024, idx, i;
+	char *comment;
+	Pos pos;
+
+	tb_vals = g_new0 (gint8, tb_size);
+	children = g_new (int, max_children);
+	pos.game = opt_game;
+	pos.state = NULL;
+	pos.num_moves = 0;
+	pos.search_depth = 0;
+
+	// the values of the ends of the game, and the moves of the others
+	for (idx=0; idx<tb_size; idx++)
+	{
+		ResultType result;
+		byte *movlist, *move;
+		child_start[idx] = num_children;
+		if (!tb_position (idx, board, &pos.player))
+		{
+			state[idx] = TB_INVALID;
+			continue;
+		}
+		pos.board = board;
+		result = game_who_won (&pos, pos.player, &comment);
+		if (result == RESULT_WHITE || result == RESULT_BLACK)
+		{
+			tb_vals[idx] = ((result == RESULT_WHITE) == (pos.player == WHITE)) ? 1 : -1;
+			state[idx] = TB_DONE;
+			queue[tail++] = idx;
+			continue;
+		}
+		if (result != RESULT_NOTYET)
+		{
+			state[idx] = TB_DONE;
+			continue;
+		}
+		movlist = game_movegen (&pos);
+		// we don't know the value when there are no moves, or a move leaves the tablebase
+		if (movlist[0] == -2)
+			state[idx] = TB_OPEN_EXIT;
+		for (move = movlist; move[0] != -2; move = movlist_next (move))
+		{
+			int child;
+			memcpy (newboard, board, board_wid * board_heit);
+			move_apply (newboard, move);
+			child = tb_index (newboard, pos.player == WHITE ? BLACK : WHITE);
+			if (child < 0)
+			{
+				state[idx] = TB_OPEN_EXIT;
+				continue;
+			}
+			if (num_children == max_children)
+			{
+				max_children *= 2;
+				children = g_realloc (children, max_children * sizeof (int));
+			}
+			children[num_children++] = child;
+			remaining[idx]++;
+		}
+		free (movlist);
+	}
+	child_start[tb_size] = num_children;
+	tb_get_parents (child_start, children, &parent_start, &parents);
+	g_free (children);
+	g_free (child_start);
+
+	// going back from the ends, nearest first
+	while (head < tail)
+	{
+		int cur = queue[head++], val = tb_vals[cur];
+		int dist = MIN (abs (val) + 1, 127);
+		for (i=parent_start[cur]; i<parent_start[cur+1]; i++)
+		{
+			int parent = parents[i];
+			if (state[parent] == TB_DONE)
+				continue;
+			if (val < 0)
+				tb_vals[parent] = dist;
+			else if (--remaining[parent] == 0 && state[parent] == TB_OPEN)
+				tb_vals[parent] = -dist;
+			else
+				continue;
+			state[parent] = TB_DONE;
+			queue[tail++] = parent;
+		}
+	}
+
+	// what is left is a draw, unless it could lead out of the tablebase
+	head = tail = 0;
+	for (idx=0; idx<tb_size; idx++)
+		if (state[idx] == TB_OPEN_EXIT || state[idx] == TB_INVALID)
+		{
+			tb_vals[idx] = TB_UNKNOWN;
+			queue[tail++] = idx;
+		}
+	while (head < tail)
+	{
+		int cur = queue[head++];
+		for (i=parent_start[cur]; i<parent_start[cur+1]; i++)
+		{
+			int parent = parents[i];
+			if (state[parent] != TB_OPEN)
+				continue;
+			state[parent] = TB_OPEN_EXIT;
+			tb_vals[parent] = TB_UNKNOWN;
+			queue[tail++] = parent;
+		}
+	}
+
+	g_free (parent_start);
+	g_free (parents);
+	g_free (remaining);
+	g_free (state);
+	g_free (queue);
+	g_free (board);
+	g_free (newboard);
+}
+
+//! The name of the tablebase file of the current game, or NULL if there is no home directory
+static gchar * tb_filename ()
+{
+	gchar *filename, *s, *home = getenv ("HOME");
+	if (!home)
+		return NULL;
+	filename = g_strdup_printf ("%s/.gtkboard/tb/%s.tb", home, opt_game->name);
+	// game names have spaces
+	for (s = strrchr (filename, '/') + 1; *s; s++)
+		if (*s == ' ')
+			*s = '_';
+	return filename;
+}
+
+static void tb_header (TBHeader *header)
+{
+	memset (header, 0, sizeof (TBHeader));
+	strncpy (header->magic, TB_MAGIC, sizeof (header->magic));
+	strncpy (header->game, opt_game->name, sizeof (header->game) - 1);
+	header->board_wid = board_wid;
+	header->board_heit = board_heit;
+	header->num_squares = tb_num_squares;
+	header->num_pieces = tb_num_kinds;
+	header->max_pieces = game_tb_pieces;
+	header->size = tb_size;
+}
+
+//! Maps or reads the tablebase file. Returns FALSE if it's missing or for another game
+static gboolean tb_load (gchar *filename)
+{
+	TBHeader header, file_header;
+	struct stat st;
+	FILE *in = fopen (filename, "rb");
+	if (!in)
+		return FALSE;
+	tb_header (&header);
+	// a truncated file would fault when the map is read past its end
+	if (fread (&file_header, sizeof (TBHeader), 1, in) != 1 
+			|| memcmp (&header, &file_header, sizeof (TBHeader))
+			|| fstat (fileno (in), &st) < 0
+			|| st.st_size != sizeof (TBHeader) + (off_t) tb_size)
+	{
+		fclose (in);
+		return FALSE;
+	}
+#ifdef HAVE_MMAP
+	tb_map_len = sizeof (TBHeader) + tb_size;
+	tb_map = mmap (NULL, tb_map_len, PROT_READ, MAP_SHARED, fileno (in), 0);
+	if (tb_map != MAP_FAILED)
+	{
+		fclose (in);
+		tb_vals = (gint8 *) tb_map + sizeof (TBHeader);
+		return TRUE;
+	}
+	tb_map = NULL;
+#endif
+	tb_vals = g_new (gint8, tb_size);
+	if (fread (tb_vals, 1, tb_size, in) != tb_size)
+	{
+		g_free (tb_vals);
+		tb_vals = NULL;
+	}
+	fclose (in);
+	return tb_vals != NULL;
+}
+
+//! Writes the tablebase so that the next run can map it. Returns FALSE if it couldn't be written
+/** The file is written under another name and renamed into place, so
+  that another engine never maps a half written file. */
+static gboolean tb_save (gchar *filename)
+{
+	TBHeader header;
+	FILE *out;
+	gboolean ok;
+	gchar *tmpname, *dir;
+	dir = g_strdup_printf ("%s/.gtkboard", getenv ("HOME"));
+	mkdir (dir, 0755);
+	g_free (dir);
+	dir = g_strdup_printf ("%s/.gtkboard/tb", getenv ("HOME"));
+	mkdir (dir, 0755);
+	g_free (dir);
+	tmpname = g_strdup_printf ("%s.tmp", filename);
+	out = fopen (tmpname, "wb");
+	if (!out)
+	{
+		g_free (tmpname);
+		return FALSE;
+	}
+	tb_header (&header);
+	ok = fwrite (&header, sizeof (TBHeader), 1, out) == 1 
+			&& fwrite (tb_vals, 1, tb_size, out) == tb_size;
+	if (fclose (out) != 0)
+		ok = FALSE;
+	if (!ok || rename (tmpname, filename) < 0)
+	{
+		unlink (tmpname);
+		ok = FALSE;
+	}
+	g_free (tmpname);
+	return ok;
+}
+
+//! Checks that the current game can have a tablebase and sets up its materials
+static gboolean tb_prepare ()
+{
+	tb_free ();
+	if (game_tb_pieces <= 0 || game_tb_pieces > TB_MAX_PIECES 
+			|| !game_who_won || !game_movegen || game_stateful)
+		return FALSE;
+	if (!tb_setup ())
+	{
+		tb_free ();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+gboolean tb_init ()
+{
+	gchar *filename;
+	if (game_tb_pieces <= 0)
+	{
+		tb_free ();
+		return TRUE;
+	}
+	if (!tb_prepare ())
+		return FALSE;
+	filename = tb_filename ();
+	if (!filename || !tb_load (filename))
+	{
+		if (opt_verbose)
+			fprintf (stderr, "tb: no tablebase for %s, build it with gtkboard-engine -T\n",
+					opt_game->name);
+		g_free (filename);
+		return FALSE;
+	}
+	g_free (filename);
+	return TRUE;
+}
+
+gboolean tb_make ()
+{
+	gchar *filename;
+	gboolean ok;
+	if (!tb_prepare ())
+		return FALSE;
+	tb_build ();
+	filename = tb_filename ();
+	ok = filename && tb_save (filename);
+	if (!ok)
+		fprintf (stderr, "tb: could not save the tablebase%s%s\n", 
+				filename ? " to " : " (HOME is not set)", filename ? filename : "");
+	g_free (filename);
+	return ok;
+}
+
+void tb_free ()
+{
+#ifdef HAVE_MMAP
+	if (tb_map)
+		munmap (tb_map, tb_map_len);
+	else
+#endif
+	g_free (tb_vals);
+	tb_map = NULL;
+	tb_vals = NULL;
+	g_free (tb_materials);
+	tb_materials = NULL;
+	g_free (tb_square_of);
+	tb_square_of = NULL;
+	tb_num_materials = 0;
+	tb_size = 0;
+}
+
+ResultType tb_probe (Pos *pos, float *eval)
+{
+	int idx, val;
+	if (!tb_vals || (idx = tb_index (pos->board, pos->player)) < 0)
+		return RESULT_NOTYET;
+	val = tb_vals[idx];
+	if (val == TB_UNKNOWN)
+		return RESULT_NOTYET;
+	if (val == 0)
+	{
+		*eval = 0;
+		return RESULT_TIE;
+	}
+	if (pos->player == BLACK)
+		val = -val;
+	*eval = (val > 0 ? 1 : -1) * GAME_EVAL_INFTY * (2 - abs (val) / 256.0);
+	return val > 0 ? RESULT_WHITE : RESULT_BLACK;
+}
@@ -0,0 +1,59 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _TB_H_
+#define _TB_H_
+
+#include "game.h"
+
+/** \file tb.h
+  \brief Endgame tablebases built by retrograde analysis.
+
+  A tablebase holds the exact value of every position with at most
+  #game_tb_pieces pieces on the board. It is built from game_movegen(),
+  move_apply() and game_who_won() alone, so any game whose positions are
+  described by the board and the player to move can have one.
+
+  The tablebase is kept in ~/.gtkboard/tb/ as a header followed by one
+  byte per position, and is memory mapped when it is loaded.
+  */
+
+//! The most pieces a tablebase can cover
+#define TB_MAX_PIECES 6
+
+//! Loads the tablebase of the current game
+/** Does nothing if #game_tb_pieces is 0. Returns FALSE if the game can't
+  have a tablebase or it hasn't been built yet: building one can take
+  seconds, so it is only done by tb_make(). */
+gboolean tb_init ();
+
+//! Builds the tablebase of the current game and saves it for tb_init()
+/** The tablebase stays loaded. Returns FALSE if the game can't have one,
+  or it couldn't be saved. */
+gboolean tb_make ();
+
+//! Unloads the tablebase, if any
+void tb_free ();
+
+//! Looks up pos in the tablebase
+/** If the position is covered sets eval and returns the result. A win is
+  worth at least GAME_EVAL_INFTY, and more the sooner it comes, and a draw
+  is worth 0. Returns RESULT_NOTYET if the position is not covered. */
+ResultType tb_probe (Pos *pos, float *eval);
+
+#endif
@@ -0,0 +1,250 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "game.h"
+#include "move.h"
+#include "stack.h"
+#include "engine.h"
+#include "stats.h"
+#include "analyze.h"
+#include "tourney.h"
+
+/** \file tourney.c
+  \brief Self-play tournaments between two heuristics.
+
+  Every game is reported on a line of its own:
+
+  <tt>game</tt> g <tt>white</tt> A|B <tt>result</tt> 1-0|0-1|1/2-1/2
+  <tt>plies</tt> n
+
+  followed by a summary with the score of A, the Elo difference with
+  its 95% confidence interval, nodes per second and the average depth
+  reached.
+  */
+
+//! Games longer than this are adjudicated as draws
+#define TOURNEY_MAX_PLIES 1000
+
+extern Pos cur_pos;
+extern Game *opt_game;
+extern int time_per_move;
+extern gboolean engine_flag;
+extern int ab_max_depth;
+extern void engine_set_heur (char *);
+
+//! Totals over the searches done by this process
+static double tr_nodes, tr_depth, tr_secs;
+static int tr_searches;
+
+//! Sets up the heuristics so that heur_a plays white if a_white is TRUE
+static void tourney_set_heurs (char *heur_a, char *heur_b, gboolean a_white)
+{
+	char buf[256];
+	if (!heur_a && !heur_b)
+		return;
+	g_snprintf (buf, sizeof (buf), "%s %s", 
+			a_white ? heur_a : heur_b, a_white ? heur_b : heur_a);
+	engine_set_heur (buf);
+}
+
+//! Plays open_plies random moves. The opening depends only on seed.
+static gboolean tourney_random_opening (int open_plies, int seed)
+{
+	int i, num_moves;
+	byte *movlist, *move;
+	srandom (seed);
+	for (i=0; i<open_plies; i++)
+	{
+		movlist = game_movegen (&cur_pos);
+		for (num_moves=0, move=movlist; move[0] != -2; move = movlist_next (move))
+			num_moves++;
+		if (num_moves == 0)
+		{
+			free (movlist);
+			return FALSE;
+		}
+		for (move=movlist, num_moves = random () % num_moves; num_moves > 0; num_moves--)
+			move = movlist_next (move);
+		movstack_trunc ();
+		engine_apply_move (move);
+		free (movlist);
+	}
+	return TRUE;
+}
+
+//! Plays out the game from cur_pos. Returns the result
+static ResultType tourney_play (int *plies)
+{
+	ResultType result = RESULT_NOTYET;
+	byte *move;
+	GTimer *timer = g_timer_new ();
+	gulong micro_sec;
+	while (cur_pos.num_moves < TOURNEY_MAX_PLIES)
+	{
+		if (game_who_won)
+		{
+			char *scorestr = NULL;
+			result = game_who_won (&cur_pos, cur_pos.player, &scorestr);
+			if (result != RESULT_NOTYET)
+				break;
+		}
+		g_timer_start (timer);
+		move = engine_search_timed (&cur_pos, 
+				ab_max_depth > 0 ? 0 : 2 * time_per_move);
+		tr_secs += g_timer_elapsed (timer, &micro_sec);
+		// all the nodes, including those of an unfinished last iteration
+		tr_nodes += ab_stats.nodes;
+		if (ab_stats.depth > 0)
+		{
+			tr_depth += ab_stats.depth;
+			tr_searches++;
+		}
+		if (!move)
+			break;
+		movstack_trunc ();
+		engine_apply_move (move);
+	}
+	g_timer_destroy (timer);
+	*plies = cur_pos.num_moves;
+	return result;
+}
+
+//! Arguments of tourney_worker()
+typedef struct
+{
+	char *heur_a, *heur_b;
+	int depth, open_plies, num_games, seed;
+} TourneyJob;
+
+//! Plays games worker, worker + num_workers, ... and writes one line per game, then the search totals
+static void tourney_worker (int worker, int num_workers, FILE *fout, gpointer data)
+{
+	TourneyJob *job = data;
+	int i, plies;
+	engine_flag = TRUE;
+	ab_max_depth = job->depth;
+	tr_nodes = tr_depth = tr_secs = 0;
+	tr_searches = 0;
+	for (i=worker; i<job->num_games; i+=num_workers)
+	{
+		gboolean a_white = i % 2 == 0;
+		ResultType result = RESULT_NOTYET;
+		engine_reset_game ();
+		tourney_set_heurs (job->heur_a, job->heur_b, a_white);
+		if (tourney_random_opening (job->open_plies, job->seed + i / 2))
+			result = tourney_play (&plies);
+		else
+			plies = cur_pos.num_moves;
+		fprintf (fout, "game %d white %c result %s plies %d\n", i + 1, 
+				a_white ? 'A' : 'B', 
+				result == RESULT_WHITE ? "1-0" : 
+				result == RESULT_BLACK ? "0-1" : "1/2-1/2", plies);
+	}
+	fprintf (fout, "totals %.0f %.0f %f %d\n", 
+			tr_nodes, tr_depth, tr_secs, tr_searches);
+}
+
+//! Elo difference corresponding to a score (between 0 and 1)
+static double tourney_elo (double score)
+{
+	if (score <= 0) return -HUGE_VAL;
+	if (score >= 1) return HUGE_VAL;
+	return -400 * log10 (1 / score - 1);
+}
+
+void tourney_run (int num_games, char *heur_a, char *heur_b, 
+		int depth, int open_plies, int num_workers)
+{
+	TourneyJob job;
+	FILE **outs;
+	char linebuf[1024];
+	int i, wins = 0, draws = 0, losses = 0, searches = 0;
+	double nodes = 0, depthsum = 0, secs = 0, score, var, err;
+	GTimeVal timeval;
+	if (game_single_player || game_search || !game_movegen || !game_eval)
+	{
+		fprintf (stderr, "tournament: %s can't play itself\n", opt_game->name);
+		exit (1);
+	}
+	if ((heur_a || heur_b) && !game_htab)
+	{
+		fprintf (stderr, "no support for changing eval fn. in %s\n", opt_game->name);
+		exit (1);
+	}
+	if (num_workers > num_games)
+		num_workers = num_games;
+	if (num_workers < 1)
+		num_workers = 1;
+	g_get_current_time (&timeval);
+	job.heur_a = heur_a;
+	job.heur_b = heur_b;
+	job.depth = depth;
+	job.open_plies = open_plies;
+	job.num_games = num_games;
+	job.seed = timeval.tv_usec;
+	outs = analyze_fork_workers (num_workers, tourney_worker, &job);
+	for (i=0; i<num_workers; i++)
+	{
+		while (fgets (linebuf, sizeof (linebuf), outs[i]))
+		{
+			char white, result[16];
+			double n, d, s;
+			int c;
+			if (sscanf (linebuf, "game %*d white %c result %15s", &white, result) == 2)
+			{
+				fputs (linebuf, stdout);
+				if (!strcmp (result, "1/2-1/2"))
+					draws++;
+				else if ((white == 'A') == !strcmp (result, "1-0"))
+					wins++;
+				else
+					losses++;
+			}
+			else if (sscanf (linebuf, "totals %lf %lf %lf %d", &n, &d, &s, &c) == 4)
+			{
+				nodes += n;
+				depthsum += d;
+				secs += s;
+				searches += c;
+			}
+		}
+		fclose (outs[i]);
+	}
+	free (outs);
+
+	// the standard error of the mean score, from the per game scores
+	num_games = wins + draws + losses;
+	if (num_games == 0)
+		return;
+	score = (wins + 0.5 * draws) / num_games;
+	var = (wins * (1 - score) * (1 - score) + draws * (0.5 - score) * (0.5 - score)
+			+ losses * score * score) / num_games;
+	err = 1.96 * sqrt (var / num_games);
+	printf ("games %d wins %d draws %d losses %d score %.3f\n", 
+			num_games, wins, draws, losses, score);
+	printf ("elo %.1f +/- %.1f\n", tourney_elo (score),
+			(tourney_elo (score + err) - tourney_elo (score - err)) / 2);
+	printf ("nps %.0f avgdepth %.2f\n", secs > 0 ? nodes / secs : 0, 
+			searches ? depthsum / searches : 0);
+	fflush (stdout);
+}
@@ -0,0 +1,32 @@
+/*  This file is a part of gtkboard, a board games system.
+    Copyright (C) 2003, Arvind Narayanan <arvindn@users.sourceforge.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111 USA
+
+*/
+#ifndef _TOURNEY_H_
+#define _TOURNEY_H_
+
+//! Plays num_games games of the current game between two heuristics and reports the result
+/** heur_a and heur_b are names from #game_htab, or NULL for the
+  default eval. They swap colors every game, and each pair of games
+  starts from the same random opening of open_plies moves. If depth is
+  positive every move is searched to that depth, otherwise for
+  time_per_move milliseconds. The games are played by num_workers
+  processes. */
+void tourney_run (int num_games, char *heur_a, char *heur_b, 
+		int depth, int open_plies, int num_workers);
+
+#endif
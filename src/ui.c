@@ -55,119 +55,22 @@
 //! Default thinking time per move
 #define DEF_TIME_PER_MOVE 2000
 
-extern Game 
-	Othello, Samegame, Rgb, Fifteen, Memory, 
-	Tetris, Chess, Antichess, Hiq, Checkers, 
-	Plot4, Maze, Infiltrate, Hypermaze, Ataxx, 
-	Pentaline, Mastermind, Pacman, Flw, Wordtris,
-	Ninemm, Stopgate, Knights, Breakthrough, 
-	CapturePento, Towers, Quarto, Kttour, Eightqueens, Dnb,
-	Blet, Othello6x6, Simple
-	;
-
-Game *games[] = { 
-	&Chess, 
-	&Antichess, 
-	&Breakthrough, 
-	
-	&Pacman, 
-	&Fifteen, 
-	&Samegame, 
-	&Tetris, 
-
-	&Blet, 
-	&Eightqueens, 
-	&Towers,
-	&Hiq,
-	
-	&Plot4, 
-	&Quarto, 
-	&Rgb, 
-	&Pentaline,
-	
-	&Dnb, 
-	&Stopgate, 
-	&CapturePento, 
-	&Knights, 
-
-	&Othello, 
-	&Othello6x6, 
-	
-	&Wordtris,
-	&Flw, 
-		
-	&Maze, 
-	&Hypermaze, 
-	
-	&Infiltrate, 
-	&Kttour, 
-	&Mastermind,
-	&Ataxx, 
-	&Checkers, 
-	&Memory, 
-	&Ninemm, 
-	&Simple
-		
-};
-
-const int num_games = sizeof (games) / sizeof (games[0]);
-
-gboolean engine_flag = FALSE; // are we client or server. server will set it to TRUE
-
 /* streams to communicate with engine */
 FILE *move_fin, *move_fout;
 
 static GIOChannel *ui_in = NULL;
 
-Pos cur_pos = {NULL, NULL, NULL, WHITE, NULL, NULL, 0, 0};
-
-int board_wid, board_heit;
-
 static int engine_pid = -1;
 
 static gint animate_tag = -1;
 
 //int state_player = WHITE;
 
-gboolean game_allow_undo = FALSE;
-
-gboolean game_single_player = FALSE;
-gboolean game_animation_use_movstack = TRUE;
-gboolean game_allow_back_forw = TRUE;
-int game_animation_time = 0;
-
-gchar *game_doc_about = NULL;
-gchar *game_doc_rules = NULL;
-gchar *game_doc_strategy = NULL;
-gchar *game_doc_history = NULL;
-CompletionStatus game_doc_about_status = STATUS_NONE;
- 
-
-gchar *game_white_string = "White", *game_black_string = "Black";
-
 gboolean ui_gameover = FALSE;
 gboolean ui_stopped = TRUE;
 gboolean ui_cheated = FALSE;
-gboolean game_stateful = FALSE;
 gboolean state_gui_active = FALSE;
-gboolean game_draw_cell_boundaries = FALSE;
-gboolean game_start_immediately = FALSE;
-gboolean game_allow_flip = FALSE;
-gboolean game_file_label = 0,  game_rank_label = 0;
-
-char *game_highlight_colors = NULL;
-char game_highlight_colors_def[9] = {0xff, 0xff, 0, 0, 0, 0, 0, 0, 0};
-
-GameLevel *game_levels = NULL;
-HeurTab *game_htab = NULL;
-int game_state_size = 0;
-
-SCORE_FIELD * game_score_fields = prefs_score_fields_def;
-gchar **game_score_field_names = prefs_score_field_names_def;
-
-char **game_bg_pixmap = NULL;
 
-Game *opt_game = NULL;
 FILE *opt_infile = NULL;
 FILE *opt_logfile = NULL;
 int opt_delay = DEF_TIME_PER_MOVE;
@@ -176,7 +79,6 @@ int opt_white = NONE;
 int opt_black = NONE;
 int ui_white = NONE;
 int ui_black = NONE;
-int opt_verbose = 0;
 static gboolean opt_html_help = FALSE;
 
 extern void engine_main (int, int);
@@ -190,31 +92,6 @@ int ui_get_machine_move ();
 void ui_make_human_move (byte *, int *);
 void set_game_params ();
 
-ResultType (*game_eval) (Pos *, Player, float *) = NULL;
-ResultType (*game_eval_incr) (Pos *, byte *, float *) = NULL;
-gboolean (*game_use_incr_eval) (Pos *) = NULL;
-float (*game_eval_white) (Pos *, int) = NULL;
-float (*game_eval_black) (Pos *, int) = NULL;
-void (*game_search) (Pos *, byte **) = NULL;
-byte * (*game_movegen) (Pos *) = NULL;
-InputType (*game_event_handler) (Pos *, GtkboardEvent *, MoveInfo *) = NULL;
-int (*game_getmove) (Pos *, int, int, GtkboardEventType, Player, byte **, int **) = NULL;
-int (*game_getmove_kb) (Pos *, int, byte **, int **) = NULL;
-ResultType (*game_who_won) (Pos *, Player, char **) = NULL;
-int (*game_animate) (Pos *, byte **) = NULL;
-char **( *game_get_pixmap) (int, int) = NULL;
-guchar *( *game_get_rgbmap) (int, int) = NULL;
-void (*game_free) () = NULL;
-void * (*game_newstate) (Pos *, byte *) = NULL;
-void (*game_set_init_pos) (Pos *) = game_set_init_pos_def;
-void (*game_set_init_render) (Pos *) = NULL;
-void (*game_get_render) (Pos *, byte *, int **) = NULL;
-void (*game_reset_uistate) () = NULL;
-int (*game_scorecmp) (gchar *, int, gchar*, int) = NULL;
-int (*game_scorecmp_def_dscore) (gchar *, int, gchar*, int) = prefs_scorecmp_dscore;
-int (*game_scorecmp_def_iscore) (gchar *, int, gchar*, int) = prefs_scorecmp_iscore;
-int (*game_scorecmp_def_time) (gchar *, int, gchar*, int) = prefs_scorecmp_time;
-
 GtkWidget *main_window, *board_area = NULL;
 GtkWidget *board_rowbox = NULL, *board_colbox = NULL;
 
@@ -275,81 +152,6 @@ int ui_animate_cb ()
 	return TRUE;
 }
 
-// Will be called on both ui and engine
-void game_set_init_pos_def (Pos *pos)
-{
-	int x, y;
-
-	for (x=0; x<board_wid; x++)
-		for (y=0; y<board_heit; y++)
-			pos->board[y * board_wid + x] = 
-				opt_game->init_pos ? 
-				opt_game->init_pos [(board_heit -1 - y) * board_wid + x] : 0;
-}
-
-
-// Will be called on both ui and engine
-void reset_game_params ()
-{
-	if (game_free) game_free ();
-	game_levels = NULL;
-	game_htab = NULL;
-	game_eval = NULL;
-	game_eval_incr = NULL;
-	game_use_incr_eval = NULL;
-	game_eval_white = NULL;
-	game_eval_black = NULL;
-	game_search = NULL;
-	game_movegen = NULL;
-	game_event_handler = NULL;
-	game_getmove = NULL;
-	game_getmove_kb = NULL;
-	game_who_won  = NULL;
-	game_get_pixmap = NULL;
-	game_get_rgbmap = NULL;
-	game_set_init_pos = game_set_init_pos_def;
-	game_set_init_render = NULL;
-	game_get_render = NULL;
-	game_animate = NULL;
-	game_free = NULL;
-	game_scorecmp = NULL;
-	game_stateful = FALSE;
-	game_animation_use_movstack = TRUE;
-	game_allow_back_forw = TRUE;
-	game_single_player = FALSE;
-	game_allow_undo = FALSE;
-	game_doc_about_status = STATUS_NONE;
-	game_doc_about = NULL;
-	game_doc_rules = NULL;
-	game_doc_strategy = NULL;
-	game_doc_history = NULL;
-	game_white_string = "White";
-	game_black_string = "Black";
-	//state_player = WHITE;
-	// TODO: replace state_player by cur_pos.player globally
-	cur_pos.player = WHITE;
-	game_state_size = 0;
-	game_newstate = NULL;
-	game_reset_uistate = NULL;
-	game_highlight_colors = game_highlight_colors_def;
-	game_draw_cell_boundaries = FALSE;
-	game_start_immediately = FALSE;
-	game_allow_flip = FALSE;
-	game_file_label = FILERANK_LABEL_TYPE_NONE;
-	game_rank_label = FILERANK_LABEL_TYPE_NONE;
-	game_score_fields = prefs_score_fields_def;
-	game_score_field_names = prefs_score_field_names_def;
-	game_bg_pixmap = NULL;
-	if (cur_pos.board) free (cur_pos.board);
-	if (cur_pos.render) free (cur_pos.render);
-	cur_pos.game = NULL;
-	cur_pos.board = NULL;
-	cur_pos.render = NULL;
-	cur_pos.state = NULL;
-	cur_pos.ui_state = NULL;
-	cur_pos.num_moves = 0;
-	cur_pos.search_depth = 0;
-}
 
 void ui_terminate_game ()
 {
@@ -417,8 +219,7 @@ void ui_start_game ()
 }
 
 
-//! game specific initialization
-// FIXME: fork this into 2 functions for client and server
+//! game specific initialization (client side). The engine has its own version in engine.c
 void set_game_params ()
 {
 	Game *game = opt_game;
@@ -429,37 +230,27 @@ void set_game_params ()
 	cur_pos.board = (byte *) malloc (board_wid * board_heit);
 	assert (cur_pos.board);
 
-	if (!engine_flag)
-	{
-		cur_pos.render = (int *) malloc (sizeof (int) * board_wid * board_heit);
-		memset (cur_pos.render, 0, sizeof (int) * board_wid * board_heit);
-		assert (cur_pos.render);
-	}
+	cur_pos.render = (int *) malloc (sizeof (int) * board_wid * board_heit);
+	memset (cur_pos.render, 0, sizeof (int) * board_wid * board_heit);
+	assert (cur_pos.render);
 	
-	if (engine_flag) 
-		// server always executes this
-		game_set_init_pos (&cur_pos);
-	else
-	{
-		if (game_set_init_pos == game_set_init_pos_def) 
-		// client executes only if it is the default
+	// client executes only if it is the default
+	if (game_set_init_pos == game_set_init_pos_def) 
 		game_set_init_pos (&cur_pos);
 
-		if (game_set_init_render)
-			game_set_init_render (&cur_pos);
-	}
+	if (game_set_init_render)
+		game_set_init_render (&cur_pos);
 	
-	if (!engine_flag)	
-		if (move_fout)
-		{
-			fprintf (move_fout, "NEW_GAME %s\n", game->name);
-			fflush (move_fout);
-			// read the initial position
-			if (game_set_init_pos != game_set_init_pos_def)
-				fread (cur_pos.board, board_wid * board_heit, 1, move_fin);
-			fprintf (move_fout, "MSEC_PER_MOVE %d\n", opt_delay);
-			fflush (move_fout);
-		}
+	if (move_fout)
+	{
+		fprintf (move_fout, "NEW_GAME %s\n", game->name);
+		fflush (move_fout);
+		// read the initial position
+		if (game_set_init_pos != game_set_init_pos_def)
+			fread (cur_pos.board, board_wid * board_heit, 1, move_fin);
+		fprintf (move_fout, "MSEC_PER_MOVE %d\n", opt_delay);
+		fflush (move_fout);
+	}
 }
 
 void ui_check_who_won()